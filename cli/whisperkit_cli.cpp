@@ -3,12 +3,23 @@
 
 #include "whisperkit_cli.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <iostream>
 #include <string>
+#include <thread>
 
 WhisperKitConfig::WhisperKitConfig() {
     audioPath = "";
+    audioListPath = "";
     modelPath = "";
+    cascadeModelPath = "";
+    swapModelPath = "";
     audioEncoderComputeUnits = "";
     textDecoderComputeUnits = "";
     temperature = 0.f;
@@ -21,10 +32,40 @@ WhisperKitConfig::WhisperKitConfig() {
     logprobThreshold = -1.f;
     firstTokenLogProbThreshold = -1.f;
     noSpeechThreshold = 0.3f;
+    compressionRatioThreshold = 2.4f;
     report = false;
     reportPath = ".";
     concurrentWorkerCount = 4;
+    stream = false;
+    streamIntervalMs = 0;
+    endpointHangoverMs = 0;
+    streamRepeat = 1;
+    repeat = 1;
+    fromMemory = "";
+    segments = false;
+    tokens = false;
+    streamGapMs = 0;
+    deadlineMs = 0;
+    overloadPolicy = WHISPERKIT_OVERLOAD_POLICY_BLOCK;
+    maxBacklogMs = 0;
+    streamSpeed = 1.f;
+    swapAfterMs = 0;
     verbose = false;
+    prewarm = false;
+    load = true;
+    numPipelines = 1;
+    sessions = 0;
+    pipelinePerSession = false;
+    parallelChunks = false;
+    vadPacking = false;
+    staged = false;
+    lowMemory = false;
+    benchmarkDecoderState = false;
+    autotune = false;
+    threadPolicy = WHISPERKIT_THREAD_POLICY_DEFAULT;
+    encoderThreads = 0;
+    decoderThreads = 0;
+    backendsSet = false;
 #if QNN_DELEGATE
     encoder_backend = WHISPERKIT_COMPUTE_BACKEND_NPU;
     decoder_backend = WHISPERKIT_COMPUTE_BACKEND_NPU;
@@ -34,13 +75,27 @@ WhisperKitConfig::WhisperKitConfig() {
 #endif
 };
 
+whisperkit_backend_t parse_compute_unit(const std::string& unit) {
+    if (unit == "CPU") return WHISPERKIT_COMPUTE_BACKEND_CPU;
+    if (unit == "CPU_BUILTIN") return WHISPERKIT_COMPUTE_BACKEND_CPU_BUILTIN;
+    if (unit == "NPU") return WHISPERKIT_COMPUTE_BACKEND_NPU;
+    return WHISPERKIT_COMPUTE_BACKEND_GPU;
+}
+
+whisperkit_overload_policy_t parse_overload_policy(const std::string& policy) {
+    if (policy == "drop") return WHISPERKIT_OVERLOAD_POLICY_DROP_AUDIO;
+    if (policy == "drop-silence") return WHISPERKIT_OVERLOAD_POLICY_DROP_SILENCE;
+    if (policy == "reduce-decoding") return WHISPERKIT_OVERLOAD_POLICY_REDUCE_DECODING;
+    return WHISPERKIT_OVERLOAD_POLICY_BLOCK;
+}
+
 void CHECK_WHISPERKIT_STATUS(whisperkit_status_t status) {
     if (status != WHISPERKIT_STATUS_SUCCESS) {
         throw std::runtime_error("WhisperKit error: " + std::to_string(status));
     }
 }
 
-WhisperKitRunner::WhisperKitRunner(WhisperKitConfig& config) : config(config) {
+WhisperKitRunner::WhisperKitRunner(WhisperKitConfig& config) : transcriptionResult(nullptr), config(config) {
     whisperkit_status_t status = WHISPERKIT_STATUS_SUCCESS;
     status = whisperkit_configuration_create(&configuration);
     CHECK_WHISPERKIT_STATUS(status);
@@ -48,8 +103,16 @@ WhisperKitRunner::WhisperKitRunner(WhisperKitConfig& config) : config(config) {
     status = whisperkit_pipeline_create(&pipeline);
     CHECK_WHISPERKIT_STATUS(status);
 
-    status = whisperkit_configuration_set_backends(configuration, config.encoder_backend, config.decoder_backend);
-    CHECK_WHISPERKIT_STATUS(status);
+    if (config.backendsSet) {
+        status = whisperkit_configuration_set_backends(configuration, config.encoder_backend, config.decoder_backend);
+        CHECK_WHISPERKIT_STATUS(status);
+    }
+}
+
+static void print_token(const whisperkit_token_t* token, void* userData) {
+    if (token->text[0] == '\0') return;
+    std::cout << "  token #" << token->chunk_index << " @" << token->timestamp << " (logprob " << token->logprob
+              << "): " << token->text << std::endl;
 }
 
 void WhisperKitRunner::buildPipeline() {
@@ -65,11 +128,109 @@ void WhisperKitRunner::buildPipeline() {
     status = whisperkit_configuration_set_verbose(configuration, config.verbose);
     CHECK_WHISPERKIT_STATUS(status);
 
+    status = whisperkit_configuration_set_prewarm(configuration, config.prewarm);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_load(configuration, config.load);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_autotune(configuration, config.autotune);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_low_memory(configuration, config.lowMemory);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_benchmark_decoder_state(configuration, config.benchmarkDecoderState);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_staged(configuration, config.staged);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_vad_packing(configuration, config.vadPacking);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_parallel_chunks(configuration, config.parallelChunks);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_concurrent_workers(configuration, config.concurrentWorkerCount);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_deadline_ms(configuration, config.deadlineMs);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_stream_interval_ms(configuration, config.streamIntervalMs);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_endpoint_hangover_ms(configuration, config.endpointHangoverMs);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_overload_policy(configuration, config.overloadPolicy, config.maxBacklogMs);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_cascade(configuration, config.cascadeModelPath.c_str(),
+                                                  config.logprobThreshold, config.compressionRatioThreshold,
+                                                  config.noSpeechThreshold);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_thread_policy(configuration, config.threadPolicy);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_stage_threads(configuration, WHISPERKIT_STAGE_ENCODER, config.encoderThreads);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_configuration_set_stage_threads(configuration, WHISPERKIT_STAGE_DECODER, config.decoderThreads);
+    CHECK_WHISPERKIT_STATUS(status);
+
     status = whisperkit_pipeline_set_configuration(pipeline, configuration);
     CHECK_WHISPERKIT_STATUS(status);
 
     status = whisperkit_pipeline_build(pipeline);
     CHECK_WHISPERKIT_STATUS(status);
+
+    if (config.tokens) {
+        status = whisperkit_pipeline_set_token_callback(pipeline, print_token, nullptr);
+        CHECK_WHISPERKIT_STATUS(status);
+    }
+
+    for (int i = 1; i < config.numPipelines; i++) {
+        whisperkit_pipeline_t* extraPipeline = nullptr;
+        status = whisperkit_pipeline_create(&extraPipeline);
+        CHECK_WHISPERKIT_STATUS(status);
+        extraPipelines.push_back(extraPipeline);
+
+        status = whisperkit_pipeline_set_configuration(extraPipeline, configuration);
+        CHECK_WHISPERKIT_STATUS(status);
+
+        status = whisperkit_pipeline_build(extraPipeline);
+        CHECK_WHISPERKIT_STATUS(status);
+    }
+}
+
+// 16-bit PCM WAV file: samples are left interleaved, as whisperkit_pipeline_appendaudio takes them
+static bool read_wav(const std::string& path, std::vector<char>& pcm, int& sampleRate, int& channels) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    auto read16 = [&](size_t pos) { return (int)(uint8_t)data[pos] | ((int)(uint8_t)data[pos + 1] << 8); };
+    auto read32 = [&](size_t pos) { return (uint32_t)read16(pos) | ((uint32_t)read16(pos + 2) << 16); };
+
+    int bitsPerSample = 0;
+    for (size_t pos = 12; pos + 8 <= data.size();) {
+        uint32_t chunkSize = read32(pos + 4);
+        if (memcmp(data.data() + pos, "fmt ", 4) == 0 && pos + 24 <= data.size()) {
+            channels = read16(pos + 10);
+            sampleRate = (int)read32(pos + 12);
+            bitsPerSample = read16(pos + 22);
+        } else if (memcmp(data.data() + pos, "data", 4) == 0) {
+            size_t end = std::min(data.size(), pos + 8 + chunkSize);
+            pcm.assign(data.begin() + pos + 8, data.begin() + end);
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    return bitsPerSample == 16 && sampleRate > 0 && channels > 0 && !pcm.empty();
 }
 
 void WhisperKitRunner::transcribe() {
@@ -78,8 +239,58 @@ void WhisperKitRunner::transcribe() {
     status = whisperkit_transcription_result_create(&transcriptionResult);
     CHECK_WHISPERKIT_STATUS(status);
 
-    status = whisperkit_pipeline_transcribe(pipeline, config.audioPath.c_str(), transcriptionResult);
-    CHECK_WHISPERKIT_STATUS(status);
+    // --from-memory: the file is read up front, and passed as it would come from the network
+    std::vector<char> audio;
+    whisperkit_audio_format_t format = {WHISPERKIT_SAMPLE_FORMAT_ENCODED, 0, 0};
+    if (config.fromMemory == "pcm") {
+        if (!read_wav(config.audioPath, audio, format.sample_rate, format.num_channels)) {
+            throw std::runtime_error("--from-memory pcm needs a 16-bit PCM WAV file: " + config.audioPath);
+        }
+        format.sample_format = WHISPERKIT_SAMPLE_FORMAT_S16;
+    } else if (config.fromMemory == "encoded") {
+        std::ifstream file(config.audioPath, std::ios::binary);
+        audio.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else if (!config.fromMemory.empty()) {
+        throw std::runtime_error("Unknown --from-memory: " + config.fromMemory);
+    }
+
+    // the first clip pays for the pipeline's one-time setup, the others only for their own
+    double firstMs = 0, repeatMs = 0;
+    for (int i = 0; i < config.repeat; i++) {
+        auto before = std::chrono::steady_clock::now();
+        if (config.fromMemory.empty()) {
+            status = whisperkit_pipeline_transcribe(pipeline, config.audioPath.c_str(), transcriptionResult);
+        } else {
+            status = whisperkit_pipeline_transcribe_buffer(pipeline, audio.data(), audio.size(), &format,
+                                                           transcriptionResult);
+        }
+        auto clipMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+        if (status == WHISPERKIT_STATUS_DEADLINE_EXCEEDED) {
+            std::cout << "Deadline of " << config.deadlineMs << " ms exceeded, the transcription is partial"
+                      << std::endl;
+        } else {
+            CHECK_WHISPERKIT_STATUS(status);
+        }
+        (i == 0 ? firstMs : repeatMs) += clipMs;
+    }
+    if (config.repeat > 1) {
+        std::cout << "Per clip: " << firstMs << " ms first, " << repeatMs / (config.repeat - 1)
+                  << " ms on average after" << std::endl;
+    }
+
+    if (config.segments) {
+        int count = 0;
+        status = whisperkit_transcription_result_get_segment_count(transcriptionResult, &count);
+        CHECK_WHISPERKIT_STATUS(status);
+        for (int i = 0; i < count; i++) {
+            const whisperkit_result_segment_t* segment = nullptr;
+            status = whisperkit_transcription_result_get_segment(transcriptionResult, i, &segment);
+            CHECK_WHISPERKIT_STATUS(status);
+            std::cout << "[" << segment->start_time << " - " << segment->end_time << "] " << segment->num_tokens
+                      << " tokens, avg logprob " << segment->avg_logprob << ", no speech " << segment->no_speech_prob
+                      << ": " << segment->text << std::endl;
+        }
+    }
 
     char* transcription = nullptr;
     status = whisperkit_transcription_result_get_all_transcription(transcriptionResult, &transcription);
@@ -90,7 +301,311 @@ void WhisperKitRunner::transcribe() {
     }
 }
 
+void WhisperKitRunner::transcribeBatch() {
+    whisperkit_status_t status = WHISPERKIT_STATUS_SUCCESS;
+
+    std::vector<std::string> audioFiles;
+    std::ifstream audioList(config.audioListPath);
+    if (!audioList.is_open()) {
+        throw std::runtime_error("Cannot open audio list: " + config.audioListPath);
+    }
+    for (std::string line; std::getline(audioList, line);) {
+        if (!line.empty()) audioFiles.push_back(line);
+    }
+
+    std::vector<const char*> audioFilePaths;
+    std::vector<whisperkit_transcription_result_t*> results(audioFiles.size(), nullptr);
+    for (size_t i = 0; i < audioFiles.size(); i++) {
+        audioFilePaths.push_back(audioFiles[i].c_str());
+        status = whisperkit_transcription_result_create(&results[i]);
+        CHECK_WHISPERKIT_STATUS(status);
+    }
+
+    status = whisperkit_pipeline_transcribe_batch(pipeline, audioFilePaths.data(), (int)audioFilePaths.size(),
+                                                  results.data());
+
+    // on TRANSCRIPTION_FAILED, the files that did not fail still have their transcriptions
+    bool transcribed = status == WHISPERKIT_STATUS_SUCCESS || status == WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    for (size_t i = 0; i < results.size(); i++) {
+        char* transcription = nullptr;
+        if (transcribed &&
+            whisperkit_transcription_result_get_all_transcription(results[i], &transcription) ==
+                WHISPERKIT_STATUS_SUCCESS &&
+            transcription != nullptr) {
+            std::cout << audioFiles[i] << ": " << transcription << std::endl;
+            free((void*)transcription);
+        }
+        whisperkit_transcription_result_destroy(&results[i]);
+    }
+    CHECK_WHISPERKIT_STATUS(status);
+}
+
+static void print_segment(const whisperkit_segment_t* segment, void* userData) {
+    std::cout << "[" << segment->start_time << " - " << segment->end_time << "] #" << segment->chunk_index
+              << (segment->partial ? " (partial)" : "") << ": " << segment->text << std::endl;
+}
+
+// a kB field of /proc/self/status, e.g. VmRSS or VmHWM
+static long proc_status_kb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind(field + ":", 0) == 0) return std::stol(line.substr(field.size() + 1));
+    }
+    return 0;
+}
+
+// peak resident set size of the process, in kB
+static long peak_rss_kb() { return proc_status_kb("VmHWM"); }
+
+// with --report, a flat JSON object of measurements next to the library's reports, for the test harness
+static void write_cli_report(const WhisperKitConfig& config, const std::string& name,
+                             const std::vector<std::pair<std::string, double>>& values) {
+    if (!config.report) return;
+    std::ofstream report(config.reportPath + "/" + name);
+    report << "{";
+    for (size_t i = 0; i < values.size(); i++) {
+        report << (i > 0 ? ", " : "") << "\"" << values[i].first << "\": " << values[i].second;
+    }
+    report << "}" << std::endl;
+}
+
+static void print_overload(const whisperkit_overload_t* overload, void* userData) {
+    std::cout << (overload->overloaded ? "Overloaded" : "Caught up") << ": " << overload->backlog_ms
+              << " ms backlog, " << overload->dropped_ms << " ms dropped, real-time factor "
+              << overload->real_time_factor << std::endl;
+}
+
+void WhisperKitRunner::transcribeStream() {
+    whisperkit_status_t status = WHISPERKIT_STATUS_SUCCESS;
+
+    std::vector<char> pcm;
+    int sampleRate = 0, channels = 0;
+    if (!read_wav(config.audioPath, pcm, sampleRate, channels)) {
+        throw std::runtime_error("Streaming needs a 16-bit PCM WAV file: " + config.audioPath);
+    }
+    // utterances separated by silence, e.g. to measure endpointing latency
+    const size_t gapBytes = (size_t)sampleRate * config.streamGapMs / 1000 * channels * 2;
+    const auto speech = pcm;
+    pcm.clear();
+    for (int i = 0; i < config.streamRepeat; i++) {
+        pcm.insert(pcm.end(), speech.begin(), speech.end());
+        pcm.insert(pcm.end(), gapBytes, 0);
+    }
+
+    status = whisperkit_transcription_result_create(&transcriptionResult);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_pipeline_set_segment_callback(pipeline, print_segment, nullptr);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_pipeline_set_overload_callback(pipeline, print_overload, nullptr);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    if (!config.swapModelPath.empty()) {
+        status = whisperkit_pipeline_preload_model(pipeline, config.swapModelPath.c_str());
+        CHECK_WHISPERKIT_STATUS(status);
+    }
+
+    const long startRssKb = proc_status_kb("VmRSS");
+    status = whisperkit_pipeline_initstreaming(pipeline, transcriptionResult, sampleRate, channels);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    // 100ms of audio per append, at the pace a microphone delivers it; a faster --stream-speed
+    // stands in for a device that slow, to push the pipeline into overload
+    const size_t blockBytes = (size_t)sampleRate * channels * 2 / 10;
+    const auto blockDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(100 / config.streamSpeed));
+    auto nextAppend = std::chrono::steady_clock::now();
+    std::vector<double> appendMs;
+    const size_t swapPos = (size_t)sampleRate * config.swapAfterMs / 1000 * channels * 2;
+    bool swapped = config.swapModelPath.empty();
+
+    for (size_t pos = 0; pos < pcm.size(); pos += blockBytes) {
+        std::this_thread::sleep_until(nextAppend);
+        nextAppend += blockDuration;
+
+        if (!swapped && pos >= swapPos) {
+            // waits for the preload, if it is still running
+            auto before = std::chrono::steady_clock::now();
+            status = whisperkit_pipeline_swap_model(pipeline);
+            CHECK_WHISPERKIT_STATUS(status);
+            std::cout << "Swapped to " << config.swapModelPath << " after " << config.swapAfterMs << " ms of audio, in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count()
+                      << " ms" << std::endl;
+            swapped = true;
+        }
+
+        int size = (int)std::min(blockBytes, pcm.size() - pos);
+        int transcribed = 0;
+        auto before = std::chrono::steady_clock::now();
+        status = whisperkit_pipeline_appendaudio(pipeline, size, pcm.data() + pos, &transcribed);
+        auto after = std::chrono::steady_clock::now();
+        CHECK_WHISPERKIT_STATUS(status);
+
+        appendMs.push_back(std::chrono::duration<double, std::milli>(after - before).count());
+    }
+
+    float realTimeFactor = 0;
+    status = whisperkit_pipeline_get_real_time_factor(pipeline, &realTimeFactor);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    status = whisperkit_pipeline_closestreaming(pipeline);
+    CHECK_WHISPERKIT_STATUS(status);
+
+    const long rssGrowthKb = peak_rss_kb() - startRssKb;
+    std::sort(appendMs.begin(), appendMs.end());
+    const double p50AppendMs = appendMs.empty() ? 0 : appendMs[appendMs.size() / 2];
+    const double maxAppendMs = appendMs.empty() ? 0 : appendMs.back();
+    std::cout << "Append latency: " << p50AppendMs << " ms median, " << maxAppendMs << " ms max" << std::endl;
+    std::cout << "Real-time factor: " << realTimeFactor << ", peak RSS growth: " << rssGrowthKb / 1024 << " MB"
+              << std::endl;
+    write_cli_report(config, "output_stream.json",
+                     {{"appends", appendMs.size()},
+                      {"appendMsP50", p50AppendMs},
+                      {"appendMsMax", maxAppendMs},
+                      {"realTimeFactor", realTimeFactor},
+                      {"rssGrowthMB", rssGrowthKb / 1024.0}});
+}
+
+// how late a live session's segments are, behind the audio they transcribe
+struct SessionLateness {
+    std::chrono::steady_clock::time_point start;
+    double maxLateMs = 0;
+    int segments = 0;
+};
+
+static void measure_lateness(const whisperkit_segment_t* segment, void* userData) {
+    auto* lateness = static_cast<SessionLateness*>(userData);
+    auto spoken = lateness->start + std::chrono::duration<double>(segment->end_time);
+    auto lateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - spoken).count();
+    lateness->maxLateMs = std::max(lateness->maxLateMs, lateMs);
+    lateness->segments++;
+}
+
+void WhisperKitRunner::transcribeSessions() {
+    std::vector<char> pcm;
+    int sampleRate = 0, channels = 0;
+    if (!read_wav(config.audioPath, pcm, sampleRate, channels)) {
+        throw std::runtime_error("Sessions need a 16-bit PCM WAV file: " + config.audioPath);
+    }
+
+    // with --audio-list, the batch runs on the same pipeline and the sessions are live, paced at real time;
+    // otherwise every stream replays the file as fast as it is taken.  Both in 100ms appends
+    const bool mixed = !config.audioListPath.empty();
+    if (mixed && config.pipelinePerSession) {
+        throw std::runtime_error("--pipeline-per-session does not run next to --audio-list");
+    }
+    const size_t blockBytes = (size_t)sampleRate * channels * 2 / 10;
+    auto feed = [&](const std::function<whisperkit_status_t(int, char*)>& append) {
+        auto nextAppend = std::chrono::steady_clock::now();
+        for (size_t pos = 0; pos < pcm.size(); pos += blockBytes) {
+            if (mixed) {
+                std::this_thread::sleep_until(nextAppend);
+                nextAppend += std::chrono::milliseconds(100);
+            }
+            CHECK_WHISPERKIT_STATUS(append((int)std::min(blockBytes, pcm.size() - pos), pcm.data() + pos));
+        }
+    };
+    // the first error of a stream or the batch, rethrown once all threads are done
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto guarded = [&](std::function<void()> body) {
+        return [&, body] {
+            try {
+                body();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+            }
+        };
+    };
+
+    std::vector<SessionLateness> lateness(config.sessions);
+    std::thread batch;
+    if (mixed) {
+        batch = std::thread(guarded([this] { transcribeBatch(); }));
+    }
+
+    std::vector<whisperkit_transcription_result_t*> results(config.sessions, nullptr);
+    for (auto& result : results) {
+        CHECK_WHISPERKIT_STATUS(whisperkit_transcription_result_create(&result));
+    }
+
+    std::vector<std::thread> streams;
+    auto start = std::chrono::steady_clock::now();
+    if (config.pipelinePerSession) {
+        // baseline: each stream streams through a pipeline of its own
+        std::vector<whisperkit_pipeline_t*> pipelines = {pipeline};
+        pipelines.insert(pipelines.end(), extraPipelines.begin(), extraPipelines.end());
+        for (int i = 0; i < config.sessions; i++) {
+            streams.emplace_back(guarded([&, i] {
+                auto* streamPipeline = pipelines[i];
+                CHECK_WHISPERKIT_STATUS(
+                    whisperkit_pipeline_initstreaming(streamPipeline, results[i], sampleRate, channels));
+                feed([&](int size, char* buffer) {
+                    int transcribed = 0;
+                    return whisperkit_pipeline_appendaudio(streamPipeline, size, buffer, &transcribed);
+                });
+                CHECK_WHISPERKIT_STATUS(whisperkit_pipeline_closestreaming(streamPipeline));
+            }));
+        }
+    } else {
+        for (int i = 0; i < config.sessions; i++) {
+            streams.emplace_back(guarded([&, i] {
+                whisperkit_session_t* session = nullptr;
+                lateness[i].start = std::chrono::steady_clock::now();
+                CHECK_WHISPERKIT_STATUS(whisperkit_pipeline_open_session(pipeline, sampleRate, channels,
+                                                                         measure_lateness, &lateness[i], &session));
+                feed([&](int size, char* buffer) { return whisperkit_session_appendaudio(session, size, buffer); });
+                CHECK_WHISPERKIT_STATUS(whisperkit_session_close(&session, results[i]));
+            }));
+        }
+    }
+    for (auto& stream : streams) {
+        stream.join();
+    }
+    auto wallSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (batch.joinable()) batch.join();
+
+    for (int i = 0; i < config.sessions; i++) {
+        char* transcription = nullptr;
+        if (whisperkit_transcription_result_get_all_transcription(results[i], &transcription) ==
+                WHISPERKIT_STATUS_SUCCESS &&
+            transcription != nullptr) {
+            if (config.verbose) std::cout << "Session " << i << ": " << transcription << std::endl;
+            free((void*)transcription);
+        }
+        whisperkit_transcription_result_destroy(&results[i]);
+    }
+    if (failure) std::rethrow_exception(failure);
+
+    // every stream is done when the last one is: real time as long as the factor stays below 1
+    const double audioSecs = (double)pcm.size() / (sampleRate * channels * 2);
+    std::cout << (config.pipelinePerSession ? "Pipeline per session" : "Shared pipeline") << ": "
+              << config.sessions << " session(s), real-time factor " << wallSecs / audioSecs << ", peak RSS "
+              << peak_rss_kb() / 1024 << " MB" << std::endl;
+    std::vector<std::pair<std::string, double>> report = {{"sessions", config.sessions},
+                                                          {"realTimeFactor", wallSecs / audioSecs}};
+    if (mixed) {
+        // the worst session: the latest segment, and the fewest segments
+        double maxLateMs = 0;
+        int minSegments = lateness.empty() ? 0 : lateness[0].segments;
+        for (int i = 0; i < config.sessions; i++) {
+            std::cout << "Session " << i << ": " << lateness[i].segments << " segment(s), at most "
+                      << lateness[i].maxLateMs << " ms behind the audio" << std::endl;
+            maxLateMs = std::max(maxLateMs, lateness[i].maxLateMs);
+            minSegments = std::min(minSegments, lateness[i].segments);
+        }
+        report.push_back({"maxLateMs", maxLateMs});
+        report.push_back({"minSegments", minSegments});
+    }
+    write_cli_report(config, "output_sessions.json", report);
+}
+
 WhisperKitRunner::~WhisperKitRunner() {
+    for (auto& extraPipeline : extraPipelines) {
+        whisperkit_pipeline_destroy(&extraPipeline);
+    }
     if (pipeline) {
         whisperkit_pipeline_destroy(&pipeline);
     }
@@ -109,15 +624,88 @@ int main(int argc, char* argv[]) {
         cxxopts::Options options("whisperkit-cli", "WhisperKit CLI for Android & Linux");
 
         options.add_options("transcribe")("h,help", "Print help")(
-            "a,audio-path", "Path to audio file", cxxopts::value<std::string>())("m,model-path", "Path of model files",
+            "a,audio-path", "Path to audio file", cxxopts::value<std::string>())(
+            "audio-list", "Text file with one audio file path per line, transcribed as a batch",
+            cxxopts::value<std::string>())(
+            "concurrent-worker-count", "Runtime replicas transcribing a batch concurrently",
+            cxxopts::value<int>()->default_value("4"))(
+            "stream-interval-ms",
+            "With --stream, re-decode the uncommitted audio every this many ms instead of 30 s chunks, 0 for off",
+            cxxopts::value<int>()->default_value("0"))(
+            "endpoint-hangover-ms", "With --stream, transcribe as soon as speech is followed by this much silence",
+            cxxopts::value<int>()->default_value("0"))(
+            "stream-repeat", "With --stream, number of times the audio is replayed, as separate utterances",
+            cxxopts::value<int>()->default_value("1"))(
+            "repeat", "Transcribe the audio file this many times on the same pipeline, to measure per-clip overhead",
+            cxxopts::value<int>()->default_value("1"))(
+            "from-memory", "Read the audio file into memory and transcribe it from there: encoded/pcm (16-bit WAV)",
+            cxxopts::value<std::string>())(
+            "segments", "Print the transcribed segments, with their timestamps and confidence",
+            cxxopts::value<bool>()->default_value("false"))(
+            "tokens", "Print the text of each token as it is decoded, ahead of its segment",
+            cxxopts::value<bool>()->default_value("false"))(
+            "stream-gap-ms", "With --stream, silence appended after each replay of the audio",
+            cxxopts::value<int>()->default_value("0"))(
+            "deadline-ms", "Stop transcribing after this many ms and keep the partial result, 0 for none",
+            cxxopts::value<int>()->default_value("0"))(
+            "stream", "Stream a 16-bit WAV file at real-time pace through the segment callback",
+            cxxopts::value<bool>()->default_value("false"))(
+            "overload-policy", "With --stream, what to do once over --max-backlog-ms: "
+            "block/drop/drop-silence/reduce-decoding",
+            cxxopts::value<std::string>()->default_value("block"))(
+            "max-backlog-ms", "With --stream, audio waiting to be transcribed before the overload policy applies",
+            cxxopts::value<int>()->default_value("0"))(
+            "stream-speed", "With --stream, append audio this many times faster than real time",
+            cxxopts::value<float>()->default_value("1"))(
+            "swap-model-path", "With --stream, models preloaded while streaming and swapped to after --swap-after-ms",
+            cxxopts::value<std::string>())(
+            "swap-after-ms", "With --swap-model-path, audio streamed with the models of --model-path",
+            cxxopts::value<int>()->default_value("0"))("m,model-path", "Path of model files",
                                                                                  cxxopts::value<std::string>())(
+            "cascade-model-path", "Larger model that redoes the chunks the model of --model-path is unsure of",
+            cxxopts::value<std::string>())(
+            "logprob-threshold", "With --cascade-model-path, escalate chunks below this average token logprob",
+            cxxopts::value<float>()->default_value("-1"))(
+            "compression-ratio-threshold", "With --cascade-model-path, escalate chunks above this compression ratio",
+            cxxopts::value<float>()->default_value("2.4"))(
+            "no-speech-threshold", "With --cascade-model-path, no speech probability above which chunks are silence",
+            cxxopts::value<float>()->default_value("0.6"))(
             "r,report", "Output a report of the results", cxxopts::value<bool>()->default_value("false"))(
             "p,report-path", "Directory to save the report", cxxopts::value<std::string>()->default_value("."))(
-            "v,verbose", "Verbose mode for debug", cxxopts::value<bool>()->default_value("false"))
+            "v,verbose", "Verbose mode for debug", cxxopts::value<bool>()->default_value("false"))(
+            "prewarm", "Prewarm models while building the pipeline", cxxopts::value<bool>()->default_value("false"))(
+            "lazy-load", "Defer model loading to the first transcription",
+            cxxopts::value<bool>()->default_value("false"))(
+            "autotune", "Benchmark model configurations and store a tuning profile in the cache dir",
+            cxxopts::value<bool>()->default_value("false"))(
+            "low-memory", "Release interpreter scratch memory between pipeline stages",
+            cxxopts::value<bool>()->default_value("false"))(
+            "benchmark-decoder-state", "Time decoder state save & restore while building, for the report",
+            cxxopts::value<bool>()->default_value("false"))(
+            "staged", "Run audio ingest, mel/encoder and decoder on separate threads",
+            cxxopts::value<bool>()->default_value("false"))(
+            "parallel-chunks", "Transcribe the chunks of a file concurrently on --concurrent-worker-count replicas",
+            cxxopts::value<bool>()->default_value("false"))(
+            "vad-packing", "Pack the speech of a file into as few encoder windows as possible",
+            cxxopts::value<bool>()->default_value("false"))(
+            "num-pipelines", "Number of pipelines to build with the same model (memory benchmark)",
+            cxxopts::value<int>()->default_value("1"))(
+            "sessions", "Transcribe the WAV file as this many concurrent streaming sessions of one pipeline",
+            cxxopts::value<int>()->default_value("0"))(
+            "pipeline-per-session", "With --sessions, stream each session through a pipeline of its own instead",
+            cxxopts::value<bool>()->default_value("false"))(
+            "thread-policy", "Thread placement: default/topology",
+            cxxopts::value<std::string>()->default_value("default"))(
+            "encoder-threads", "Encoder thread count, 0 for the thread policy's choice",
+            cxxopts::value<int>()->default_value("0"))(
+            "decoder-threads", "Decoder thread count, 0 for the thread policy's choice",
+            cxxopts::value<int>()->default_value("0"))(
+            "encoder-backend", "Encoder compute unit, overrides --compute-unit", cxxopts::value<std::string>())(
+            "decoder-backend", "Decoder compute unit, overrides --compute-unit", cxxopts::value<std::string>())
 #if QNN_DELEGATE
-            ("c,compute-unit", "CPU/GPU/NPU", cxxopts::value<std::string>()->default_value("NPU"));
+            ("c,compute-unit", "CPU/CPU_BUILTIN/GPU/NPU", cxxopts::value<std::string>()->default_value("NPU"));
 #else
-            ("c,compute-unit", "CPU/GPU", cxxopts::value<std::string>()->default_value("GPU"));
+            ("c,compute-unit", "CPU/CPU_BUILTIN/GPU", cxxopts::value<std::string>()->default_value("GPU"));
 #endif
 
         auto result = options.parse(argc, argv);
@@ -130,9 +718,18 @@ int main(int argc, char* argv[]) {
         if (result.count("audio-path")) {
             config.audioPath = result["audio-path"].as<std::string>();
         }
+        if (result.count("audio-list")) {
+            config.audioListPath = result["audio-list"].as<std::string>();
+        }
         if (result.count("model-path")) {
             config.modelPath = result["model-path"].as<std::string>();
         }
+        if (result.count("cascade-model-path")) {
+            config.cascadeModelPath = result["cascade-model-path"].as<std::string>();
+        }
+        config.logprobThreshold = result["logprob-threshold"].as<float>();
+        config.compressionRatioThreshold = result["compression-ratio-threshold"].as<float>();
+        config.noSpeechThreshold = result["no-speech-threshold"].as<float>();
         if (result.count("report")) {
             config.report = result["report"].as<bool>();
         }
@@ -143,19 +740,59 @@ int main(int argc, char* argv[]) {
             config.verbose = true;
             std::cout << "Verbose mode is ON." << std::endl;
         }
+        config.prewarm = result["prewarm"].as<bool>();
+        config.load = !result["lazy-load"].as<bool>();
+        config.parallelChunks = result["parallel-chunks"].as<bool>();
+        config.vadPacking = result["vad-packing"].as<bool>();
+        config.staged = result["staged"].as<bool>();
+        config.lowMemory = result["low-memory"].as<bool>();
+        config.benchmarkDecoderState = result["benchmark-decoder-state"].as<bool>();
+        config.autotune = result["autotune"].as<bool>();
+        config.concurrentWorkerCount = std::max(1, result["concurrent-worker-count"].as<int>());
+        config.stream = result["stream"].as<bool>();
+        config.deadlineMs = std::max(0, result["deadline-ms"].as<int>());
+        config.streamIntervalMs = std::max(0, result["stream-interval-ms"].as<int>());
+        config.endpointHangoverMs = std::max(0, result["endpoint-hangover-ms"].as<int>());
+        config.streamRepeat = std::max(1, result["stream-repeat"].as<int>());
+        config.repeat = std::max(1, result["repeat"].as<int>());
+        config.segments = result["segments"].as<bool>();
+        config.tokens = result["tokens"].as<bool>();
+        if (result.count("from-memory")) {
+            config.fromMemory = result["from-memory"].as<std::string>();
+        }
+        config.streamGapMs = std::max(0, result["stream-gap-ms"].as<int>());
+        config.overloadPolicy = parse_overload_policy(result["overload-policy"].as<std::string>());
+        config.maxBacklogMs = std::max(0, result["max-backlog-ms"].as<int>());
+        config.streamSpeed = std::max(0.1f, result["stream-speed"].as<float>());
+        if (result.count("swap-model-path")) {
+            config.swapModelPath = result["swap-model-path"].as<std::string>();
+        }
+        config.swapAfterMs = std::max(0, result["swap-after-ms"].as<int>());
+        config.numPipelines = std::max(1, result["num-pipelines"].as<int>());
+        config.sessions = std::max(0, result["sessions"].as<int>());
+        config.pipelinePerSession = result["pipeline-per-session"].as<bool>();
+        if (config.sessions > 0 && config.pipelinePerSession) {
+            config.numPipelines = config.sessions;
+        }
+        config.threadPolicy = (result["thread-policy"].as<std::string>() == "topology")
+                                  ? WHISPERKIT_THREAD_POLICY_TOPOLOGY
+                                  : WHISPERKIT_THREAD_POLICY_DEFAULT;
+        config.encoderThreads = std::max(0, result["encoder-threads"].as<int>());
+        config.decoderThreads = std::max(0, result["decoder-threads"].as<int>());
 
+        config.backendsSet =
+            result.count("compute-unit") || result.count("encoder-backend") || result.count("decoder-backend");
         if (result.count("compute-unit")) {
-            auto unit = result["compute-unit"].as<std::string>();
-            if (unit == "CPU") {
-                config.encoder_backend = WHISPERKIT_COMPUTE_BACKEND_CPU;
-                config.decoder_backend = WHISPERKIT_COMPUTE_BACKEND_CPU;
-            } else if (unit == "NPU") {
-                config.encoder_backend = WHISPERKIT_COMPUTE_BACKEND_NPU;
-                config.decoder_backend = WHISPERKIT_COMPUTE_BACKEND_NPU;
-            } else {
-                config.encoder_backend = WHISPERKIT_COMPUTE_BACKEND_GPU;
-                config.decoder_backend = WHISPERKIT_COMPUTE_BACKEND_GPU;
-            }
+            auto backend = parse_compute_unit(result["compute-unit"].as<std::string>());
+            config.encoder_backend = backend;
+            config.decoder_backend = backend;
+        }
+        // per model strategies, e.g. encoder on the GPU with the decoder on XNNPack
+        if (result.count("encoder-backend")) {
+            config.encoder_backend = parse_compute_unit(result["encoder-backend"].as<std::string>());
+        }
+        if (result.count("decoder-backend")) {
+            config.decoder_backend = parse_compute_unit(result["decoder-backend"].as<std::string>());
         }
     } catch (const cxxopts::exceptions::exception& e) {
         std::cerr << "Error parsing options: " << e.what() << std::endl;
@@ -165,7 +802,16 @@ int main(int argc, char* argv[]) {
 
     try {
         runner.buildPipeline();
-        runner.transcribe();
+        if (config.sessions > 0) {
+            // with --audio-list, next to the batch
+            runner.transcribeSessions();
+        } else if (!config.audioListPath.empty()) {
+            runner.transcribeBatch();
+        } else if (config.stream) {
+            runner.transcribeStream();
+        } else {
+            runner.transcribe();
+        }
 
     } catch (const std::exception& e) {
         std::cerr << "Error transcribing audio: " << e.what() << std::endl;
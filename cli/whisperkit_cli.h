@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "WhisperKit.h"
 #include "cxxopts.hpp"
@@ -10,7 +11,10 @@
 struct WhisperKitConfig {
    public:
     std::string audioPath;
+    std::string audioListPath;
     std::string modelPath;
+    std::string cascadeModelPath;
+    std::string swapModelPath;
     std::string audioEncoderComputeUnits;
     std::string textDecoderComputeUnits;
     float temperature;
@@ -23,10 +27,41 @@ struct WhisperKitConfig {
     float logprobThreshold;
     float firstTokenLogProbThreshold;
     float noSpeechThreshold;
+    float compressionRatioThreshold;
     bool report;
     std::string reportPath;
     int concurrentWorkerCount;
+    bool stream;
+    int streamIntervalMs;
+    int endpointHangoverMs;
+    int streamRepeat;
+    int repeat;
+    std::string fromMemory;
+    bool segments;
+    bool tokens;
+    int streamGapMs;
+    int deadlineMs;
+    whisperkit_overload_policy_t overloadPolicy;
+    int maxBacklogMs;
+    float streamSpeed;
+    int swapAfterMs;
     bool verbose;
+    bool prewarm;
+    bool load;
+    int numPipelines;
+    int sessions;
+    bool pipelinePerSession;
+    bool autotune;
+    bool lowMemory;
+    bool benchmarkDecoderState;
+    bool staged;
+    bool vadPacking;
+    bool parallelChunks;
+    whisperkit_thread_policy_t threadPolicy;
+    int encoderThreads;
+    int decoderThreads;
+    // from the command line; otherwise a stored tuning profile may choose the backends
+    bool backendsSet;
     whisperkit_backend_t encoder_backend;
     whisperkit_backend_t decoder_backend;
 
@@ -41,11 +76,16 @@ class WhisperKitRunner {
     ~WhisperKitRunner();
     void buildPipeline();
     void transcribe();
+    void transcribeBatch();
+    void transcribeStream();
+    void transcribeSessions();
     whisperkit_transcription_result_t* transcriptionResult;
 
    private:
     WhisperKitConfig& config;
     whisperkit_pipeline_t* pipeline;
+    // additional pipelines of the same model, built to measure memory sharing
+    std::vector<whisperkit_pipeline_t*> extraPipelines;
     whisperkit_configuration_t* configuration;
 };
 
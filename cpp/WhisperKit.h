@@ -3,6 +3,8 @@
 //  For licensing see accompanying LICENSE.md file.
 //  Copyright © 2024 Argmax, Inc. All rights reserved.
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,6 +34,8 @@ typedef enum {
     WHISPERKIT_STATUS_ERROR_DECODING_FAILED = 11,
     WHISPERKIT_STATUS_ERROR_MICROPHONE_UNAVAILABLE = 12,
     WHISPERKIT_STATUS_ERROR_INVALID_STATE = 13,
+    WHISPERKIT_STATUS_CANCELLED = 14,
+    WHISPERKIT_STATUS_DEADLINE_EXCEEDED = 15,
     WHISPERKIT_STATUS_ERROR_GENERIC = 1000,
 } whisperkit_status_t;
 
@@ -50,16 +54,75 @@ typedef enum {
 
 /** \brief WhisperKit compute backend enum codes
  *
- *  Compute backend codes for WhisperKit.
+ *  Compute backend codes for WhisperKit. The backend is selected per model at runtime;
+ *  a model whose graph is rejected by its delegate falls back to CPU, then to CPU_BUILTIN.
+ *  CPU runs the XNNPack delegate, CPU_BUILTIN the TFLite builtin kernels without delegate.
  */
 typedef enum {
     WHISPERKIT_COMPUTE_BACKEND_NONE = 0,
     WHISPERKIT_COMPUTE_BACKEND_CPU = 1,
     WHISPERKIT_COMPUTE_BACKEND_GPU = 2,
     WHISPERKIT_COMPUTE_BACKEND_NPU = 3,
+    WHISPERKIT_COMPUTE_BACKEND_CPU_BUILTIN = 4,
     WHISPERKIT_COMPUTE_BACKEND_INVALID = 999,
 } whisperkit_backend_t;
 
+/** \brief WhisperKit thread policy enum codes
+ *
+ *  Thread placement policies for the models of the WhisperKit pipeline.
+ *  DEFAULT runs every model with (number of cores - 1) threads and no affinity.
+ *  TOPOLOGY reads the CPU topology (core capacities, clusters, SMT siblings) and
+ *  places the encoder on the big cores, the decoder on 1-2 big cores and the
+ *  audio processing on a little core.
+ */
+typedef enum {
+    WHISPERKIT_THREAD_POLICY_DEFAULT = 0,
+    WHISPERKIT_THREAD_POLICY_TOPOLOGY = 1,
+    WHISPERKIT_THREAD_POLICY_INVALID = 999,
+} whisperkit_thread_policy_t;
+
+/** \brief WhisperKit pipeline stage enum codes
+ *
+ *  Pipeline stages that can be configured with their own thread count.  Audio processing
+ *  (resampling & VAD) always runs on a single thread: only the thread policy's cpu set applies
+ *  to WHISPERKIT_STAGE_AUDIO.
+ */
+typedef enum {
+    WHISPERKIT_STAGE_AUDIO = 0,
+    WHISPERKIT_STAGE_MELSPECTROGRAM = 1,
+    WHISPERKIT_STAGE_ENCODER = 2,
+    WHISPERKIT_STAGE_DECODER = 3,
+} whisperkit_stage_t;
+
+/** \brief WhisperKit overload policy enum codes
+ *
+ *  What streaming does with appended audio when transcription falls behind by more than the maximum
+ *  backlog (see whisperkit_configuration_set_overload_policy).
+ *  BLOCK makes whisperkit_pipeline_appendaudio wait until the pipeline's queues have room.
+ *  DROP_AUDIO drops the audio appended while over the backlog.
+ *  DROP_SILENCE drops silent audio while over the backlog, and any audio while over twice the backlog.
+ *  REDUCE_DECODING caps the decoding steps per chunk while over the backlog, trading the end of long
+ *  segments for speed, and drops audio while over twice the backlog.
+ */
+typedef enum {
+    WHISPERKIT_OVERLOAD_POLICY_BLOCK = 0,
+    WHISPERKIT_OVERLOAD_POLICY_DROP_AUDIO = 1,
+    WHISPERKIT_OVERLOAD_POLICY_DROP_SILENCE = 2,
+    WHISPERKIT_OVERLOAD_POLICY_REDUCE_DECODING = 3,
+} whisperkit_overload_policy_t;
+
+/** \brief WhisperKit sample format enum codes
+ *
+ *  How whisperkit_pipeline_transcribe_buffer reads the audio it is given.
+ *  ENCODED audio is in any container & codec the audio file decoder reads (WAV, MP3, M4A, FLAC, ...).
+ *  S16 and FLOAT are raw PCM, interleaved if there are two channels.
+ */
+typedef enum {
+    WHISPERKIT_SAMPLE_FORMAT_ENCODED = 0,
+    WHISPERKIT_SAMPLE_FORMAT_S16 = 1,
+    WHISPERKIT_SAMPLE_FORMAT_FLOAT = 2,
+} whisperkit_sample_format_t;
+
 #pragma mark - Configuration
 
 /** \brief WhisperKit configuration object.
@@ -85,6 +148,103 @@ typedef struct whisperkit_pipeline_t whisperkit_pipeline_t;
  */
 typedef struct whisperkit_transcription_result_t whisperkit_transcription_result_t;
 
+/** \brief WhisperKit streaming session
+ *
+ *  An opaque object for one of many concurrent audio streams transcribed by a single pipeline.
+ *  The object is created by whisperkit_pipeline_open_session(), and destroyed by whisperkit_session_close().
+ */
+typedef struct whisperkit_session_t whisperkit_session_t;
+
+/** \brief WhisperKit transcribed segment
+ *
+ *  The transcription of one audio chunk, passed to the segment callback.
+ *  Times are in seconds from the start of the audio; text is only valid during the callback.
+ */
+typedef struct {
+    int chunk_index;
+    float start_time;
+    float end_time;
+    const char *text;
+    bool partial;  // low latency streaming: the text may still change, and is replaced by the next segment
+} whisperkit_segment_t;
+
+/** \brief WhisperKit result segment
+ *
+ *  A transcribed segment kept by a transcription result (see whisperkit_transcription_result_get_segment).
+ *  Times are in seconds from the start of the audio.  The segment and its tokens & text stay at the same
+ *  address until the result is destroyed.
+ */
+typedef struct {
+    float start_time;
+    float end_time;
+    const int *tokens;  // token ids, with the segment's timestamp tokens
+    int num_tokens;
+    float avg_logprob;     // of the tokens decoded for the segment's chunk
+    float no_speech_prob;  // of the segment's chunk
+    const char *text;
+} whisperkit_result_segment_t;
+
+/** \brief WhisperKit segment callback
+ *
+ *  Called on a pipeline thread for each transcribed segment, in audio order.
+ *  The callback should return quickly, as it holds up the transcription of the following chunks.
+ */
+typedef void (*whisperkit_segment_callback_t)(const whisperkit_segment_t *segment, void *user_data);
+
+/** \brief WhisperKit audio format
+ *
+ *  Describes the audio passed to whisperkit_pipeline_transcribe_buffer.  sample_rate and num_channels
+ *  are only read for raw PCM.
+ */
+typedef struct {
+    whisperkit_sample_format_t sample_format;
+    int sample_rate;
+    int num_channels;  // 1 or 2
+} whisperkit_audio_format_t;
+
+/** \brief WhisperKit decoded token
+ *
+ *  Passed to the token callback for each token as it is decoded, before its segment is complete.
+ *  text is what the token adds to the text of its segment so far, and is only valid during the callback.
+ *  It is empty for special and timestamp tokens, and for a token that ends inside a character, whose
+ *  text comes with the token completing it.  timestamp is at the segment's last timestamp token so far,
+ *  in seconds from the start of the audio.
+ */
+typedef struct {
+    int chunk_index;  // of the token's segment, as in whisperkit_segment_t
+    int token;
+    const char *text;
+    float timestamp;
+    float logprob;
+} whisperkit_token_t;
+
+/** \brief WhisperKit token callback
+ *
+ *  Called on a pipeline thread of its own, in decoding order, so the decoding does not wait for the text
+ *  to be detokenized.  The decoding never waits for the callback either: while a backlog of tokens fills
+ *  the pipeline's token queue, the tokens that do not fit are skipped, and their text comes with the next
+ *  token passed to the callback.  Tokens still skipped when their segment ends only reach the segment
+ *  callback.  The callback should return quickly to keep every token.
+ */
+typedef void (*whisperkit_token_callback_t)(const whisperkit_token_t *token, void *user_data);
+
+/** \brief WhisperKit overload notification
+ *
+ *  Passed to the overload callback when a stream starts or stops falling behind.
+ */
+typedef struct {
+    bool overloaded;         // true when the backlog went over the maximum, false once it halved again
+    float backlog_ms;        // audio waiting behind the chunk being transcribed
+    float dropped_ms;        // audio dropped by the overload policy since the stream started
+    float real_time_factor;  // recent transcription time over audio time, above 1 when falling behind
+} whisperkit_overload_t;
+
+/** \brief WhisperKit overload callback
+ *
+ *  Called on the thread appending audio; it should return quickly.
+ */
+typedef void (*whisperkit_overload_callback_t)(const whisperkit_overload_t *overload, void *user_data);
+
 #pragma mark - initializers
 
 /** \brief WhisperKit configuration initializer
@@ -162,25 +322,182 @@ whisperkit_status_t whisperkit_configuration_set_log_level(whisperkit_configurat
  *
  *  Prewarming can lead to faster first inference times, but increase peak memory or
  *  power consumption while initializing the pipeline.
+ *  When enabled, whisperkit_pipeline_build runs one dummy inference through the
+ *  MelSpectrogram, audio encoder and text decoder models.  Disabled by default.
  */
 whisperkit_status_t whisperkit_configuration_set_prewarm(whisperkit_configuration_t *config, bool prewarm);
 
-/** \brief Enable or disable prewarming for the WhisperKit pipeline
+/** \brief Enable or disable model loading at build time for the WhisperKit pipeline
  *
- *  Prewarming can lead to faster first inference times, but increase peak memory or
- *  power consumption while initializing the pipeline.
+ *  When disabled, whisperkit_pipeline_build only validates the model directory and the
+ *  models are loaded on the first transcription request instead.  This speeds up
+ *  application startup, at the cost of a slower first request.  Enabled by default.
  */
 whisperkit_status_t whisperkit_configuration_set_load(whisperkit_configuration_t *config, bool load);
 
 /** \brief Set the compute backends of encoder/decoder
  *  for the WhisperKit configuration object.
  *
- *  Sets the compute backends for the WhisperKit configuration object.
+ *  Sets the compute backends for the WhisperKit configuration object.  Backends set here are used
+ *  even when a stored tuning profile picked other ones (see whisperkit_configuration_set_autotune).
+ *  Without this call, the build's preferred delegate is used, unless a tuning profile picked another
+ *  backend.
  */
 whisperkit_status_t whisperkit_configuration_set_backends(whisperkit_configuration_t *config,
                                                           whisperkit_backend_t encoder_backend,
                                                           whisperkit_backend_t decoder_backend);
 
+/** \brief Set the thread placement policy for the WhisperKit pipeline
+ *
+ *  Selects how threads and cpu affinities are assigned to the pipeline stages.
+ *  Defaults to WHISPERKIT_THREAD_POLICY_DEFAULT.
+ */
+whisperkit_status_t whisperkit_configuration_set_thread_policy(whisperkit_configuration_t *config,
+                                                               whisperkit_thread_policy_t policy);
+
+/** \brief Set the number of threads for a pipeline stage
+ *
+ *  Overrides the thread count chosen by the thread policy for the given stage.
+ *  A value of 0 restores the policy's choice.  WHISPERKIT_STAGE_AUDIO is single threaded,
+ *  and is rejected with WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT.
+ */
+whisperkit_status_t whisperkit_configuration_set_stage_threads(whisperkit_configuration_t *config,
+                                                               whisperkit_stage_t stage, int num_threads);
+
+/** \brief Set the number of concurrent workers for batch transcription
+ *
+ *  Number of runtime replicas whisperkit_pipeline_transcribe_batch schedules audio chunks on.
+ *  Each replica holds its own interpreters; model files and tokenizers are shared.  Unless set
+ *  with whisperkit_configuration_set_stage_threads, the replicas split the cpu cores evenly.  A single
+ *  worker is a replica too: batches never run on the runtime whisperkit_pipeline_transcribe uses, whose
+ *  pipeline stages run on threads of their own.  Defaults to 1.
+ */
+whisperkit_status_t whisperkit_configuration_set_concurrent_workers(whisperkit_configuration_t *config,
+                                                                    int concurrent_workers);
+
+/** \brief Set the deadline of transcription requests
+ *
+ *  A whisperkit_pipeline_transcribe or whisperkit_pipeline_transcribe_batch call still running
+ *  deadline_ms after it started is stopped as with whisperkit_pipeline_cancel, and returns
+ *  WHISPERKIT_STATUS_DEADLINE_EXCEEDED with the partial transcription.  0 disables the deadline.
+ *  Defaults to 0.
+ */
+whisperkit_status_t whisperkit_configuration_set_deadline_ms(whisperkit_configuration_t *config, int deadline_ms);
+
+/** \brief Set the re-decode interval of low latency streaming
+ *
+ *  When non zero, streaming sessions don't wait for 30 seconds of audio: the audio appended since the
+ *  last committed segment is decoded again every stream_interval_ms of new audio, on a pipeline thread.
+ *  The text two consecutive decodes agree on is committed, delivered as a final segment and added to the
+ *  transcription result; the rest is delivered as a partial segment, which the next decode may revise.
+ *  The audio in front of the last committed segment is dropped from the window.  Lower intervals give
+ *  lower latency at the cost of more decoding.  Defaults to 0, which transcribes 30 second chunks.
+ */
+whisperkit_status_t whisperkit_configuration_set_stream_interval_ms(whisperkit_configuration_t *config,
+                                                                    int stream_interval_ms);
+
+/** \brief Set the endpointing hangover of streaming
+ *
+ *  When non zero, streaming sessions run voice activity detection on the appended audio, and once speech
+ *  is followed by endpoint_hangover_ms of silence, the audio buffered so far is transcribed right away
+ *  instead of waiting for 30 seconds of it.  Shorter hangovers answer sooner, but may split an utterance
+ *  at a pause.  Applies to 30 second chunk streaming, not to whisperkit_configuration_set_stream_interval_ms.
+ *  Defaults to 0, which disables endpointing.
+ */
+whisperkit_status_t whisperkit_configuration_set_endpoint_hangover_ms(whisperkit_configuration_t *config,
+                                                                      int endpoint_hangover_ms);
+
+/** \brief Set the overload policy of streaming
+ *
+ *  Streams transcribed on the pipeline's threads (with a segment callback, whisperkit_configuration_set_staged
+ *  or whisperkit_configuration_set_stream_interval_ms) queue the appended audio.  Once more than
+ *  max_backlog_ms of it waits behind the chunk being transcribed, policy applies; see
+ *  whisperkit_overload_policy_t.  With 30 second chunks, a backlog below 30000 ms is only reached when
+ *  chunks queue up.  Other streams transcribe on the appending thread and never build a backlog.
+ *  A max_backlog_ms of 0 disables the policies.  Defaults to WHISPERKIT_OVERLOAD_POLICY_BLOCK and 0.
+ */
+whisperkit_status_t whisperkit_configuration_set_overload_policy(whisperkit_configuration_t *config,
+                                                                 whisperkit_overload_policy_t policy,
+                                                                 int max_backlog_ms);
+
+/** \brief Set a larger model to escalate low confidence chunks to
+ *
+ *  Each chunk is transcribed with the model of whisperkit_configuration_set_model_path first.  The
+ *  chunk is transcribed again with the model in cascade_model_path, loaded alongside it, when its
+ *  average token log probability is below logprob_threshold (unless its no-speech probability is above
+ *  no_speech_threshold, i.e. it is likely silence), or its text's compression ratio is above
+ *  compression_ratio_threshold (a repetition loop).  The ratio is estimated with LZ77 matching, lower
+ *  than gzip's on ordinary text.  Low latency streaming (whisperkit_configuration_set_stream_interval_ms)
+ *  is not escalated.  An empty cascade_model_path disables the cascade, the default; the thresholds
+ *  default to -1.0, 2.4 and 0.6.
+ */
+whisperkit_status_t whisperkit_configuration_set_cascade(whisperkit_configuration_t *config,
+                                                         const char *cascade_model_path, float logprob_threshold,
+                                                         float compression_ratio_threshold,
+                                                         float no_speech_threshold);
+
+/** \brief Enable or disable autotuning for the WhisperKit pipeline
+ *
+ *  When enabled and no tuning profile exists yet for this device and model, whisperkit_pipeline_build
+ *  benchmarks candidate configurations (compute backend, thread count, XNNPack and fp16 settings) of the
+ *  MelSpectrogram, audio encoder and text decoder models on synthetic inputs, and stores the fastest ones
+ *  as a JSON profile in the cache directory.  This makes the first build considerably slower.
+ *  Stored profiles are applied on every build, whether autotuning is enabled or not; delete the profile
+ *  from the cache directory to tune again.  A profile's compute backends only apply when none were set
+ *  with whisperkit_configuration_set_backends.  Disabled by default.
+ */
+whisperkit_status_t whisperkit_configuration_set_autotune(whisperkit_configuration_t *config, bool autotune);
+
+/** \brief Enable or disable low memory mode for the WhisperKit pipeline
+ *
+ *  Keeps memory usage low for devices shared with other services.  When enabled, each model's
+ *  scratch memory is only allocated while the model runs and is released after its pipeline stage,
+ *  and the token history kept for the report is bounded.  This adds the cost of re-allocating
+ *  tensors to each stage of every chunk.  Unread results are kept until they are retrieved, and
+ *  released then.  Disabled by default.
+ */
+whisperkit_status_t whisperkit_configuration_set_low_memory(whisperkit_configuration_t *config, bool low_memory);
+
+/** \brief Enable or disable the decoder state benchmark of the WhisperKit pipeline
+ *
+ *  When enabled along with a report path, whisperkit_pipeline_build loads a second, CPU instance of
+ *  the text decoder and times saving and restoring its state (KV caches) at growing sequence lengths,
+ *  the cost of preempting a batch chunk.  The results go to the report.  This adds to the build time
+ *  and to the peak memory usage in the report.  Disabled by default.
+ */
+whisperkit_status_t whisperkit_configuration_set_benchmark_decoder_state(whisperkit_configuration_t *config,
+                                                                         bool benchmark_decoder_state);
+
+/** \brief Enable or disable the staged runtime for the WhisperKit pipeline
+ *
+ *  When enabled, audio ingest & chunking, MelSpectrogram & audio encoder and text decoder & post-processing
+ *  run on three separate threads connected by bounded queues, so consecutive chunks overlap in the pipeline.
+ *  Chunks are transcribed in order.  A full queue blocks the stage before it, down to
+ *  whisperkit_pipeline_appendaudio, which returns as soon as the audio is queued; transcribed is set
+ *  when results of earlier chunks are available.  whisperkit_pipeline_closestreaming waits for all queued
+ *  audio to be transcribed.  Disabled by default.
+ */
+whisperkit_status_t whisperkit_configuration_set_staged(whisperkit_configuration_t *config, bool staged);
+
+/** \brief Enable or disable VAD packing for file transcription
+ *
+ *  When enabled, the whole file is decoded first and voice activity is detected over all of it.  Speech
+ *  regions are then packed into as few 30 second encoder windows as possible, cutting only at silences,
+ *  and timestamps are mapped back to the original audio.  Not applied to streaming, or with the staged
+ *  runtime.  Default is false.
+ */
+whisperkit_status_t whisperkit_configuration_set_vad_packing(whisperkit_configuration_t *config, bool vad_packing);
+
+/** \brief Enable or disable parallel chunk transcription for the WhisperKit pipeline
+ *
+ *  When enabled, whisperkit_pipeline_transcribe schedules the chunks of the file across the concurrent
+ *  workers (see whisperkit_configuration_set_concurrent_workers) instead of transcribing them one by one.
+ *  Chunks are planned as the file is decoded, and their segments are reassembled in timestamp order.
+ *  Has no effect with a single concurrent worker.  Default is false.
+ */
+whisperkit_status_t whisperkit_configuration_set_parallel_chunks(whisperkit_configuration_t *config,
+                                                                 bool parallel_chunks);
+
 #pragma mark - pipeline state
 
 /** \brief WhisperKit pipeline status query
@@ -233,6 +550,120 @@ whisperkit_status_t whisperkit_pipeline_build(whisperkit_pipeline_t *pipeline);
 whisperkit_status_t whisperkit_pipeline_transcribe(whisperkit_pipeline_t *pipeline, const char *audio_file,
                                                    whisperkit_transcription_result_t *transcription_result);
 
+/** \brief WhisperKit pipeline transcription of audio in memory
+ *
+ *  Transcribes size bytes of audio at data, as whisperkit_pipeline_transcribe does for a file, without
+ *  writing it to a file first.  Encoded audio (format NULL, or WHISPERKIT_SAMPLE_FORMAT_ENCODED) is
+ *  decoded straight from data; raw PCM is resampled straight from data, without an intermediate copy.
+ *  data is only read during the call.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_transcribe_buffer can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_transcribe_buffer(whisperkit_pipeline_t *pipeline, const void *data,
+                                                          size_t size, const whisperkit_audio_format_t *format,
+                                                          whisperkit_transcription_result_t *transcription_result);
+
+/** \brief WhisperKit pipeline batch transcription
+ *
+ *  Transcribes num_files audio files, using the created WhisperKit pipeline object.
+ *  transcription_results holds num_files transcription result objects; the transcription of
+ *  audio_files[i] is stored in transcription_results[i].
+ *
+ *  Files are decoded on I/O threads, and their chunks are scheduled across the concurrent workers
+ *  (see whisperkit_configuration_set_concurrent_workers) as they become available; idle workers
+ *  steal chunks from busy ones, so long files do not hold up the batch.  A file that cannot be
+ *  opened leaves its transcription result empty, and the call returns
+ *  WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED once the other files are transcribed.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_transcribe_batch can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_transcribe_batch(whisperkit_pipeline_t *pipeline, const char **audio_files,
+                                                         int num_files,
+                                                         whisperkit_transcription_result_t **transcription_results);
+
+/** \brief Set the segment callback of the WhisperKit pipeline
+ *
+ *  With a callback set, whisperkit_pipeline_appendaudio returns as soon as the audio is queued: chunks
+ *  are transcribed by the pipeline's own threads (as with whisperkit_configuration_set_staged), and each
+ *  segment is delivered through callback with user_data.  Pass a null callback to remove it.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_set_segment_callback can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_set_segment_callback(whisperkit_pipeline_t *pipeline,
+                                                             whisperkit_segment_callback_t callback, void *user_data);
+
+/** \brief Set the token callback of the WhisperKit pipeline
+ *
+ *  With a callback set, each token is passed to callback with user_data as soon as it is decoded, for
+ *  file transcription and streaming; the segment's text follows as usual once it is complete.  With low
+ *  latency streaming, whose decodes are hypotheses, text comes with the segments only.  Tokens are those
+ *  of the first pass, before a cascade's larger model redoes the segment.  Pass a null callback to
+ *  remove it.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_set_token_callback can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_set_token_callback(whisperkit_pipeline_t *pipeline,
+                                                           whisperkit_token_callback_t callback, void *user_data);
+
+/** \brief Set the overload callback of the WhisperKit pipeline
+ *
+ *  callback is called with user_data when a stream's backlog goes over the maximum set with
+ *  whisperkit_configuration_set_overload_policy, and when it is back to half of it.  Pass a null
+ *  callback to remove it.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_set_overload_callback can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_set_overload_callback(whisperkit_pipeline_t *pipeline,
+                                                              whisperkit_overload_callback_t callback,
+                                                              void *user_data);
+
+/** \brief Get the real-time factor of the WhisperKit pipeline
+ *
+ *  Transcription time over audio time of the last chunks (or window decodes) of the current stream,
+ *  measured continuously: above 1, streaming falls behind its audio.  0 before the first chunk.
+ */
+whisperkit_status_t whisperkit_pipeline_get_real_time_factor(whisperkit_pipeline_t *pipeline,
+                                                             float *real_time_factor);
+
+/** \brief Preload another model set for the WhisperKit pipeline
+ *
+ *  Loads and prewarms the models in model_path on a background thread, while the pipeline keeps
+ *  transcribing with its current models; whisperkit_pipeline_swap_model switches to them.  A second
+ *  preload replaces the first one.
+ *
+ *  The pipeline must be in the BUILT or AUDIOINIT state before whisperkit_pipeline_preload_model can be
+ *  called.
+ */
+whisperkit_status_t whisperkit_pipeline_preload_model(whisperkit_pipeline_t *pipeline, const char *model_path);
+
+/** \brief Swap the WhisperKit pipeline to the preloaded model set
+ *
+ *  Waits for whisperkit_pipeline_preload_model to finish, then switches at the next chunk boundary:
+ *  right away between streams, at the next append with whisperkit_pipeline_set_segment_callback
+ *  (chunks queued before it keep the previous models), and after committing the current window with
+ *  low latency streaming.  The stream's buffered audio and transcription so far are kept, and the
+ *  previous models are released after the switch.  Open sessions keep the models they started with.
+ *
+ *  Returns WHISPERKIT_STATUS_ERROR_INVALID_STATE without a preload, or while the previous swap is
+ *  pending, and WHISPERKIT_STATUS_ERROR_MODEL_UNAVAILABLE if the preload failed.
+ */
+whisperkit_status_t whisperkit_pipeline_swap_model(whisperkit_pipeline_t *pipeline);
+
+/** \brief WhisperKit pipeline cancellation
+ *
+ *  Stops the transcription in flight on the pipeline, from any thread: model invocations are
+ *  interrupted, and the remaining audio is skipped.  The interrupted whisperkit_pipeline_transcribe,
+ *  whisperkit_pipeline_transcribe_batch or whisperkit_pipeline_closestreaming call returns
+ *  WHISPERKIT_STATUS_CANCELLED, with the transcription of the chunks finished so far in its result.
+ *  The pipeline can be used for the next request afterwards.  Has no effect when the pipeline is idle.
+ */
+whisperkit_status_t whisperkit_pipeline_cancel(whisperkit_pipeline_t *pipeline);
+
 /** \brief WhisperKit pipeline streaming init
  *
  *  Set up with audio sample rate & number of channels to be fed, using the created WhisperKit pipeline object.
@@ -248,7 +679,10 @@ whisperkit_status_t whisperkit_pipeline_initstreaming(whisperkit_pipeline_t *pip
  *
  *  Feed audio (PCM) data with its size, using the created WhisperKit pipeline object.
  *  When the buffer exceeds a chunk size (30 secs), it flags transcribed = 1 to
- *  indicate the transcription result is available.
+ *  indicate the transcription result is available.  With a segment callback set, the call
+ *  only queues the audio and transcribed stays 0; segments are passed to the callback.
+ *  With whisperkit_configuration_set_stream_interval_ms, the call only queues the audio as well,
+ *  and transcribed is 1 once new text was committed.
  *
  *  The pipeline must be in the INITAUDIO state before whisperkit_pipeline_appendaudio can be
  *  called.
@@ -256,6 +690,39 @@ whisperkit_status_t whisperkit_pipeline_initstreaming(whisperkit_pipeline_t *pip
 whisperkit_status_t whisperkit_pipeline_appendaudio(whisperkit_pipeline_t *pipeline, int size, char *buffer,
                                                     int *transcribed);
 
+/** \brief Open a streaming session on the WhisperKit pipeline
+ *
+ *  Registers one of many concurrent audio streams with the pipeline.  Unlike whisperkit_pipeline_initstreaming,
+ *  which takes the whole pipeline, any number of sessions share its models: their 30 second chunks (or
+ *  utterances, with whisperkit_configuration_set_endpoint_hangover_ms) are transcribed in turns, round robin,
+ *  by replicas of the pipeline's runtime (see whisperkit_configuration_set_concurrent_workers), apart from
+ *  the runtime whisperkit_pipeline_transcribe and audio streaming use.  Segments are passed to
+ *  callback with user_data, in the session's audio order; callback may be null.
+ *  Sessions are realtime work: when whisperkit_pipeline_transcribe_batch runs on the same pipeline, their
+ *  chunks are transcribed ahead of the batch's, which also yields the runtimes between its decoding steps.
+ *
+ *  The pipeline must be in the BUILT state before whisperkit_pipeline_open_session can be called, and
+ *  all of its sessions must be closed before it is destroyed.
+ */
+whisperkit_status_t whisperkit_pipeline_open_session(whisperkit_pipeline_t *pipeline, int sample_rate,
+                                                     int num_channels, whisperkit_segment_callback_t callback,
+                                                     void *user_data, whisperkit_session_t **session);
+
+/** \brief WhisperKit session append audio
+ *
+ *  Feed 16-bit PCM audio to the session.  Returns once the audio is buffered; complete chunks are queued
+ *  for transcription.  Sessions can be fed from different threads.
+ */
+whisperkit_status_t whisperkit_session_appendaudio(whisperkit_session_t *session, int size, char *buffer);
+
+/** \brief WhisperKit session close
+ *
+ *  Transcribes the rest of the session's audio, waits for it, and destroys the session.
+ *  The session's transcription is stored in transcription_result, which may be null.
+ */
+whisperkit_status_t whisperkit_session_close(whisperkit_session_t **session,
+                                             whisperkit_transcription_result_t *transcription_result);
+
 /** \brief WhisperKit pipeline streaming close
  *
  *  Close audio streaming input, using the created WhisperKit pipeline object.
@@ -280,6 +747,32 @@ whisperkit_status_t whisperkit_transcription_result_get_all_transcription(
 whisperkit_status_t whisperkit_transcription_result_get_transcription(
     whisperkit_transcription_result_t *transcription_result, char **transcription);
 
+/** \brief WhisperKit transcription result getter, without a copy
+ *
+ *  Points transcription at the full transcription held by the transcription result object.
+ *  The string is not copied, and is only valid until the result is next updated by the pipeline.
+ */
+whisperkit_status_t whisperkit_transcription_result_view_all_transcription(
+    whisperkit_transcription_result_t *transcription_result, const char **transcription);
+
+/** \brief WhisperKit transcription result segment count
+ *
+ *  Number of segments transcribed into the transcription result object so far.  Segments are only
+ *  appended: a caller polling for new segments reads the ones from its previous count on.
+ *  Segments are kept for whisperkit_pipeline_transcribe, whisperkit_pipeline_transcribe_buffer and
+ *  streaming; batch and session results hold the transcription text only.
+ */
+whisperkit_status_t whisperkit_transcription_result_get_segment_count(
+    whisperkit_transcription_result_t *transcription_result, int *count);
+
+/** \brief WhisperKit transcription result segment getter
+ *
+ *  Points segment at the segment at index, in audio order.  Nothing is copied or allocated; the
+ *  segment has the lifetime of the transcription result object.
+ */
+whisperkit_status_t whisperkit_transcription_result_get_segment(
+    whisperkit_transcription_result_t *transcription_result, int index, const whisperkit_result_segment_t **segment);
+
 #pragma mark - teardown
 
 /** \brief WhisperKit configuration destroyer
@@ -0,0 +1,255 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "AudioCodec.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "audio_input.hpp"
+#include "tflite_msg.hpp"
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+constexpr const uint64_t INPUT_BUFFER_SIZE = (8 << 20);
+constexpr const uint64_t STREAM_READ_SIZE = (512 << 10);  // has to be larger than 128KB
+
+static int cbDecodeInterrupt(void* ctx) {
+    // return whether to stop the input stream or not
+    AudioCodec* codec = (AudioCodec*)ctx;
+    if (codec->is_running())
+        return 0;
+    else
+        return 1;
+}
+
+static int cbReadMemory(void* opaque, uint8_t* buf, int buf_size) {
+    auto* input = (MemoryInput*)opaque;
+    auto size = min((size_t)buf_size, input->size - input->pos);
+    if (size == 0) return AVERROR_EOF;
+
+    memcpy(buf, input->data + input->pos, size);
+    input->pos += size;
+    return (int)size;
+}
+
+static int64_t cbSeekMemory(void* opaque, int64_t offset, int whence) {
+    auto* input = (MemoryInput*)opaque;
+    int64_t pos;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return (int64_t)input->size;
+        case SEEK_SET:
+            pos = offset;
+            break;
+        case SEEK_CUR:
+            pos = (int64_t)input->pos + offset;
+            break;
+        case SEEK_END:
+            pos = (int64_t)input->size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (pos < 0 || pos > (int64_t)input->size) return AVERROR(EINVAL);
+
+    input->pos = pos;
+    return pos;
+}
+
+//=========== AudioCodec =================
+AudioCodec::AudioCodec() {
+    _format_context = nullptr;
+    _io_context = nullptr;
+    _io_buffer = nullptr;
+    _codec_context = nullptr;
+    _codec = nullptr;
+    _audio_frame = nullptr;
+    _is_wav_input = false;
+    _frame_datasize = 0;
+    _is_streaming = false;
+}
+
+bool AudioCodec::open(string filename, int verbose) {
+    AVDictionary* format_opts = nullptr;
+
+    // a codec reopened for the next file drops the previous one
+    close();
+    _is_streaming = false;
+    if (strstr(filename.c_str(), "http://") || strstr(filename.c_str(), "tcp://")) {
+        av_dict_set(&format_opts, "listen", "0", 0);
+        av_dict_set(&format_opts, "timeout", "20000000", 0);
+        _is_streaming = true;
+    }
+    return open_input(filename.c_str(), format_opts, verbose);
+}
+
+bool AudioCodec::open_memory(const char* data, size_t size, int verbose) {
+    close();
+    _is_streaming = false;
+    _memory = {(const uint8_t*)data, size, 0};
+
+    _io_buffer = (unsigned char*)av_malloc(STREAM_READ_SIZE);
+    _io_context = _io_buffer ? avio_alloc_context(_io_buffer, STREAM_READ_SIZE, 0, &_memory, cbReadMemory, nullptr,
+                                                  cbSeekMemory)
+                             : nullptr;
+    if (!_io_context) {
+        LOGE("alloc memory I/O context failed\n");
+        av_freep(&_io_buffer);
+        return false;
+    }
+    return open_input(nullptr, nullptr, verbose);
+}
+
+bool AudioCodec::open_input(const char* url, AVDictionary* format_opts, int verbose) {
+    int ret;
+    AVCodecParameters* codec_par = nullptr;
+    AVDictionary** opts = nullptr;
+
+    if (!verbose) {
+        av_log_set_level(AV_LOG_ERROR);
+    }
+
+    // allocating Format I/O context
+    _format_context = avformat_alloc_context();
+    _audio_frame = av_frame_alloc();
+
+    if (!_format_context || !_audio_frame) {
+        LOGE("alloc format or audio frame context failed\n");
+        av_dict_free(&format_opts);
+        return false;
+    }
+
+    av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+
+    _format_context->interrupt_callback.callback = cbDecodeInterrupt;
+    _format_context->interrupt_callback.opaque = this;
+    _format_context->max_analyze_duration = 1024000;
+    // memory input: the container is probed from the data itself
+    if (_io_context) _format_context->pb = _io_context;
+    _is_running = true;
+
+    AVInputFormat* input_format = nullptr;
+
+    ret = avformat_open_input(&_format_context, url, input_format, &format_opts);
+    av_dict_free(&format_opts);
+    if (ret < 0) {
+        LOGE("avformat_open_input Error: %s\n", *av_err2string(ret));
+        return false;
+    }
+
+    opts = (AVDictionary**)av_calloc(_format_context->nb_streams, sizeof(*opts));
+    avformat_find_stream_info(_format_context, opts);
+    _duration = (_format_context->duration) / 1000;
+
+    for (unsigned int i = 0; i < _format_context->nb_streams; i++) {
+        codec_par = _format_context->streams[i]->codecpar;
+        if (codec_par->codec_type == AVMEDIA_TYPE_AUDIO) break;
+    }
+    if (codec_par == nullptr) throw std::invalid_argument("codec_par is a null ptr..");
+
+    _audio_frame->sample_rate = codec_par->sample_rate;
+    _audio_frame->ch_layout = codec_par->ch_layout;
+    if (codec_par->format == AV_SAMPLE_FMT_NONE)
+        _audio_frame->format = AV_SAMPLE_FMT_S16;
+    else
+        _audio_frame->format = codec_par->format;
+
+    const string filename = url ? url : "";
+    _is_wav_input = url ? filename.find(".wav") != string::npos || filename.find(".wave") != string::npos
+                        : strcmp(_format_context->iformat->name, "wav") == 0;
+    if (!_is_wav_input) {
+        _codec = (AVCodec*)avcodec_find_decoder(codec_par->codec_id);
+        if (!_codec) {
+            LOGE("avcodec_find_decoder failed\n");
+            return false;
+        }
+        _codec_name = string(avcodec_get_name(codec_par->codec_id));
+
+        // LOGI("Audio Codec: %s\n", _codec_name.c_str());
+        if (_codec_context != nullptr) {
+            avcodec_free_context(&_codec_context);
+        }
+        _codec_context = avcodec_alloc_context3(_codec);
+
+        avcodec_parameters_to_context(_codec_context, codec_par);
+
+        if (avcodec_open2(_codec_context, _codec, opts) < 0) {
+            LOGE("Could not open audio codec..\n");
+            return false;
+        }
+    }
+
+    if (verbose > 0) {
+        av_dump_format(_format_context, 0, nullptr, false);
+    }
+    av_free(opts);
+
+    return true;
+}
+
+void AudioCodec::close() {
+    if (_codec_context) {
+        av_free(_codec_context);
+        _codec_context = nullptr;
+    }
+    if (_audio_frame) {
+        av_frame_unref(_audio_frame);
+        av_frame_free(&_audio_frame);
+        _audio_frame = nullptr;
+    }
+    // before the I/O context, which the format context reads from
+    if (_format_context) {
+        avformat_close_input(&_format_context);
+        avformat_free_context(_format_context);
+        _format_context = nullptr;
+    }
+    if (_io_context) {
+        avio_flush(_io_context);
+        av_freep(&_io_context->buffer);  // note that it is referencing m_pIOBuffer
+        avio_context_free(&_io_context);
+        _io_buffer = nullptr;
+    }
+    _is_running = false;
+}
+
+int AudioCodec::decode_pcm() {
+    int retry = 0;
+    AVPacket packet;
+    int ret = av_read_frame(_format_context, &packet);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (_is_wav_input && packet.size > 0) {
+        _audio_frame->data[0] = packet.data;
+        _audio_frame->nb_samples = packet.size / av_get_bytes_per_sample((AVSampleFormat)_audio_frame->format);
+        _frame_datasize = packet.size;
+        return 0;
+    }
+
+    if (packet.size > 0) {
+        ret = avcodec_send_packet(_codec_context, &packet);
+        if (ret < 0) {
+            LOGE("Error sending a packet: %s\n", *av_err2string(ret));
+            return ret;
+        }
+    }
+    av_frame_unref(_audio_frame);
+    ret = avcodec_receive_frame(_codec_context, _audio_frame);
+    if (ret == AVERROR(EAGAIN)) {
+        return ret;
+    } else if (ret == AVERROR_EOF) {
+        return ret;
+    } else if (ret < 0) {
+        LOGE("Error during decoding: %s\n", *av_err2string(ret));
+        return ret;
+    }
+
+    _frame_datasize = _audio_frame->nb_samples * av_get_bytes_per_sample((AVSampleFormat)_audio_frame->format);
+
+    return 0;
+}
+
+}  // namespace WhisperKit::TranscribeTask
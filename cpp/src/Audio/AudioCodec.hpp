@@ -0,0 +1,60 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace WhisperKit::TranscribeTask {
+
+// audio held by the caller, read through a custom AVIOContext instead of a file
+struct MemoryInput {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+};
+
+// decodes an audio file, stream URL or encoded buffer into PCM frames, one packet at a time
+class AudioCodec {
+   public:
+    AudioCodec();
+    ~AudioCodec() = default;
+
+    bool open(const std::string filename, int verbose = 0);
+    // encoded audio in memory, in any container ffmpeg detects; data must outlive the decoding
+    bool open_memory(const char* data, size_t size, int verbose = 0);
+    void close();
+
+    AVFrame* get_frame() const { return _audio_frame; }
+    int64_t get_duration_ms() const { return _duration; }
+    bool is_running() const { return _is_running; }
+    int get_datasize() const { return _frame_datasize; }
+    int decode_pcm();
+    bool is_streaming() { return _is_streaming; }
+
+   private:
+    bool open_input(const char* url, AVDictionary* format_opts, int verbose);
+
+    MemoryInput _memory;
+    AVIOContext* _io_context;
+    unsigned char* _io_buffer;
+    AVFormatContext* _format_context;
+    AVCodecContext* _codec_context;
+    AVCodec* _codec;
+    AVFrame* _audio_frame;
+
+    int _frame_datasize;
+    std::string _codec_name;
+    int64_t _duration;
+    bool _is_running;
+    bool _is_wav_input;
+    bool _is_streaming;
+};
+
+}  // namespace WhisperKit::TranscribeTask
@@ -2,6 +2,8 @@
 //  Copyright © 2024 Argmax, Inc. All rights reserved.
 #include "audio_input.hpp"
 
+#include <algorithm>
+
 // 30 seconds of PCM audio samples
 constexpr const int MAX_CHUNK_LENGTH = (16000 * 30);
 constexpr const int INTERNAL_AUDIO_SIZE = (1.5 * MAX_CHUNK_LENGTH);
@@ -63,6 +65,20 @@ void AudioBuffer::uninitialize() {
     _target_frame = nullptr;
 }
 
+bool AudioBuffer::reset() {
+    lock_guard<mutex> lock(_mutex);
+
+    _buffer.clear();
+    if (_swr == nullptr) return true;
+
+    int ret = swr_init(_swr);
+    if (ret < 0) {
+        LOGE("Error in swr_init: %s\n", *av_err2string(ret));
+        return false;
+    }
+    return true;
+}
+
 int AudioBuffer::append(int bytes, char* input0, char* input1) {
     lock_guard<mutex> lock(_mutex);
 
@@ -131,18 +147,7 @@ AudioInputModel::AudioInputModel(  // buffer input mode
     _source_frame = av_frame_alloc();
     _target_frame = av_frame_alloc();
 
-    _source_frame->sample_rate = freq;
-    if (channels == 1)
-        _source_frame->ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    else if (channels == 2)
-        _source_frame->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    else
-        throw std::invalid_argument("more than 2 audio channels not supported");
-
-    if (format <= AV_SAMPLE_FMT_NONE)
-        _source_frame->format = AV_SAMPLE_FMT_S16;
-    else
-        _source_frame->format = format;
+    set_source_format(freq, channels, format);
     _target_frame->ch_layout = AV_CHANNEL_LAYOUT_MONO;
     _target_frame->sample_rate = SAMPLE_FREQ;
     _target_frame->format = AV_SAMPLE_FMT_FLT;
@@ -152,6 +157,23 @@ AudioInputModel::AudioInputModel(  // buffer input mode
     _pcm_buffer = make_unique<AudioBuffer>();
 }
 
+bool AudioInputModel::set_source_format(int freq, int channels, int format) {
+    if (channels != 1 && channels != 2) throw std::invalid_argument("more than 2 audio channels not supported");
+    if (format <= AV_SAMPLE_FMT_NONE) format = AV_SAMPLE_FMT_S16;
+
+    if (_source_frame->sample_rate == freq && _source_frame->ch_layout.nb_channels == channels &&
+        _source_frame->format == format) {
+        return false;
+    }
+    _source_frame->sample_rate = freq;
+    if (channels == 1)
+        _source_frame->ch_layout = AV_CHANNEL_LAYOUT_MONO;
+    else
+        _source_frame->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+    _source_frame->format = format;
+    return true;
+}
+
 AudioInputModel::~AudioInputModel() {
     av_frame_unref(_source_frame);
     av_frame_free(&_source_frame);
@@ -184,6 +206,29 @@ void AudioInputModel::uninitialize() {
     _model->uninitialize();
 }
 
+bool AudioInputModel::reset(int freq, int channels, int format, bool debug) {
+    _total_src_bytes = 0;
+    _buffer_index = 0;
+    _float_buffer.clear();
+    _silence_index = 0;
+    _remain_samples = 0;
+    _curr_buf_time = 0;
+    _vad_pending.clear();
+    _speech_frames = 0;
+    _silence_frames = 0;
+    _endpoint = false;
+
+    if (!set_source_format(freq, channels, format)) return _pcm_buffer->reset();
+
+    _pcm_buffer->uninitialize();
+    if (!_pcm_buffer->initialize(_source_frame, _target_frame, debug)) {
+        LOGE("Failed to initialize PCM buffer class\n");
+        return false;
+    }
+    _pcm_buffer->print_frame_info();
+    return true;
+}
+
 void AudioInputModel::invoke(bool measure_time) { _model->invoke(measure_time); }
 
 float AudioInputModel::get_next_chunk(char* output) {
@@ -305,6 +350,11 @@ std::vector<std::pair<char*, int>> AudioInputModel::get_output_ptrs() {
 
 void AudioInputModel::fill_pcmdata(int bytes, char* pcm_buffer0, char* pcm_buffer1) {
     int ret = _pcm_buffer->append(bytes, pcm_buffer0, pcm_buffer1);
+    if (_endpoint_hangover_ms > 0 && ret > 0) {
+        auto appended = _pcm_buffer->get_buffer() + _pcm_buffer->samples() - ret;
+        _vad_pending.insert(_vad_pending.end(), appended, appended + ret);
+        detect_endpoint();
+    }
 
     _curr_buf_time = (_pcm_buffer->samples() + _remain_samples) / _target_frame->sample_rate;
     _total_src_bytes += bytes;
@@ -314,6 +364,149 @@ float AudioInputModel::get_total_input_time() {
     return (_total_src_bytes / (_source_frame->sample_rate * _pcm_buffer->get_srcbytes_per_sample()));
 }
 
+std::vector<PackedChunk> AudioInputModel::plan_packed_chunks() {
+    constexpr const int kMinSilenceFrames = 5;  // shorter pauses stay inside a speech region
+    constexpr const int kContextFrames = 3;     // kept around speech, so word onsets are not clipped
+    constexpr const int kGapFrames = 2;         // silence between regions packed into the same chunk
+    const int frame_samples = _frame_length_samples;
+    const int chunk_frames = MAX_CHUNK_LENGTH / frame_samples;
+
+    // everything not chunked yet
+    const auto base_index = _silence_index;
+    vector<float> audio;
+    audio.swap(_float_buffer);
+    auto buffered = _pcm_buffer->samples();
+    audio.insert(audio.end(), _pcm_buffer->get_buffer(), _pcm_buffer->get_buffer() + buffered);
+    _pcm_buffer->consumed(buffered);
+    _silence_index += audio.size();
+    _remain_samples = 0;
+    _curr_buf_time = 0;
+
+    // frame energy above the threshold, over windows of the VAD model's input size
+    const int num_frames = (audio.size() + frame_samples - 1) / frame_samples;
+    vector<float> energy(num_frames);
+    auto inputs = _model->get_input_ptrs();
+    const int window_frames = inputs[0].second / sizeof(float) / frame_samples;
+    for (int frame = 0; frame < num_frames; frame += window_frames) {
+        size_t begin = (size_t)frame * frame_samples;
+        size_t count = min(audio.size() - begin, (size_t)window_frames * frame_samples);
+        memset(inputs[0].first, 0, inputs[0].second);
+        memcpy(inputs[0].first, &audio[begin], count * sizeof(float));
+        memcpy(inputs[1].first, &_energy_threshold, sizeof(float));
+
+        _model->invoke();
+
+        auto output = reinterpret_cast<float*>(_model->get_output_ptrs()[0].first);
+        for (int idx = 0; idx < window_frames && frame + idx < num_frames; idx++) {
+            energy[frame + idx] = output[idx];
+        }
+    }
+
+    // speech regions [begin, end) in frames, with their context
+    vector<pair<int, int>> regions;
+    for (int frame = 0; frame < num_frames; frame++) {
+        if (energy[frame] <= 0) continue;
+
+        int begin = max(0, frame - kContextFrames);
+        int end = min(num_frames, frame + 1 + kContextFrames);
+        if (!regions.empty() && begin - regions.back().second < kMinSilenceFrames) {
+            regions.back().second = max(regions.back().second, end);
+        } else {
+            regions.push_back({begin, end});
+        }
+    }
+
+    // a region longer than a chunk is cut at its quietest frame in the second half of the chunk
+    vector<pair<int, int>> pieces;
+    for (auto [begin, end] : regions) {
+        while (end - begin > chunk_frames) {
+            auto window = energy.begin() + begin;
+            int cut = distance(energy.begin(), min_element(window + chunk_frames / 2, window + chunk_frames));
+            pieces.push_back({begin, cut});
+            begin = cut;
+        }
+        pieces.push_back({begin, end});
+    }
+
+    // in order, so the chunks' texts follow the audio
+    vector<PackedChunk> chunks;
+    int used_frames = 0;
+    for (auto [begin, end] : pieces) {
+        if (chunks.empty() || used_frames + kGapFrames + (end - begin) > chunk_frames) {
+            chunks.emplace_back();
+            chunks.back().samples.assign(MAX_CHUNK_LENGTH, 0.0f);
+            used_frames = 0;
+        } else {
+            used_frames += kGapFrames;
+        }
+
+        auto& chunk = chunks.back();
+        size_t first = (size_t)begin * frame_samples;
+        size_t last = min(audio.size(), (size_t)end * frame_samples);
+        copy(audio.begin() + first, audio.begin() + last, chunk.samples.begin() + used_frames * frame_samples);
+        chunk.timestamp_map.push_back(
+            {(float)used_frames * frame_samples / SAMPLE_FREQ, (float)(base_index + first) / SAMPLE_FREQ});
+        used_frames += end - begin;
+    }
+
+    LOGI("VAD packing: %.1f s of audio, %zu speech regions in %zu chunks\n", (float)audio.size() / SAMPLE_FREQ,
+         pieces.size(), chunks.size());
+    return chunks;
+}
+
+void AudioInputModel::detect_endpoint() {
+    const int num_frames = _vad_pending.size() / _frame_length_samples;
+    if (num_frames == 0) return;
+
+    const int frame_ms = _frame_length_samples * 1000 / SAMPLE_FREQ;
+    const auto now = chrono::steady_clock::now();
+    auto inputs = _model->get_input_ptrs();
+    const int window_frames = inputs[0].second / sizeof(float) / _frame_length_samples;
+    for (int frame = 0; frame < num_frames; frame += window_frames) {
+        const int count = min(window_frames, num_frames - frame);
+        memset(inputs[0].first, 0, inputs[0].second);
+        memcpy(inputs[0].first, &_vad_pending[frame * _frame_length_samples],
+               count * _frame_length_samples * sizeof(float));
+        memcpy(inputs[1].first, &_energy_threshold, sizeof(float));
+
+        _model->invoke();
+
+        auto output = reinterpret_cast<float*>(_model->get_output_ptrs()[0].first);
+        for (int idx = 0; idx < count; idx++) {
+            if (output[idx] > 0) {
+                _speech_frames++;
+                _silence_frames = 0;
+                _last_speech = now;
+            } else if (_speech_frames > 0 && ++_silence_frames * frame_ms >= _endpoint_hangover_ms) {
+                _endpoint = true;
+                _endpoint_speech_end = _last_speech;
+                _speech_frames = 0;
+                _silence_frames = 0;
+            }
+        }
+    }
+    _vad_pending.erase(_vad_pending.begin(), _vad_pending.begin() + num_frames * _frame_length_samples);
+}
+
+bool AudioInputModel::take_endpoint(std::chrono::steady_clock::time_point& speech_end) {
+    if (!_endpoint) return false;
+
+    _endpoint = false;
+    speech_end = _endpoint_speech_end;
+    return true;
+}
+
+int AudioInputModel::take_samples(std::vector<float>& output) {
+    auto count = _pcm_buffer->samples();
+    if (count <= 0) return 0;
+
+    output.insert(output.end(), _pcm_buffer->get_buffer(), _pcm_buffer->get_buffer() + count);
+    _pcm_buffer->consumed(count);
+    _silence_index += count;
+    _curr_buf_time = 0;
+    return count;
+}
+
 int AudioInputModel::get_next_samples() {
     auto remaining_time_x100 = (unsigned int)(_remain_samples * 100) / SAMPLE_FREQ;
 
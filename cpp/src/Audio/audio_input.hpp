@@ -1,6 +1,7 @@
 //  For licensing see accompanying LICENSE file.
 //  Copyright © 2024 Argmax, Inc. All rights reserved.
 #pragma once
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -14,7 +15,8 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
-#include "backend_class.hpp"
+#include "TimestampMap.hpp"
+#include "tflite_model.hpp"
 
 constexpr const int SAMPLE_FREQ = 16000;
 
@@ -42,6 +44,8 @@ class AudioBuffer {
 
     bool initialize(AVFrame* src_frame, AVFrame* tgt_frame, bool verbose = false);
     void uninitialize();
+    // next stream in the same format: drops the buffered audio and the resampler's delayed samples
+    bool reset();
     bool empty_source();
 
     int append(int bytes, char* buffer0, char* buffer1 = nullptr);
@@ -52,6 +56,12 @@ class AudioBuffer {
     void print_frame_info();
 };
 
+// an encoder window filled with speech regions from anywhere in the audio
+struct PackedChunk {
+    std::vector<float> samples;  // 30 seconds, zero padded
+    WhisperKit::TimestampMap timestamp_map;
+};
+
 class AudioInputModel {
    public:
     AudioInputModel(int freq, int channels, int format = AV_SAMPLE_FMT_FLT);
@@ -59,6 +69,8 @@ class AudioInputModel {
 
     bool initialize(bool debug = false);
     void uninitialize();
+    // next stream: keeps the VAD model and buffers, the resampler is only rebuilt for another input format
+    bool reset(int freq, int channels, int format, bool debug = false);
     virtual void invoke(bool measure_time = false);
 
     // this is temporary
@@ -68,7 +80,19 @@ class AudioInputModel {
     void fill_pcmdata(int size, char* pcm_buffer0, char* pcm_buffer1 = nullptr);
     float get_next_chunk(char* output);
     int get_curr_buf_time() { return _curr_buf_time; }
+    // stream time up to which get_next_chunk() handed out audio, in seconds
+    float get_chunked_time() const { return (float)_silence_index / SAMPLE_FREQ; }
     float get_total_input_time();
+    // offline alternative to get_next_chunk(): takes all buffered audio, runs VAD over it,
+    // and packs the speech into as few chunks as possible, cutting only at silences
+    std::vector<PackedChunk> plan_packed_chunks();
+    // low latency streaming: moves the resampled audio buffered so far to output, returns the number of samples
+    int take_samples(std::vector<float>& output);
+    // endpointing: fill_pcmdata runs VAD over the new audio in 100 ms frames, and flags the end of an
+    // utterance once speech is followed by hangover_ms of silence; 0 disables it
+    void set_endpoint_hangover(int hangover_ms) { _endpoint_hangover_ms = hangover_ms; }
+    // true once per end of utterance; speech_end is when its last speech frame was appended
+    bool take_endpoint(std::chrono::steady_clock::time_point& speech_end);
     bool empty_source() { return _pcm_buffer->empty_source(); }
 
    private:
@@ -90,6 +114,17 @@ class AudioInputModel {
     int32_t _remain_samples = 0;
     int _curr_buf_time = 0;
 
+    int _endpoint_hangover_ms = 0;
+    std::vector<float> _vad_pending;  // appended audio not classified yet, less than a frame after fill_pcmdata
+    int _speech_frames = 0;           // of the current utterance
+    int _silence_frames = 0;          // since its last speech frame
+    bool _endpoint = false;
+    std::chrono::steady_clock::time_point _last_speech;
+    std::chrono::steady_clock::time_point _endpoint_speech_end;
+
+    // false if the source frame had this format already
+    bool set_source_format(int freq, int channels, int format);
+    void detect_endpoint();
     void read_audio_file(std::string input_file);
     void chunk_all();
     float get_silence_index(char* output, int audio_samples);
@@ -0,0 +1,63 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace WhisperKit {
+
+/*
+    Append-only storage whose items never move.
+
+    Items are copied into blocks of at least kBlockSize bytes; a full block is left as it
+    is and a new one is started, so the addresses append() returns stay valid until the
+    arena is destroyed. Nothing is freed before that.
+*/
+class Arena {
+   public:
+    static constexpr size_t kBlockSize = 64 << 10;
+
+    // copies count items, returns where they are kept
+    template <typename T>
+    const T* append(const T* items, size_t count) {
+        auto* copy = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        if (count > 0) std::memcpy(copy, items, count * sizeof(T));
+        return copy;
+    }
+
+    // null terminated copy of size chars
+    const char* append_string(const char* text, size_t size) {
+        auto* copy = static_cast<char*>(allocate(size + 1, 1));
+        std::memcpy(copy, text, size);
+        copy[size] = '\0';
+        return copy;
+    }
+
+    // bytes held by the blocks, used or not
+    size_t capacity() const { return _capacity; }
+
+   private:
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t offset = (_used + alignment - 1) / alignment * alignment;
+        if (_blocks.empty() || offset + bytes > _block_size) {
+            _block_size = std::max(kBlockSize, bytes + alignment);
+            _blocks.push_back(std::make_unique<std::max_align_t[]>(
+                (_block_size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)));
+            _capacity += _block_size;
+            offset = 0;
+        }
+        _used = offset + bytes;
+        return reinterpret_cast<char*>(_blocks.back().get()) + offset;
+    }
+
+    std::vector<std::unique_ptr<std::max_align_t[]>> _blocks;
+    size_t _block_size = 0;  // of the last block
+    size_t _used = 0;        // in the last block
+    size_t _capacity = 0;
+};
+
+}  // namespace WhisperKit
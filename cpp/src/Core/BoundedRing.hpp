@@ -0,0 +1,68 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace WhisperKit {
+
+/*
+    Fixed capacity buffer that overwrites its oldest item when full.
+
+    Storage grows on demand up to the capacity, so a large capacity only costs
+    the memory that is actually used. Items are indexed oldest first.
+*/
+template <typename T>
+class BoundedRing {
+   public:
+    explicit BoundedRing(size_t capacity = 1) { reset(capacity); }
+
+    void reset(size_t capacity) {
+        _capacity = capacity > 0 ? capacity : 1;
+        _items.clear();
+        _items.shrink_to_fit();
+        _head = 0;
+        _total = 0;
+        _dropped = 0;
+    }
+
+    void push_back(T item) {
+        _total++;
+        if (_items.size() < _capacity) {
+            _items.push_back(std::move(item));
+            return;
+        }
+        _items[_head] = std::move(item);
+        _head = (_head + 1) % _capacity;
+        _dropped++;
+    }
+
+    // removes the items, counters are kept
+    void clear() {
+        _items.clear();
+        _head = 0;
+    }
+
+    const T& operator[](size_t idx) const { return _items[(_head + idx) % _items.size()]; }
+    T& operator[](size_t idx) { return _items[(_head + idx) % _items.size()]; }
+
+    bool empty() const { return _items.empty(); }
+    size_t size() const { return _items.size(); }
+    size_t capacity() const { return _capacity; }
+    // items pushed since the last reset(), including overwritten ones
+    uint64_t total() const { return _total; }
+    // items overwritten before they were cleared
+    uint64_t dropped() const { return _dropped; }
+
+   private:
+    std::vector<T> _items;
+    size_t _capacity;
+    size_t _head;
+    uint64_t _total;
+    uint64_t _dropped;
+};
+
+}  // namespace WhisperKit
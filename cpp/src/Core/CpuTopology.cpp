@@ -0,0 +1,252 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "CpuTopology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "tflite_msg.hpp"
+
+namespace {
+
+const std::string kCpuSysfsRoot = "/sys/devices/system/cpu/";
+
+int read_sysfs_int(const std::string& path, int fallback) {
+    std::ifstream file(path);
+    int value;
+    if (file >> value) return value;
+    return fallback;
+}
+
+// parses cpu list format, e.g. "0-3,6,8-9"
+std::vector<int> read_sysfs_cpu_list(const std::string& path) {
+    std::vector<int> cpus;
+    std::ifstream file(path);
+    std::string list;
+    if (!std::getline(file, list)) return cpus;
+
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        try {
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+        } catch (...) {
+            continue;
+        }
+    }
+    return cpus;
+}
+
+std::string stage_name(WhisperKit::PipelineStage stage) {
+    switch (stage) {
+        case WhisperKit::PipelineStage::Audio:
+            return "audio";
+        case WhisperKit::PipelineStage::MelSpectrogram:
+            return "melSpectrogram";
+        case WhisperKit::PipelineStage::Encoder:
+            return "encoder";
+        case WhisperKit::PipelineStage::Decoder:
+            return "decoder";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+namespace WhisperKit {
+
+const CpuTopology& CpuTopology::instance() {
+    static CpuTopology topology;
+    return topology;
+}
+
+CpuTopology::CpuTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool has_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    auto online = read_sysfs_cpu_list(kCpuSysfsRoot + "online");
+    if (online.empty()) {
+        for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); cpu++) online.push_back(cpu);
+    }
+
+    for (int cpu : online) {
+        // cores outside of the process mask (cgroups, taskset) are not ours to schedule on
+        if (has_mask && !CPU_ISSET(cpu, &allowed)) continue;
+
+        auto cpu_dir = kCpuSysfsRoot + "cpu" + std::to_string(cpu) + "/";
+        CpuCore core;
+        core.cpu = cpu;
+        core.capacity = read_sysfs_int(cpu_dir + "cpu_capacity", -1);
+        if (core.capacity < 0) {
+            // x86 and older arm kernels: max frequency is the best capacity proxy available
+            core.capacity = read_sysfs_int(cpu_dir + "cpufreq/cpuinfo_max_freq", 1024);
+        }
+        core.cluster = read_sysfs_int(cpu_dir + "topology/cluster_id", -1);
+        if (core.cluster < 0) {
+            core.cluster = read_sysfs_int(cpu_dir + "topology/physical_package_id", 0);
+        }
+        auto siblings = read_sysfs_cpu_list(cpu_dir + "topology/thread_siblings_list");
+        core.smt_primary = siblings.empty() ? cpu : *std::min_element(siblings.begin(), siblings.end());
+
+        _cores.push_back(core);
+    }
+}
+
+int CpuTopology::big_threshold() const {
+    if (_cores.empty()) return 0;
+
+    auto [min_it, max_it] = std::minmax_element(_cores.begin(), _cores.end(), [](const CpuCore& a, const CpuCore& b) {
+        return a.capacity < b.capacity;
+    });
+    // prime and big cores are within a few percent of each other, little cores are
+    // far below, so split at the midpoint of the capacity range
+    return (min_it->capacity + max_it->capacity + 1) / 2;
+}
+
+bool CpuTopology::is_heterogeneous() const {
+    if (_cores.empty()) return false;
+    return std::any_of(_cores.begin(), _cores.end(),
+                       [this](const CpuCore& core) { return core.capacity != _cores.front().capacity; });
+}
+
+std::vector<int> CpuTopology::physical_cores() const {
+    std::vector<CpuCore> primaries;
+    for (auto& core : _cores) {
+        if (core.cpu == core.smt_primary) primaries.push_back(core);
+    }
+    std::stable_sort(primaries.begin(), primaries.end(),
+                     [](const CpuCore& a, const CpuCore& b) { return a.capacity > b.capacity; });
+
+    std::vector<int> cpus;
+    for (auto& core : primaries) cpus.push_back(core.cpu);
+    return cpus;
+}
+
+std::vector<int> CpuTopology::big_cores() const {
+    if (!is_heterogeneous()) return physical_cores();
+
+    auto threshold = big_threshold();
+    std::vector<int> cpus;
+    for (auto& core : _cores) {
+        if (core.cpu == core.smt_primary && core.capacity >= threshold) cpus.push_back(core.cpu);
+    }
+    return cpus;
+}
+
+std::vector<int> CpuTopology::little_cores() const {
+    std::vector<int> cpus;
+    if (is_heterogeneous()) {
+        auto threshold = big_threshold();
+        for (auto& core : _cores) {
+            if (core.cpu == core.smt_primary && core.capacity < threshold) cpus.push_back(core.cpu);
+        }
+    } else {
+        // homogeneous: the lowest-capacity (i.e. last) physical core stands in as the little core
+        auto physical = physical_cores();
+        if (!physical.empty()) cpus.push_back(physical.back());
+    }
+    return cpus;
+}
+
+std::vector<int> CpuTopology::with_siblings(const std::vector<int>& physical) const {
+    std::set<int> primaries(physical.begin(), physical.end());
+    std::vector<int> cpus;
+    for (auto& core : _cores) {
+        if (primaries.contains(core.smt_primary)) cpus.push_back(core.cpu);
+    }
+    return cpus;
+}
+
+nlohmann::json CpuTopology::to_json() const {
+    nlohmann::json topology;
+    for (auto& core : _cores) {
+        topology["cores"].push_back({{"cpu", core.cpu},
+                                     {"capacity", core.capacity},
+                                     {"cluster", core.cluster},
+                                     {"smtPrimary", core.smt_primary}});
+    }
+    topology["bigCores"] = big_cores();
+    topology["littleCores"] = little_cores();
+    topology["heterogeneous"] = is_heterogeneous();
+    return topology;
+}
+
+ThreadScheduler::ThreadScheduler(ThreadPolicy policy, const std::array<int, kNumPipelineStages>& stage_threads)
+    : _policy(policy) {
+    const int processor_count = std::thread::hardware_concurrency();
+    auto& encoder = _placements[(int)PipelineStage::Encoder];
+    auto& decoder = _placements[(int)PipelineStage::Decoder];
+    auto& melspectro = _placements[(int)PipelineStage::MelSpectrogram];
+    auto& audio = _placements[(int)PipelineStage::Audio];
+
+    if (policy == ThreadPolicy::Topology && !CpuTopology::instance().cores().empty()) {
+        auto& topology = CpuTopology::instance();
+        auto big = topology.big_cores();
+        auto little = topology.little_cores();
+        const int num_big = std::max<int>(1, big.size());
+
+        // encoder: compute bound, one thread per big physical core
+        encoder.num_threads = num_big;
+        encoder.cpus = topology.with_siblings(big);
+        // decoder: single-token steps, synchronization overhead dominates beyond 2 threads
+        decoder.num_threads = std::min(2, num_big);
+        decoder.cpus = encoder.cpus;
+        // mel spectrogram: small FFT graph
+        melspectro.num_threads = 1;
+        melspectro.cpus = encoder.cpus;
+        // audio resampling & VAD: keep off the big cores
+        audio.num_threads = 1;
+        audio.cpus = topology.with_siblings(little);
+    } else {
+        _policy = ThreadPolicy::Default;
+        for (auto* placement : {&encoder, &decoder, &melspectro}) {
+            placement->num_threads = std::max(1, processor_count - 1);
+        }
+    }
+
+    // the audio stage is a single thread whatever its count, only its cpus apply
+    for (int stage = (int)PipelineStage::MelSpectrogram; stage < kNumPipelineStages; stage++) {
+        if (stage_threads[stage] > 0) _placements[stage].num_threads = stage_threads[stage];
+    }
+}
+
+ThreadPlacement ThreadScheduler::placement_for(PipelineStage stage) const { return _placements[(int)stage]; }
+
+nlohmann::json ThreadScheduler::to_json() const {
+    nlohmann::json schedule;
+    schedule["policy"] = (_policy == ThreadPolicy::Topology) ? "topology" : "default";
+    for (int stage = 0; stage < kNumPipelineStages; stage++) {
+        auto& placement = _placements[stage];
+        schedule["stages"][stage_name((PipelineStage)stage)] = {{"threads", placement.num_threads},
+                                                                {"cpus", placement.cpus}};
+    }
+    return schedule;
+}
+
+ScopedAffinity::ScopedAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) return;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus) CPU_SET(cpu, &mask);
+
+    if (sched_getaffinity(0, sizeof(_saved), &_saved) != 0) return;
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+        LOGE("ScopedAffinity: sched_setaffinity failed\n");
+        return;
+    }
+    _applied = true;
+}
+
+ScopedAffinity::~ScopedAffinity() {
+    if (_applied) sched_setaffinity(0, sizeof(_saved), &_saved);
+}
+
+}  // namespace WhisperKit
@@ -0,0 +1,92 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <sched.h>
+
+#include <array>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace WhisperKit {
+
+struct CpuCore {
+    int cpu;          // logical cpu id
+    int capacity;     // relative compute capacity (cpu_capacity, or max frequency as fallback)
+    int cluster;      // cluster_id, or physical_package_id as fallback
+    int smt_primary;  // lowest logical cpu id among the SMT siblings of this core
+};
+
+/*
+    CPU topology of the cores this process is allowed to run on, read once from
+    /sys/devices/system/cpu. Big/little classification is relative: on a
+    homogeneous CPU every physical core counts as big.
+*/
+class CpuTopology {
+   public:
+    static const CpuTopology& instance();
+
+    const std::vector<CpuCore>& cores() const { return _cores; }
+    // one logical cpu per physical core, highest capacity first
+    std::vector<int> physical_cores() const;
+    std::vector<int> big_cores() const;
+    std::vector<int> little_cores() const;
+    // all logical cpus (incl. SMT siblings) of the given physical cores
+    std::vector<int> with_siblings(const std::vector<int>& physical) const;
+    bool is_heterogeneous() const;
+
+    nlohmann::json to_json() const;
+
+   private:
+    CpuTopology();
+    int big_threshold() const;
+
+    std::vector<CpuCore> _cores;
+};
+
+enum class PipelineStage { Audio = 0, MelSpectrogram = 1, Encoder = 2, Decoder = 3 };
+constexpr int kNumPipelineStages = 4;
+
+enum class ThreadPolicy {
+    // every model uses (cores - 1) threads without affinity
+    Default = 0,
+    // per-stage thread counts and core affinities derived from CpuTopology
+    Topology = 1,
+};
+
+struct ThreadPlacement {
+    int num_threads = -1;   // -1: TFLite default
+    std::vector<int> cpus;  // empty: no affinity
+};
+
+class ThreadScheduler {
+   public:
+    // stage_threads: per-stage thread count overrides, 0 keeps the policy's choice
+    ThreadScheduler(ThreadPolicy policy, const std::array<int, kNumPipelineStages>& stage_threads);
+
+    ThreadPlacement placement_for(PipelineStage stage) const;
+    nlohmann::json to_json() const;
+
+   private:
+    ThreadPolicy _policy;
+    std::array<ThreadPlacement, kNumPipelineStages> _placements;
+};
+
+// Pins the calling thread to the given cpus for its lifetime and restores the
+// previous mask afterwards. Threads spawned meanwhile (e.g. TFLite/XNNPack
+// worker pools) inherit the mask. No-op for an empty cpu list.
+class ScopedAffinity {
+   public:
+    explicit ScopedAffinity(const std::vector<int>& cpus);
+    ~ScopedAffinity();
+
+    ScopedAffinity(const ScopedAffinity&) = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+   private:
+    bool _applied = false;
+    cpu_set_t _saved;
+};
+
+}  // namespace WhisperKit
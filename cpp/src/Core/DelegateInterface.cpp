@@ -1,6 +1,7 @@
 #include "DelegateInterface.hpp"
 
 #include <any>
+#include <array>
 #include <memory>
 #include <optional>
 #include <string>
@@ -50,11 +51,56 @@ std::any NpuOptionsImpl::get_options() { return options_; }
 NpuOptionsImpl::~NpuOptionsImpl() {}
 
 void NpuOptionsImpl::set_value_for_option(const std::string& key, const std::string& value) {
-    // TODO: Implement this when delegate options are configurable
+#if QNN_DELEGATE
+    auto delegate_options = std::any_cast<TfLiteQnnDelegateOptions>(options_);
+
+    if (key == "backend") {
+        delegate_options.backend_type = (value == "gpu") ? kGpuBackend : kHtpBackend;
+    } else if (key == "precision") {
+        delegate_options.htp_options.precision = (value == "quantized") ? kHtpQuantized : kHtpFp16;
+    } else if (key == "performance_mode") {
+        if (value == "burst") {
+            delegate_options.htp_options.performance_mode = kHtpBurst;
+        } else if (value == "sustained") {
+            delegate_options.htp_options.performance_mode = kHtpSustainedHighPerformance;
+        } else if (value == "balanced") {
+            delegate_options.htp_options.performance_mode = kHtpBalanced;
+        } else {
+            delegate_options.htp_options.performance_mode = kHtpHighPerformance;
+        }
+    } else if (key == "use_conv_hmx") {
+        delegate_options.htp_options.useConvHmx = (value == "1" || value == "true");
+    } else {
+        LOGI("NpuOptionsImpl: unknown option %s\n", key.c_str());
+        return;
+    }
+    options_ = delegate_options;
+#endif
 }
 
 std::string NpuOptionsImpl::get_value_for_option(const std::string& key) const {
-    // TODO: Implement this when delegate options are configurable
+#if QNN_DELEGATE
+    auto delegate_options = std::any_cast<TfLiteQnnDelegateOptions>(options_);
+
+    if (key == "backend") {
+        return (delegate_options.backend_type == kGpuBackend) ? "gpu" : "htp";
+    } else if (key == "precision") {
+        return (delegate_options.htp_options.precision == kHtpQuantized) ? "quantized" : "fp16";
+    } else if (key == "performance_mode") {
+        switch (delegate_options.htp_options.performance_mode) {
+            case kHtpBurst:
+                return "burst";
+            case kHtpSustainedHighPerformance:
+                return "sustained";
+            case kHtpBalanced:
+                return "balanced";
+            default:
+                return "high";
+        }
+    } else if (key == "use_conv_hmx") {
+        return delegate_options.htp_options.useConvHmx ? "1" : "0";
+    }
+#endif
     return "";
 }
 
@@ -75,11 +121,39 @@ std::any GpuOptionsImpl::get_options() { return options_; }
 GpuOptionsImpl::~GpuOptionsImpl() {}
 
 void GpuOptionsImpl::set_value_for_option(const std::string& key, const std::string& value) {
-    // TODO: Implement this when delegate options are configurable
+#if GPU_DELEGATE
+    auto delegate_options = std::any_cast<TfLiteGpuDelegateOptionsV2>(options_);
+
+    if (key == "precision_loss_allowed") {
+        delegate_options.is_precision_loss_allowed = (value == "1" || value == "true") ? 1 : 0;
+    } else if (key == "inference_preference") {
+        delegate_options.inference_preference = (value == "sustained_speed")
+                                                    ? TFLITE_GPU_INFERENCE_PREFERENCE_SUSTAINED_SPEED
+                                                    : TFLITE_GPU_INFERENCE_PREFERENCE_FAST_SINGLE_ANSWER;
+    } else if (key == "max_delegated_partitions") {
+        delegate_options.max_delegated_partitions = std::stoi(value);
+    } else {
+        LOGI("GpuOptionsImpl: unknown option %s\n", key.c_str());
+        return;
+    }
+    options_ = delegate_options;
+#endif
 }
 
 std::string GpuOptionsImpl::get_value_for_option(const std::string& key) const {
-    // TODO: Implement this when delegate options are configurable
+#if GPU_DELEGATE
+    auto delegate_options = std::any_cast<TfLiteGpuDelegateOptionsV2>(options_);
+
+    if (key == "precision_loss_allowed") {
+        return delegate_options.is_precision_loss_allowed ? "1" : "0";
+    } else if (key == "inference_preference") {
+        return (delegate_options.inference_preference == TFLITE_GPU_INFERENCE_PREFERENCE_SUSTAINED_SPEED)
+                   ? "sustained_speed"
+                   : "fast_single_answer";
+    } else if (key == "max_delegated_partitions") {
+        return std::to_string(delegate_options.max_delegated_partitions);
+    }
+#endif
     return "";
 }
 
@@ -90,14 +164,43 @@ CpuOptionsImpl::CpuOptionsImpl() : BaseDelegateOptions() {
 
 CpuOptionsImpl::~CpuOptionsImpl() {}
 
-std::any CpuOptionsImpl::get_options() { return options_; }
+std::any CpuOptionsImpl::get_options() {
+    auto delegate_options = std::any_cast<TfLiteXNNPackDelegateOptions>(options_);
+    delegate_options.weight_cache_file_path =
+        weight_cache_file_path_.empty() ? nullptr : weight_cache_file_path_.c_str();
+    return delegate_options;
+}
 
 void CpuOptionsImpl::set_value_for_option(const std::string& key, const std::string& value) {
-    // TODO: Implement this when delegate options are configurable
+    auto delegate_options = std::any_cast<TfLiteXNNPackDelegateOptions>(options_);
+
+    if (key == "num_threads") {
+        delegate_options.num_threads = std::stoi(value);
+    } else if (key == "force_fp16") {
+        if (value == "1" || value == "true") {
+            delegate_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
+        } else {
+            delegate_options.flags &= ~TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
+        }
+    } else if (key == "weight_cache_file_path") {
+        weight_cache_file_path_ = value;
+    } else {
+        LOGI("CpuOptionsImpl: unknown option %s\n", key.c_str());
+        return;
+    }
+    options_ = delegate_options;
 }
 
 std::string CpuOptionsImpl::get_value_for_option(const std::string& key) const {
-    // TODO: Implement this when delegate options are configurable
+    auto delegate_options = std::any_cast<TfLiteXNNPackDelegateOptions>(options_);
+
+    if (key == "num_threads") {
+        return std::to_string(delegate_options.num_threads);
+    } else if (key == "force_fp16") {
+        return (delegate_options.flags & TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16) ? "1" : "0";
+    } else if (key == "weight_cache_file_path") {
+        return weight_cache_file_path_;
+    }
     return "";
 }
 
@@ -128,69 +231,79 @@ DelegateManager::DelegateManager() {}
 
 void DelegateManager::initialize(DelegateManagerConfiguration& config) { configuration = config; }
 
-TfLiteDelegate* DelegateManager::getDelegateForBackend(WhisperKit::Delegates::BackendType backend) {
-    try {
-        checkInitialization();
-    } catch (const std::exception& e) {
-        LOGI("DelegateManager::getDelegateForBackend: %s", e.what());
-        return nullptr;
-    }
+BaseDelegateOptions* DelegateManager::getDelegateOptionsForBackend(BackendType backend) {
+    return configuration.getDelegateOptionsForBackend(backend).get();
+}
 
+TfLiteDelegatePtr DelegateManager::createDelegateForBackend(
+    BackendType backend, const std::string& model_token,
+    const std::unordered_map<std::string, std::string>& overrides) {
     auto delegate_options = configuration.getDelegateOptionsForBackend(backend);
 
     if (!delegate_options) {
-        LOGI("DelegateManager::getDelegateForBackend: No delegate options for backend %d available.", backend);
+        LOGI("DelegateManager::createDelegateForBackend: No delegate options for backend %d available.", backend);
         return nullptr;
     }
 
     switch (backend) {
         case WhisperKit::Delegates::BackendType::WHISPERKIT_BACKEND_NPU_QCOM: {
 #if QNN_DELEGATE
-            if (!npu_delegate_) {
-                if (_lib_dir.empty() || _cache_dir.empty()) {
-                    LOGI("DelegateManager::NPU: lib_dir or cache_dir is not set");
-                    return nullptr;
-                }
-
-                auto _options = std::any_cast<TfLiteQnnDelegateOptions>(delegate_options->get_options());
+            if (_lib_dir.empty() || _cache_dir.empty()) {
+                LOGI("DelegateManager::NPU: lib_dir or cache_dir is not set");
+                return nullptr;
+            }
 
-                _options.skel_library_dir = _lib_dir.c_str();
-                _options.cache_dir = _cache_dir.c_str();
-                _options.model_token = _model_token.c_str();
+            auto npu_options =
+                std::make_shared<NpuOptionsImpl>(*std::static_pointer_cast<NpuOptionsImpl>(delegate_options));
+            for (auto& [key, value] : overrides) npu_options->set_value_for_option(key, value);
+            auto strings = std::make_shared<std::array<std::string, 3>>(
+                std::array<std::string, 3>{_lib_dir, _cache_dir, model_token});
 
-                npu_delegate_ = TfLiteQnnDelegateCreate(&_options);
-            }
+            auto _options = std::any_cast<TfLiteQnnDelegateOptions>(npu_options->get_options());
+            _options.skel_library_dir = (*strings)[0].c_str();
+            _options.cache_dir = (*strings)[1].c_str();
+            _options.model_token = (*strings)[2].c_str();
 
-            return npu_delegate_;
+            return TfLiteDelegatePtr(TfLiteQnnDelegateCreate(&_options),
+                                     [strings](TfLiteDelegate* delegate) { TfLiteQnnDelegateDelete(delegate); });
 #else
             return nullptr;
 #endif
         }
         case WhisperKit::Delegates::BackendType::WHISPERKIT_BACKEND_GPU: {
 #if GPU_DELEGATE
-            if (!gpu_delegate_) {
-                if (_cache_dir.empty()) {
-                    LOGI("DelegateManager::GPU: cache_dir is not set");
-                    return nullptr;
-                }
+            if (_cache_dir.empty()) {
+                LOGI("DelegateManager::GPU: cache_dir is not set");
+                return nullptr;
+            }
 
-                auto gpu_options = std::any_cast<TfLiteGpuDelegateOptionsV2>(delegate_options->get_options());
-                gpu_options.serialization_dir = _cache_dir.c_str();
+            auto gpu_delegate_options =
+                std::make_shared<GpuOptionsImpl>(*std::static_pointer_cast<GpuOptionsImpl>(delegate_options));
+            for (auto& [key, value] : overrides) gpu_delegate_options->set_value_for_option(key, value);
+            auto strings =
+                std::make_shared<std::array<std::string, 2>>(std::array<std::string, 2>{_cache_dir, model_token});
 
-                gpu_delegate_ = TfLiteGpuDelegateV2Create(&gpu_options);
-            }
-            return gpu_delegate_;
+            auto gpu_options = std::any_cast<TfLiteGpuDelegateOptionsV2>(gpu_delegate_options->get_options());
+            gpu_options.serialization_dir = (*strings)[0].c_str();
+            gpu_options.model_token = (*strings)[1].c_str();
+
+            return TfLiteDelegatePtr(TfLiteGpuDelegateV2Create(&gpu_options),
+                                     [strings](TfLiteDelegate* delegate) { TfLiteGpuDelegateV2Delete(delegate); });
 #else
             return nullptr;
 #endif
         }
 
         case WhisperKit::Delegates::BackendType::WHISPERKIT_BACKEND_CPU: {
-            if (!cpu_delegate_) {
-                auto cpu_options = std::any_cast<TfLiteXNNPackDelegateOptions>(delegate_options->get_options());
-                cpu_delegate_ = TfLiteXNNPackDelegateCreate(&cpu_options);
-            }
-            return cpu_delegate_;
+            // the copy owns the weight cache path referenced by the XNNPack options
+            auto cpu_delegate_options =
+                std::make_shared<CpuOptionsImpl>(*std::static_pointer_cast<CpuOptionsImpl>(delegate_options));
+            for (auto& [key, value] : overrides) cpu_delegate_options->set_value_for_option(key, value);
+
+            auto cpu_options = std::any_cast<TfLiteXNNPackDelegateOptions>(cpu_delegate_options->get_options());
+            return TfLiteDelegatePtr(
+                TfLiteXNNPackDelegateCreate(&cpu_options),
+                [cpu_delegate_options](TfLiteDelegate* delegate) { TfLiteXNNPackDelegateDelete(delegate); });
         }
         case WhisperKit::Delegates::BackendType::WHISPERKIT_BACKEND_EXPERIMENTAL:
             return nullptr;
@@ -199,32 +312,8 @@ TfLiteDelegate* DelegateManager::getDelegateForBackend(WhisperKit::Delegates::Ba
     }
 }
 
-void DelegateManager::checkInitialization() const {
-    if (_lib_dir.empty() || _cache_dir.empty()) {
-        throw std::runtime_error("DelegateManager: lib_dir or cache_dir is not set");
-    }
-}
-
 void DelegateManager::set_lib_dir(const std::string& lib_dir) { _lib_dir = lib_dir; }
 
 void DelegateManager::set_cache_dir(const std::string& cache_dir) { _cache_dir = cache_dir; }
 
-void DelegateManager::set_model_token(const std::string& model_token) { _model_token = model_token; }
-
-DelegateManager::~DelegateManager() {
-#if QNN_DELEGATE
-    if (npu_delegate_) {
-        TfLiteQnnDelegateDelete(npu_delegate_);
-    }
-#endif
-
-#if GPU_DELEGATE
-    if (gpu_delegate_) {
-        TfLiteGpuDelegateV2Delete(gpu_delegate_);
-    }
-#endif
-
-    if (cpu_delegate_) {
-        TfLiteXNNPackDelegateDelete(cpu_delegate_);
-    }
-}
+DelegateManager::~DelegateManager() {}
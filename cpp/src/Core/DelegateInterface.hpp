@@ -1,6 +1,7 @@
 #pragma once
 
 #include <any>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -34,6 +35,8 @@ class BaseDelegateOptions {
     std::any options_;
 };
 
+// QNN options; supported keys: "backend" (htp/gpu), "precision" (fp16/quantized),
+// "performance_mode" (high/sustained/burst/balanced), "use_conv_hmx" ("0"/"1")
 class NpuOptionsImpl : public BaseDelegateOptions {
    public:
     NpuOptionsImpl();
@@ -43,6 +46,8 @@ class NpuOptionsImpl : public BaseDelegateOptions {
     std::string get_value_for_option(const std::string& key) const override;
 };
 
+// GPU options; supported keys: "precision_loss_allowed" ("0"/"1"),
+// "inference_preference" (fast_single_answer/sustained_speed), "max_delegated_partitions"
 class GpuOptionsImpl : public BaseDelegateOptions {
    public:
     GpuOptionsImpl();
@@ -52,6 +57,8 @@ class GpuOptionsImpl : public BaseDelegateOptions {
     std::string get_value_for_option(const std::string& key) const override;
 };
 
+// XNNPack options; supported keys: "num_threads", "force_fp16" ("0"/"1"),
+// "weight_cache_file_path" (empty string disables the persistent weight cache)
 class CpuOptionsImpl : public BaseDelegateOptions {
    public:
     CpuOptionsImpl();
@@ -59,6 +66,10 @@ class CpuOptionsImpl : public BaseDelegateOptions {
     std::any get_options() override;
     void set_value_for_option(const std::string& key, const std::string& value) override;
     std::string get_value_for_option(const std::string& key) const override;
+
+   private:
+    // backing storage for the const char* in TfLiteXNNPackDelegateOptions
+    std::string weight_cache_file_path_;
 };
 
 class DelegateManagerConfiguration {
@@ -73,16 +84,28 @@ class DelegateManagerConfiguration {
 // in common.h from tflite
 struct TfLiteDelegate;
 
+// owning delegate handle; the deleter also keeps the strings referenced by the delegate options alive
+using TfLiteDelegatePtr = std::unique_ptr<TfLiteDelegate, std::function<void(TfLiteDelegate*)>>;
+
+/*
+    Creates delegates from a configuration shared by all models of a pipeline.
+
+    Delegate instances are per model: GPU serialization, QNN context caches and
+    XNNPack weight caches are all keyed by model, and a GPU delegate cannot be
+    applied to more than one interpreter.
+*/
 class DelegateManager {
    public:
     DelegateManager();
 
-    TfLiteDelegate* getDelegateForBackend(BackendType backend);
+    // nullptr if the backend is not available in this build.
+    // overrides are set_value_for_option() key/values applied on top of the shared options.
+    TfLiteDelegatePtr createDelegateForBackend(BackendType backend, const std::string& model_token,
+                                               const std::unordered_map<std::string, std::string>& overrides = {});
     BaseDelegateOptions* getDelegateOptionsForBackend(BackendType backend);
 
     void set_lib_dir(const std::string& lib_dir);
     void set_cache_dir(const std::string& cache_dir);
-    void set_model_token(const std::string& model_token);
 
     void initialize(DelegateManagerConfiguration& config);
 
@@ -92,19 +115,8 @@ class DelegateManager {
     DelegateManager& operator=(const DelegateManager&) = delete;
 
    private:
-    void checkInitialization() const;
-
     DelegateManagerConfiguration configuration;
 
-    // TODO: these should be moved elsewhere and made pass through to the delegate options
-    // prior to delegate creation.
     std::string _lib_dir;
     std::string _cache_dir;
-    std::string _model_token;
-    bool initialized_ = false;
-
-    TfLiteDelegate* npu_delegate_ = nullptr;
-    TfLiteDelegate* gpu_delegate_ = nullptr;
-    TfLiteDelegate* cpu_delegate_ = nullptr;
-    TfLiteDelegate* experimental_delegate_ = nullptr;
 };
@@ -0,0 +1,113 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "ModelRegistry.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "tensorflow/lite/model.h"
+#include "tflite_msg.hpp"
+
+using namespace WhisperKit;
+
+namespace {
+
+// Hashing a multi-GB model on every build would cost more than loading it,
+// so only the first and last blocks are hashed, together with the file size.
+constexpr const std::streamsize kHashBlockSize = (64 << 10);
+
+uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}  // namespace
+
+ModelRegistry& ModelRegistry::instance() {
+    static ModelRegistry registry;
+    return registry;
+}
+
+uint64_t ModelRegistry::content_hash(const std::string& path) {
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return 0;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> block(kHashBlockSize);
+    file.read(block.data(), kHashBlockSize);
+    auto hash = fnv1a(block.data(), file.gcount());
+
+    if (file_size > (uint64_t)kHashBlockSize) {
+        file.clear();
+        file.seekg(-kHashBlockSize, std::ios::end);
+        file.read(block.data(), kHashBlockSize);
+        hash = fnv1a(block.data(), file.gcount(), hash);
+    }
+    return fnv1a(reinterpret_cast<const char*>(&file_size), sizeof(file_size), hash);
+}
+
+std::string ModelRegistry::content_key(const std::string& path) {
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    if (ec || !std::filesystem::exists(path)) {
+        return path;
+    }
+
+    std::stringstream ss;
+    ss << canonical.string() << ":" << std::hex << content_hash(path);
+    return ss.str();
+}
+
+std::string ModelRegistry::content_id(const std::string& path) {
+    auto key = content_key(path);
+    std::stringstream ss;
+    ss << std::hex << fnv1a(key.data(), key.size());
+    return ss.str();
+}
+
+std::shared_ptr<tflite::FlatBufferModel> ModelRegistry::acquire_model(const std::string& model_path) {
+    auto key = content_key(model_path);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (auto model = _models[key].lock()) {
+        return model;
+    }
+
+    std::shared_ptr<tflite::FlatBufferModel> model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+    if (model == nullptr) {
+        LOGE("ModelRegistry: failed to load %s\n", model_path.c_str());
+        _models.erase(key);
+        return nullptr;
+    }
+    _models[key] = model;
+    return model;
+}
+
+std::shared_ptr<Tokenizer> ModelRegistry::acquire_tokenizer(const std::string& tokenizer_json,
+                                                            const std::string& tokenizer_config_json) {
+    auto key = content_key(tokenizer_json) + "|" + content_key(tokenizer_config_json);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (auto tokenizer = _tokenizers[key].lock()) {
+        return tokenizer;
+    }
+
+    auto* raw_tokenizer = tokenizer_init_from_file(tokenizer_json.c_str(), tokenizer_config_json.c_str());
+    if (raw_tokenizer == nullptr) {
+        LOGE("ModelRegistry: failed to load tokenizer %s\n", tokenizer_json.c_str());
+        _tokenizers.erase(key);
+        return nullptr;
+    }
+
+    std::shared_ptr<Tokenizer> tokenizer(raw_tokenizer, [](Tokenizer* t) { tokenizer_free(t); });
+    _tokenizers[key] = tokenizer;
+    return tokenizer;
+}
@@ -0,0 +1,55 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Tokenizer.h"
+
+namespace tflite {
+class FlatBufferModel;
+}
+
+namespace WhisperKit {
+
+/*
+    Process-wide registry of read-only model resources.
+
+    Pipelines built from the same model directory share one FlatBufferModel per
+    .tflite file and one tokenizer, while each pipeline keeps its own interpreters
+    and tensor arenas. Entries are reference counted through shared_ptr: the
+    registry only holds weak references, so a resource is released as soon as the
+    last pipeline using it is destroyed.
+*/
+class ModelRegistry {
+   public:
+    static ModelRegistry& instance();
+
+    std::shared_ptr<tflite::FlatBufferModel> acquire_model(const std::string& model_path);
+    std::shared_ptr<Tokenizer> acquire_tokenizer(const std::string& tokenizer_json,
+                                                 const std::string& tokenizer_config_json);
+
+    // hash of the file size and the head and tail of the file, path independent
+    static uint64_t content_hash(const std::string& path);
+    // hex id of the canonical path and content_hash(), for naming files derived from the model
+    static std::string content_id(const std::string& path);
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+   private:
+    ModelRegistry() = default;
+
+    // canonical path + content_hash()
+    static std::string content_key(const std::string& path);
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::weak_ptr<tflite::FlatBufferModel>> _models;
+    std::unordered_map<std::string, std::weak_ptr<Tokenizer>> _tokenizers;
+};
+
+}  // namespace WhisperKit
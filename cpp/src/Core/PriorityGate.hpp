@@ -0,0 +1,61 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace WhisperKit {
+
+enum class Priority {
+    Realtime = 0,  // live streams, with a deadline
+    Batch = 1,     // file transcription, fills idle capacity
+};
+
+/*
+    Exclusive access to a runtime, handed out by priority class.
+
+    A batch holder is only admitted while no realtime work is waiting, and checks
+    realtime_waiting() at its own step boundaries to give the runtime up early.
+    Within a class, waiters are admitted in no particular order.
+*/
+class PriorityGate {
+   public:
+    static constexpr int kNumClasses = 2;
+
+    // blocks until admitted; returns how long the caller waited, in ms
+    float acquire(Priority priority) {
+        auto before = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting[(int)priority]++;
+        _cond.wait(lock, [&] {
+            return !_held && (priority == Priority::Realtime || _waiting[(int)Priority::Realtime] == 0);
+        });
+        _waiting[(int)priority]--;
+        _held = true;
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - before).count();
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _held = false;
+        }
+        _cond.notify_all();
+    }
+
+    bool realtime_waiting() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _waiting[(int)Priority::Realtime] > 0;
+    }
+
+   private:
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::array<int, kNumClasses> _waiting = {};
+    bool _held = false;
+};
+
+}  // namespace WhisperKit
@@ -0,0 +1,33 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "ProcessStats.hpp"
+
+#include <fstream>
+#include <string>
+
+namespace {
+
+long read_status_field_kb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            try {
+                return std::stol(line.substr(field.size()));
+            } catch (...) {
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+namespace WhisperKit::ProcessStats {
+
+long current_rss_kb() { return read_status_field_kb("VmRSS:"); }
+
+long peak_rss_kb() { return read_status_field_kb("VmHWM:"); }
+
+}  // namespace WhisperKit::ProcessStats
@@ -0,0 +1,12 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+namespace WhisperKit::ProcessStats {
+
+// resident set size of the current process, in KB (0 if unavailable)
+long current_rss_kb();
+// peak resident set size (high water mark) of the current process, in KB
+long peak_rss_kb();
+
+}  // namespace WhisperKit::ProcessStats
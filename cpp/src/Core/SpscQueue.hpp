@@ -0,0 +1,92 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace WhisperKit {
+
+/*
+    Bounded lock-free queue for exactly one producer and one consumer thread.
+
+    try_push()/try_pop() never block. push()/pop() block while the queue is full/empty,
+    which is how a pipeline stage applies backpressure to the stage before it. Blocking
+    uses atomic wait/notify, so idle stages sleep instead of spinning.
+    Items are popped in the order they were pushed.
+*/
+template <typename T>
+class SpscQueue {
+   public:
+    explicit SpscQueue(size_t capacity) : _slots(capacity + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // false if the queue is full; item is left untouched in that case
+    bool try_push(T& item) {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        const auto next = (tail + 1) % _slots.size();
+        if (next == _head.load(std::memory_order_acquire)) return false;
+
+        _slots[tail] = std::move(item);
+        _tail.store(next, std::memory_order_release);
+        notify();
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        const auto head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+
+        item = std::move(_slots[head]);
+        _head.store((head + 1) % _slots.size(), std::memory_order_release);
+        notify();
+        return true;
+    }
+
+    // blocks while full; false if the queue was closed
+    bool push(T item) {
+        while (true) {
+            auto events = _events.load(std::memory_order_acquire);
+            if (_closed.load(std::memory_order_acquire)) return false;
+            if (try_push(item)) return true;
+            _events.wait(events, std::memory_order_acquire);
+        }
+    }
+
+    // blocks while empty; false once the queue is closed and drained
+    bool pop(T& item) {
+        while (true) {
+            auto events = _events.load(std::memory_order_acquire);
+            if (try_pop(item)) return true;
+            if (_closed.load(std::memory_order_acquire)) return false;
+            _events.wait(events, std::memory_order_acquire);
+        }
+    }
+
+    // wakes up blocked producer & consumer
+    void close() {
+        _closed.store(true, std::memory_order_release);
+        notify();
+    }
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+   private:
+    void notify() {
+        _events.fetch_add(1, std::memory_order_acq_rel);
+        _events.notify_all();
+    }
+
+    std::vector<T> _slots;
+    alignas(64) std::atomic<size_t> _head{0};  // next slot to pop, owned by the consumer
+    alignas(64) std::atomic<size_t> _tail{0};  // next slot to push, owned by the producer
+    alignas(64) std::atomic<uint32_t> _events{0};
+    std::atomic<bool> _closed{false};
+};
+
+}  // namespace WhisperKit
@@ -0,0 +1,24 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace WhisperKit {
+
+// regions of the audio packed into one encoder window: (start in the window, start in the audio), in seconds
+using TimestampMap = std::vector<std::pair<float, float>>;
+
+// window time -> audio time, relative to the last region starting at or before window_time
+inline float to_audio_time(const TimestampMap& map, float window_time) {
+    if (map.empty()) return window_time;
+
+    auto region = map.begin();
+    for (auto it = map.begin(); it != map.end() && it->first <= window_time; it++) {
+        region = it;
+    }
+    return region->second + (window_time - region->first);
+}
+
+}  // namespace WhisperKit
@@ -0,0 +1,94 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "TuningProfile.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "ModelRegistry.hpp"
+#include "tflite_msg.hpp"
+
+using namespace WhisperKit;
+
+nlohmann::json ModelTuning::to_json() const {
+    return {{"backend", backend},
+            {"numThreads", num_threads},
+            {"fp16", force_fp16},
+            {"latencyMs", latency_ms}};
+}
+
+ModelTuning ModelTuning::from_json(const nlohmann::json& tuning) {
+    ModelTuning result;
+    result.backend = tuning.value("backend", result.backend);
+    result.num_threads = tuning.value("numThreads", result.num_threads);
+    result.force_fp16 = tuning.value("fp16", result.force_fp16);
+    result.latency_ms = tuning.value("latencyMs", result.latency_ms);
+    return result;
+}
+
+TuningProfile::TuningProfile(const std::string& cache_dir, const std::string& device,
+                             const std::vector<std::string>& model_files) {
+    uint64_t model_hash = 0;
+    for (auto& file : model_files) {
+        model_hash = model_hash * 31 + ModelRegistry::content_hash(file);
+    }
+
+    std::string device_token;
+    for (char c : device) {
+        device_token += (isalnum(c) || c == '-') ? c : '_';
+    }
+
+    std::stringstream ss;
+    ss << std::hex << model_hash;
+
+    _path = cache_dir + "/tuning_" + device_token + "_" + ss.str() + ".json";
+    _profile["device"] = device;
+    _profile["modelHash"] = ss.str();
+    _profile["models"] = nlohmann::json::object();
+}
+
+bool TuningProfile::load() {
+    std::ifstream file(_path);
+    if (!file.is_open()) return false;
+
+    try {
+        auto profile = nlohmann::json::parse(file);
+        if (profile.value("modelHash", "") != _profile["modelHash"]) return false;
+        _profile["models"] = profile.at("models");
+    } catch (const std::exception& e) {
+        LOGE("TuningProfile: ignoring invalid profile %s: %s\n", _path.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool TuningProfile::save() const {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(_path).parent_path(), ec);
+
+    std::ofstream file(_path);
+    if (!file.is_open()) {
+        LOGE("TuningProfile: failed to write %s\n", _path.c_str());
+        return false;
+    }
+    file << _profile.dump(2) << std::endl;
+    return true;
+}
+
+std::optional<ModelTuning> TuningProfile::get(const std::string& model_name) const {
+    auto& models = _profile["models"];
+    if (!models.contains(model_name)) return std::nullopt;
+    return ModelTuning::from_json(models[model_name]);
+}
+
+void TuningProfile::set(const std::string& model_name, const ModelTuning& tuning) {
+    _profile["models"][model_name] = tuning.to_json();
+}
+
+bool TuningProfile::contains_all(const std::vector<std::string>& model_names) const {
+    for (auto& name : model_names) {
+        if (!_profile["models"].contains(name)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace WhisperKit {
+
+// Interpreter configuration of one model, as picked by the autotuner
+struct ModelTuning {
+    int backend = 1;          // ComputeBackend; CPUBuiltin for builtin kernels only
+    int num_threads = 0;      // 0: keep the thread placement's count
+    bool force_fp16 = false;  // XNNPack FORCE_FP16
+    float latency_ms = 0;     // median latency measured while tuning
+
+    nlohmann::json to_json() const;
+    static ModelTuning from_json(const nlohmann::json& tuning);
+};
+
+/*
+    Per-model tunings persisted as JSON in the cache directory.
+
+    Profiles are keyed by device and by the content of the model files, so a
+    profile is never applied to another device or to a different model build.
+*/
+class TuningProfile {
+   public:
+    TuningProfile(const std::string& cache_dir, const std::string& device, const std::vector<std::string>& model_files);
+
+    bool load();
+    bool save() const;
+
+    std::optional<ModelTuning> get(const std::string& model_name) const;
+    void set(const std::string& model_name, const ModelTuning& tuning);
+    bool contains_all(const std::vector<std::string>& model_names) const;
+
+    const std::string& path() const { return _path; }
+    nlohmann::json to_json() const { return _profile; }
+
+   private:
+    std::string _path;
+    nlohmann::json _profile;
+};
+
+}  // namespace WhisperKit
@@ -0,0 +1,118 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace WhisperKit {
+
+/*
+    One work queue per worker thread, fed round robin by any number of producers.
+
+    A worker takes items from the front of its own queue; once that is empty, it steals
+    from the back of the other workers' queues, so a worker stuck on slow items does not
+    hold up the items queued behind it.
+
+    With a capacity, producers block while that many items are queued across all workers,
+    so that fast producers don't buffer their whole input ahead of the workers.
+*/
+template <typename T>
+class WorkStealingQueues {
+   public:
+    // capacity: of all queues together, 0 for unbounded
+    explicit WorkStealingQueues(int num_workers, size_t capacity = 0) : _capacity(capacity) {
+        for (int i = 0; i < num_workers; i++) {
+            _queues.push_back(std::make_unique<WorkerQueue>());
+        }
+    }
+
+    // blocks while the queues are full, unless closed
+    void push(T item) {
+        size_t next;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _space_cond.wait(lock, [this] { return _capacity == 0 || _queued < _capacity || _closed; });
+            _queued++;
+            next = _next++;
+        }
+        auto& queue = *_queues[next % _queues.size()];
+        {
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            queue.items.push_back(std::move(item));
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending++;
+        }
+        _cond.notify_one();
+    }
+
+    // blocks until an item is available; false once closed and all queues are drained
+    bool pop(int worker, T& item, bool* stolen = nullptr) {
+        while (true) {
+            for (size_t i = 0; i < _queues.size(); i++) {
+                if (!try_pop(*_queues[(worker + i) % _queues.size()], item, i == 0)) continue;
+
+                if (stolen) *stolen = (i != 0);
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _pending--;
+                    _queued--;
+                }
+                _space_cond.notify_one();
+                return true;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this] { return _pending > 0 || _closed; });
+            if (_pending <= 0 && _closed) return false;
+        }
+    }
+
+    // no more items will be pushed; wakes up idle workers, and producers waiting for space
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _cond.notify_all();
+        _space_cond.notify_all();
+    }
+
+   private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<T> items;
+    };
+
+    static bool try_pop(WorkerQueue& queue, T& item, bool own) {
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        if (queue.items.empty()) return false;
+
+        if (own) {
+            item = std::move(queue.items.front());
+            queue.items.pop_front();
+        } else {
+            item = std::move(queue.items.back());
+            queue.items.pop_back();
+        }
+        return true;
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::condition_variable _space_cond;  // producers waiting for a full pool
+    size_t _next = 0;
+    // may briefly go negative, when an item is popped before the push counted it
+    long _pending = 0;
+    size_t _capacity;
+    size_t _queued = 0;  // items pushed & not popped yet, counted before they are queued
+    bool _closed = false;
+};
+
+}  // namespace WhisperKit
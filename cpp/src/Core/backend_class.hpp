@@ -7,22 +7,21 @@ enum ComputeBackend {
     CPU = 1,
     GPU = 2,
     NPU = 3,
+    // TFLite builtin kernels, no delegate
+    CPUBuiltin = 4,
 };
 
-#if QNN_DELEGATE
-#include "tflite_qnn_model.hpp"
-#define MODEL_SUPER_CLASS TFLiteQNN
-#else
-
-#if GPU_DELEGATE
-
-#include "tflite_gpu_model.hpp"
-#define MODEL_SUPER_CLASS TFLiteGPU
-
-#else
-
-#include "tflite_model.hpp"
-#define MODEL_SUPER_CLASS TFLiteModel
-
-#endif
-#endif
+inline const char* compute_backend_name(int backend) {
+    switch (backend) {
+        case ComputeBackend::CPU:
+            return "cpu";
+        case ComputeBackend::GPU:
+            return "gpu";
+        case ComputeBackend::NPU:
+            return "npu";
+        case ComputeBackend::CPUBuiltin:
+            return "cpu_builtin";
+        default:
+            return "none";
+    }
+}
@@ -0,0 +1,192 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "DecoderStateBenchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+#include "TextDecoder.hpp"
+#include "post_proc.hpp"
+#include "tflite_msg.hpp"
+
+using namespace WhisperKit;
+
+namespace {
+constexpr int kMaxPositions = 64;  // of the timed sequence
+constexpr int kYieldSteps = 8;     // the resumed sequence is parked after these steps
+constexpr int kResumeSteps = 16;   // and compared with the uninterrupted one up to these
+
+// synthetic token ids, within any Whisper vocabulary; sequence tells the sequences apart
+int token(int sequence, int index) { return 1000 * (sequence + 1) + index; }
+
+void begin_sequence(TextDecoder& decoder, std::vector<char>& k_cache_cross, std::vector<char>& v_cache_cross) {
+    decoder.bind_input_tensor(k_cache_cross.data(), "k_cache_cross");
+    decoder.bind_input_tensor(v_cache_cross.data(), "v_cache_cross");
+    decoder.initialize_kv_cache();
+}
+
+void decode_step(TextDecoder& decoder, int x, int index) {
+    decoder.bind_input_tensor((char*)&x, "x");
+    decoder.bind_input_tensor((char*)&index, "index");
+    decoder.update_kv_cache();
+    decoder.invoke();
+}
+
+std::vector<float> logits(TextDecoder& decoder) {
+    auto [data, bytes] = decoder.get_logits_tensor();
+    const auto* values = reinterpret_cast<const float*>(data);
+    return std::vector<float>(values, values + bytes / sizeof(float));
+}
+
+// the post processor's confidence accumulates over the steps of a sequence, and starts over at index 0
+void post_process(PostProcModel* postproc, TextDecoder& decoder, int index, std::vector<int>& tokens) {
+    if (postproc == nullptr) return;
+    auto step_logits = logits(decoder);
+    postproc->process(index, step_logits.data(), (int)step_logits.size(), tokens, 0);
+}
+
+nlohmann::json summary(std::vector<float> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    return {{"p50", latencies[latencies.size() / 2]}, {"max", latencies.back()}};
+}
+}  // namespace
+
+DecoderStateBenchmark::DecoderStateBenchmark(const std::string& lib_dir, const std::string& cache_dir, int samples)
+    : _lib_dir(lib_dir), _cache_dir(cache_dir), _samples(std::max(1, samples)) {}
+
+nlohmann::json DecoderStateBenchmark::measure(TextDecoder& decoder, std::vector<char>& k_cache_cross,
+                                              std::vector<char>& v_cache_cross) {
+    auto by_positions = nlohmann::json::array();
+    std::vector<int> tokens;
+    begin_sequence(decoder, k_cache_cross, v_cache_cross);
+    for (int index = 0; index < kMaxPositions; index++) {
+        decode_step(decoder, token(0, index), index);
+        tokens.push_back(token(0, index));
+
+        const int positions = index + 1;
+        if ((positions & (positions - 1)) != 0) continue;
+        std::vector<float> save_ms, restore_ms;
+        size_t bytes = 0;
+        for (int sample = 0; sample < _samples; sample++) {
+            DecoderState state;
+            auto before = std::chrono::steady_clock::now();
+            decoder.save_state(state, index, tokens);
+            auto saved = std::chrono::steady_clock::now();
+            decoder.restore_state(state);
+            auto restored = std::chrono::steady_clock::now();
+            bytes = state.bytes();
+            save_ms.push_back(std::chrono::duration<float, std::milli>(saved - before).count());
+            restore_ms.push_back(std::chrono::duration<float, std::milli>(restored - saved).count());
+        }
+        // restores include copying the cross attention caches back, a constant cost
+        by_positions.push_back({{"positions", positions},
+                                {"bytes", bytes},
+                                {"saveMs", summary(save_ms)},
+                                {"restoreMs", summary(restore_ms)}});
+    }
+    return by_positions;
+}
+
+float DecoderStateBenchmark::check_resume(TextDecoder& decoder, std::vector<char>& k_cache_cross,
+                                          std::vector<char>& v_cache_cross, std::vector<char>& other_k_cache_cross,
+                                          std::vector<char>& other_v_cache_cross, PostProcModel* postproc,
+                                          float& logprob_diff) {
+    std::vector<int> tokens;
+    begin_sequence(decoder, k_cache_cross, v_cache_cross);
+    for (int index = 0; index < kResumeSteps; index++) {
+        decode_step(decoder, token(0, index), index);
+        post_process(postproc, decoder, index, tokens);
+        tokens.push_back(token(0, index));
+    }
+    const auto expected = logits(decoder);
+    const auto expected_confidence = postproc ? postproc->get_logprobs() : DecodingConfidence{};
+
+    tokens.clear();
+    begin_sequence(decoder, k_cache_cross, v_cache_cross);
+    for (int index = 0; index < kYieldSteps; index++) {
+        decode_step(decoder, token(0, index), index);
+        post_process(postproc, decoder, index, tokens);
+        tokens.push_back(token(0, index));
+    }
+    {
+        // parked like a preempted batch chunk, whose state is gone once it resumed
+        DecoderState parked;
+        PostProcState parked_postproc;
+        decoder.save_state(parked, kYieldSteps - 1, tokens);
+        decoder.detach_cross_kv(parked);
+        if (postproc) postproc->save_state(parked_postproc);
+        std::vector<int> other_tokens;
+        begin_sequence(decoder, other_k_cache_cross, other_v_cache_cross);
+        for (int index = 0; index < kYieldSteps / 2; index++) {
+            decode_step(decoder, token(1, index), index);
+            post_process(postproc, decoder, index, other_tokens);
+            other_tokens.push_back(token(1, index));
+        }
+        decoder.restore_state(parked);
+        if (postproc) postproc->restore_state(parked_postproc);
+    }
+    DecoderState state;
+    decoder.save_state(state, kYieldSteps - 1, tokens);
+    decoder.restore_state(state);
+    for (int index = kYieldSteps; index < kResumeSteps; index++) {
+        decode_step(decoder, token(0, index), index);
+        post_process(postproc, decoder, index, tokens);
+        tokens.push_back(token(0, index));
+    }
+    const auto resumed = logits(decoder);
+
+    logprob_diff = -1.0f;
+    if (postproc) {
+        const auto confidence = postproc->get_logprobs();
+        logprob_diff = std::max(std::fabs(confidence.avg_logprob - expected_confidence.avg_logprob),
+                                std::fabs(confidence.no_speech_prob - expected_confidence.no_speech_prob));
+    }
+
+    if (resumed.size() != expected.size() || expected.empty()) return -1.0f;
+    if (std::max_element(resumed.begin(), resumed.end()) - resumed.begin() !=
+        std::max_element(expected.begin(), expected.end()) - expected.begin()) {
+        return -1.0f;
+    }
+    float max_diff = 0;
+    for (size_t i = 0; i < expected.size(); i++) max_diff = std::max(max_diff, std::fabs(resumed[i] - expected[i]));
+    return max_diff;
+}
+
+nlohmann::json DecoderStateBenchmark::run(const std::string& model_path, int backend,
+                                          const ThreadPlacement& placement, PostProcModel* postproc) {
+    auto decoder = TextDecoderFactory::CreateFromFile(model_path);
+    decoder->set_thread_placement(placement);
+    if (!decoder->initialize(model_path, _lib_dir, _cache_dir, backend, false)) {
+        LOGE("DecoderStateBenchmark: failed to initialize %s\n", model_path.c_str());
+        decoder->uninitialize();
+        return nlohmann::json();
+    }
+
+    // cross attention caches of two sequences, sized by the decoder's inputs: zeros, and bytes that read
+    // as small finite values in fp32 & fp16 alike
+    DecoderState shapes;
+    decoder->detach_cross_kv(shapes);
+    std::vector<char> k_cache_cross(shapes.k_cache_cross_copy.size(), 0);
+    std::vector<char> v_cache_cross(shapes.v_cache_cross_copy.size(), 0);
+    std::vector<char> other_k_cache_cross(k_cache_cross.size());
+    std::vector<char> other_v_cache_cross(v_cache_cross.size());
+    for (size_t i = 0; i < other_k_cache_cross.size(); i++) other_k_cache_cross[i] = (i % 2) ? 0x3c : 0;
+    for (size_t i = 0; i < other_v_cache_cross.size(); i++) other_v_cache_cross[i] = (i % 2) ? 0x3c : 0;
+
+    nlohmann::json result;
+    result["compact"] = decoder->compact_state();
+    result["byPositions"] = measure(*decoder, k_cache_cross, v_cache_cross);
+    float logprob_diff = -1.0f;
+    const float max_diff = check_resume(*decoder, k_cache_cross, v_cache_cross, other_k_cache_cross,
+                                        other_v_cache_cross, postproc, logprob_diff);
+    const bool resumed = max_diff >= 0 && max_diff < 1e-3f && (postproc == nullptr || logprob_diff < 1e-3f);
+    result["resumeMaxLogitDiff"] = max_diff;
+    if (postproc) result["resumeLogprobDiff"] = logprob_diff;
+    result["resumeMatches"] = resumed;
+    decoder->uninitialize();
+
+    LOGI("DecoderStateBenchmark: parked sequence %s\n", resumed ? "resumed exactly" : "diverged");
+    return result;
+}
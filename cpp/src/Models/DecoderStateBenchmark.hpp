@@ -0,0 +1,51 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "CpuTopology.hpp"
+
+class PostProcModel;
+class TextDecoder;
+
+namespace WhisperKit {
+
+/*
+    Measures the cost of switching a decoder between sequences (TextDecoder::save_state &
+    restore_state) on a decoder of its own, fed synthetic inputs, so that no request in
+    flight is involved.
+
+    Save & restore are timed at power of two positions. The run also checks that a parked
+    sequence resumes as if it had never been interrupted: a sequence yielded the way a
+    preempted batch chunk is (state saved, cross attention caches detached), overwritten by
+    another one, restored, and then saved & restored again once its state is gone, has to
+    produce the logits of the same steps decoded in one go. Given the runtime's post processor,
+    its confidence is parked along with the decoder state, and has to match as well.
+*/
+class DecoderStateBenchmark {
+   public:
+    DecoderStateBenchmark(const std::string& lib_dir, const std::string& cache_dir, int samples = 3);
+
+    // report of the decoder at model_path; empty if it failed to initialize. postproc, if any, processes
+    // the logits of the resume check
+    nlohmann::json run(const std::string& model_path, int backend, const ThreadPlacement& placement,
+                       PostProcModel* postproc = nullptr);
+
+   private:
+    // save & restore latencies, decoding one sequence
+    nlohmann::json measure(TextDecoder& decoder, std::vector<char>& k_cache_cross, std::vector<char>& v_cache_cross);
+    // largest logit difference between the interrupted & uninterrupted decoding, negative if the best token differs;
+    // logprob_diff: largest difference of postproc's confidence, negative without postproc
+    float check_resume(TextDecoder& decoder, std::vector<char>& k_cache_cross, std::vector<char>& v_cache_cross,
+                       std::vector<char>& other_k_cache_cross, std::vector<char>& other_v_cache_cross,
+                       PostProcModel* postproc, float& logprob_diff);
+
+    std::string _lib_dir;
+    std::string _cache_dir;
+    int _samples;
+};
+
+}  // namespace WhisperKit
@@ -0,0 +1,125 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "ModelTuner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "tflite_model.hpp"
+#include "tflite_msg.hpp"
+
+using namespace WhisperKit;
+
+ModelTuner::ModelTuner(const std::string& lib_dir, const std::string& cache_dir, int iterations)
+    : _lib_dir(lib_dir), _cache_dir(cache_dir), _iterations(std::max(1, iterations)) {}
+
+std::vector<ModelTuning> ModelTuner::candidates(const std::vector<int>& backends,
+                                                const ThreadPlacement& placement) const {
+    std::vector<ModelTuning> result;
+    const int max_threads = std::max(1, placement.num_threads);
+
+    for (int backend : backends) {
+        if (backend == ComputeBackend::CPUBuiltin) {
+            ModelTuning candidate;
+            candidate.backend = backend;
+            candidate.num_threads = max_threads;
+            result.push_back(candidate);
+            continue;
+        }
+        if (backend != ComputeBackend::CPU) {
+            ModelTuning candidate;
+            candidate.backend = backend;
+            result.push_back(candidate);
+            continue;
+        }
+
+        // powers of two up to the placement's thread count, plus the count itself
+        std::vector<int> thread_counts;
+        for (int threads = 1; threads < max_threads; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(max_threads);
+
+        std::vector<bool> fp16_options = {false};
+        if (TFLiteModel::cpu_supports_fp16()) {
+            fp16_options.push_back(true);
+        }
+
+        for (int threads : thread_counts) {
+            for (bool fp16 : fp16_options) {
+                ModelTuning candidate;
+                candidate.backend = backend;
+                candidate.num_threads = threads;
+                candidate.force_fp16 = fp16;
+                result.push_back(candidate);
+            }
+        }
+    }
+    return result;
+}
+
+float ModelTuner::measure(const std::string& model_name, const std::string& model_path, const ModelTuning& candidate,
+                          const ThreadPlacement& placement) {
+    auto model = std::make_unique<TFLiteModel>(model_name);
+    model->set_thread_placement(placement);
+    model->apply_tuning(candidate);
+
+    // a delegate that rejected the graph falls back to the CPU, which is measured by its own candidate
+    if (!model->initialize(model_path, _lib_dir, _cache_dir, candidate.backend) ||
+        model->get_backend() != candidate.backend) {
+        model->uninitialize();
+        return -1.0f;
+    }
+
+    // synthetic inputs: deterministic noise for float tensors, zeros otherwise
+    uint32_t seed = 12345;
+    for (int idx = 0; idx < model->_interpreter->inputs().size(); idx++) {
+        auto* tensor = model->_interpreter->tensor(model->_interpreter->inputs()[idx]);
+        if (tensor->type == kTfLiteFloat32) {
+            auto* data = reinterpret_cast<float*>(tensor->data.raw);
+            for (size_t i = 0; i < tensor->bytes / sizeof(float); i++) {
+                seed = seed * 1664525u + 1013904223u;
+                data[i] = ((seed >> 8) / float(1 << 24) - 0.5f) * 0.1f;
+            }
+        } else {
+            memset(tensor->data.raw, 0, tensor->bytes);
+        }
+    }
+
+    // first invoke includes lazy allocations & kernel preparation
+    model->invoke();
+    for (int i = 0; i < _iterations; i++) {
+        model->invoke(true);
+    }
+
+    auto latency = model->get_latency_median();
+    model->uninitialize();
+    return latency;
+}
+
+ModelTuning ModelTuner::tune(const std::string& model_name, const std::string& model_path,
+                             const std::vector<int>& backends, const ThreadPlacement& placement) {
+    ModelTuning best;
+    best.latency_ms = -1.0f;
+
+    for (auto& candidate : candidates(backends, placement)) {
+        auto latency = measure(model_name, model_path, candidate, placement);
+
+        auto entry = candidate.to_json();
+        entry["latencyMs"] = latency;
+        _results[model_name].push_back(entry);
+
+        if (latency < 0) {
+            LOGE("ModelTuner: %s candidate %s failed\n", model_name.c_str(), entry.dump().c_str());
+            continue;
+        }
+        if (best.latency_ms < 0 || latency < best.latency_ms) {
+            best = candidate;
+            best.latency_ms = latency;
+        }
+    }
+
+    LOGI("ModelTuner: %s -> %s\n", model_name.c_str(), best.to_json().dump().c_str());
+    return best;
+}
@@ -0,0 +1,44 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "CpuTopology.hpp"
+#include "TuningProfile.hpp"
+
+namespace WhisperKit {
+
+/*
+    Benchmarks candidate interpreter configurations of a model on synthetic inputs
+    and returns the fastest one.
+
+    Candidates cover the compute backends the build supports, including the builtin
+    kernels; for the CPU (XNNPack) backend also thread counts up to the stage's
+    placement and fp16 (when the CPU has native half precision arithmetic).
+*/
+class ModelTuner {
+   public:
+    ModelTuner(const std::string& lib_dir, const std::string& cache_dir, int iterations = 5);
+
+    ModelTuning tune(const std::string& model_name, const std::string& model_path, const std::vector<int>& backends,
+                     const ThreadPlacement& placement);
+
+    // every measured candidate, per model name
+    const nlohmann::json& get_results_json() const { return _results; }
+
+   private:
+    std::vector<ModelTuning> candidates(const std::vector<int>& backends, const ThreadPlacement& placement) const;
+    // median latency in ms, negative if the candidate failed to initialize
+    float measure(const std::string& model_name, const std::string& model_path, const ModelTuning& candidate,
+                  const ThreadPlacement& placement);
+
+    std::string _lib_dir;
+    std::string _cache_dir;
+    int _iterations;
+    nlohmann::json _results;
+};
+
+}  // namespace WhisperKit
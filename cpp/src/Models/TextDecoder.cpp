@@ -1,13 +1,17 @@
 #include "TextDecoder.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
-#include "backend_class.hpp"
+#include "ModelRegistry.hpp"
+#include "tensorflow/lite/model.h"
 #include "tensorflow/lite/schema/schema_generated.h"
+#include "tflite_model.hpp"
 
 using namespace WhisperKit;
 // 'Monolithic KV Cache' ~ corresponds to the QUIC exported Whisper models
@@ -43,16 +47,12 @@ class FlatBuffersMetadata {
    public:
     FlatBuffersMetadata(const std::string& tflite_model_path) {
         _model_file_path = tflite_model_path;
-        std::ifstream file(tflite_model_path, std::ios::binary | std::ios::ate);
-        if (!file) throw std::runtime_error("Failed to open file");
+        // the flatbuffer is shared with the decoder interpreter through the registry,
+        // instead of reading a second copy of the whole file into memory
+        _flatbuffer = ModelRegistry::instance().acquire_model(tflite_model_path);
+        if (!_flatbuffer) throw std::runtime_error("Failed to open file");
 
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-
-        _buffer = std::vector<char>(size);
-        if (!file.read(_buffer.data(), size)) throw std::runtime_error("Failed to read file");
-
-        const tflite::Model* model = tflite::GetModel(_buffer.data());
+        const tflite::Model* model = _flatbuffer->GetModel();
 
         if (!model) {
             throw std::runtime_error("Model is null");
@@ -69,8 +69,7 @@ class FlatBuffersMetadata {
         _input_tensor_indices.clear();
         _output_tensor_indices.clear();
         _subgraphs = nullptr;
-        _buffer.clear();
-        _buffer.shrink_to_fit();
+        _flatbuffer.reset();
     }
 
     const std::string& get_model_file_path() const { return _model_file_path; }
@@ -84,7 +83,7 @@ class FlatBuffersMetadata {
     void parse_model_metadata();
     std::string _model_file_path;
     const tflite::Model* _model;
-    std::vector<char> _buffer;
+    std::shared_ptr<tflite::FlatBufferModel> _flatbuffer;
     const ::flatbuffers::Vector<::flatbuffers::Offset<tflite::SubGraph>>* _subgraphs;
 
     // name -> (tensor_index, io_index)
@@ -350,6 +349,144 @@ bool is_exact_match_for_separate_kv_cache_no_alignment_heads(const tflite::Model
 
 TextDecoder::~TextDecoder() {}
 
+void TextDecoder::set_thread_placement(const WhisperKit::ThreadPlacement& placement) {
+    _decoder_model->set_thread_placement(placement);
+}
+
+void TextDecoder::apply_tuning(const WhisperKit::ModelTuning& tuning) { _decoder_model->apply_tuning(tuning); }
+
+void TextDecoder::set_delegate_manager(std::shared_ptr<DelegateManager> delegate_manager) {
+    _decoder_model->set_delegate_manager(delegate_manager);
+}
+
+int TextDecoder::get_backend() const { return _decoder_model->get_backend(); }
+
+void TextDecoder::cancel() { _decoder_model->cancel(); }
+
+void TextDecoder::release_memory() {
+    _decoder_model->release_memory();
+    // output tensors move when the arena is re-allocated
+    decoder_outputs.clear();
+}
+
+bool TextDecoder::acquire_memory() { return _decoder_model->acquire_memory(); }
+
+void TextDecoder::track_input(char* input_data, const std::string& tensor_name) {
+    if (tensor_name == "k_cache_cross") {
+        _k_cache_cross = input_data;
+    } else if (tensor_name == "v_cache_cross") {
+        _v_cache_cross = input_data;
+    } else if (tensor_name == "index") {
+        _dirty_positions = std::max(_dirty_positions, *reinterpret_cast<int*>(input_data) + 1);
+    }
+}
+
+const std::vector<TextDecoder::KVLayout>& TextDecoder::kv_layouts() {
+    if (!_kv_layouts.empty()) return _kv_layouts;
+
+    // the positions axis is the one sized for the decoding steps, or for the model's full text context;
+    // without exactly one such axis, a cache is copied whole
+    auto& interpreter = _decoder_model->_interpreter;
+    for (int output : self_kv_outputs()) {
+        const auto* tensor = interpreter->tensor(interpreter->outputs()[output]);
+        const int rank = tensor->dims->size;
+        std::vector<int> axes;
+        for (int axis = 0; axis < rank; axis++) {
+            const int extent = tensor->dims->data[axis];
+            if (extent == kMaxDecodingSteps || extent == 2 * kMaxDecodingSteps) axes.push_back(axis);
+        }
+
+        KVLayout layout = {1, 1, tensor->bytes};
+        if (axes.size() == 1) {
+            size_t elements = 1;
+            for (int axis = 0; axis < rank; axis++) elements *= tensor->dims->data[axis];
+            layout.inner = elements > 0 ? tensor->bytes / elements : 0;
+            for (int axis = 0; axis < rank; axis++) {
+                if (axis < axes[0]) layout.outer *= tensor->dims->data[axis];
+                if (axis > axes[0]) layout.inner *= tensor->dims->data[axis];
+            }
+            layout.length = tensor->dims->data[axes[0]];
+        }
+        _kv_layouts.push_back(layout);
+    }
+    return _kv_layouts;
+}
+
+void TextDecoder::detach_cross_kv(DecoderState& state) {
+    auto inputs = _decoder_model->get_input_ptrs();
+    auto [k_index, v_index] = cross_kv_inputs();
+    state.k_cache_cross_copy.assign(inputs[k_index].first, inputs[k_index].first + inputs[k_index].second);
+    state.v_cache_cross_copy.assign(inputs[v_index].first, inputs[v_index].first + inputs[v_index].second);
+    state.k_cache_cross = state.k_cache_cross_copy.data();
+    state.v_cache_cross = state.v_cache_cross_copy.data();
+}
+
+bool TextDecoder::compact_state() {
+    const auto& layouts = kv_layouts();
+    return std::all_of(layouts.begin(), layouts.end(), [](const KVLayout& layout) { return layout.length > 1; });
+}
+
+void TextDecoder::save_state(DecoderState& state, int index, const std::vector<int>& tokens) {
+    if (decoder_outputs.empty()) {
+        decoder_outputs = _decoder_model->get_output_ptrs();
+    }
+    const auto outputs = self_kv_outputs();
+    const auto& layouts = kv_layouts();
+
+    state.positions = index + 1;
+    state.self_kv.resize(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const auto& layout = layouts[i];
+        const size_t row = std::min((size_t)state.positions, layout.length) * layout.inner;
+        const char* cache = decoder_outputs[outputs[i]].first;
+        state.self_kv[i].resize(layout.outer * row);
+        for (size_t outer = 0; outer < layout.outer; outer++) {
+            memcpy(state.self_kv[i].data() + outer * row, cache + outer * layout.length * layout.inner, row);
+        }
+    }
+    if (_k_cache_cross == nullptr || _v_cache_cross == nullptr) {
+        // restored from a state: the caches only live in the inputs
+        detach_cross_kv(state);
+    } else {
+        state.k_cache_cross = _k_cache_cross;
+        state.v_cache_cross = _v_cache_cross;
+    }
+    state.tokens = tokens;
+    state.index = index + 1;
+}
+
+void TextDecoder::restore_state(const DecoderState& state) {
+    if (decoder_outputs.empty()) {
+        decoder_outputs = _decoder_model->get_output_ptrs();
+    }
+    const auto outputs = self_kv_outputs();
+    const auto& layouts = kv_layouts();
+
+    // the next update_kv_cache() feeds the outputs back as inputs
+    for (size_t i = 0; i < outputs.size() && i < state.self_kv.size(); i++) {
+        const auto& layout = layouts[i];
+        const size_t positions = std::min((size_t)state.positions, layout.length);
+        const size_t row = positions * layout.inner;
+        // positions the previous sequence wrote beyond the restored ones
+        const size_t dirty = std::min((size_t)_dirty_positions, layout.length);
+        const size_t stale = dirty > positions ? (dirty - positions) * layout.inner : 0;
+        char* cache = decoder_outputs[outputs[i]].first;
+        for (size_t outer = 0; outer < layout.outer; outer++) {
+            char* dst = cache + outer * layout.length * layout.inner;
+            memcpy(dst, state.self_kv[i].data() + outer * row, row);
+            if (stale > 0) memset(dst + row, 0, stale);
+        }
+    }
+    _dirty_positions = state.positions;
+
+    if (state.k_cache_cross != nullptr) bind_input_tensor(state.k_cache_cross, "k_cache_cross");
+    if (state.v_cache_cross != nullptr) bind_input_tensor(state.v_cache_cross, "v_cache_cross");
+    // the caches were copied into the inputs, and the state may not outlive them: a later save_state() copies the
+    // inputs rather than keep a reference into this state
+    if (state.k_cache_cross != nullptr) _k_cache_cross = nullptr;
+    if (state.v_cache_cross != nullptr) _v_cache_cross = nullptr;
+}
+
 std::unique_ptr<TextDecoder> TextDecoderFactory::CreateFromFile(const std::string& tflite_model_path) {
     auto metadata = std::make_unique<FlatBuffersMetadata>(tflite_model_path);
     auto is_monolithic_kv_cache = is_exact_match_for_monolithic_kv_cache(metadata->get_model());
@@ -375,7 +512,7 @@ MonolithicKVDecoder::MonolithicKVDecoder(const std::string& tflite_model_path) {
     // metadata->print_metadata();
 
     // Note that the decoder model is not initialized here, it is initialized in the initialize method
-    _decoder_model = std::make_unique<MODEL_SUPER_CLASS>("TextDecoder");
+    _decoder_model = std::make_unique<TFLiteModel>("TextDecoder");
 
     if (!_decoder_model) {
         throw std::runtime_error("Decoder model not initialized");
@@ -399,6 +536,7 @@ void MonolithicKVDecoder::read_input_data(char* input_data, int idx) {
 }
 
 void MonolithicKVDecoder::bind_input_tensor(char* input_data, const std::string& tensor_name) {
+    track_input(input_data, tensor_name);
     if (tensor_name == "x") {
         _decoder_model->read_input_data(input_data, 0);
         return;
@@ -444,14 +582,21 @@ void MonolithicKVDecoder::initialize_kv_cache() {
     memset(decoder_outputs[1].first, 0, decoder_outputs[1].second);
     // first v_cache_self is all zeros
     memset(decoder_outputs[2].first, 0, decoder_outputs[2].second);
+    _dirty_positions = 0;
 }
 
+std::vector<int> MonolithicKVDecoder::self_kv_outputs() { return {1, 2}; }
+
+std::pair<int, int> MonolithicKVDecoder::cross_kv_inputs() { return {2, 3}; }
+
 float MonolithicKVDecoder::get_latency_median() { return _decoder_model->get_latency_median(); }
 
 float MonolithicKVDecoder::get_latency_avg() { return _decoder_model->get_latency_avg(); }
 
 std::unique_ptr<json> MonolithicKVDecoder::get_latency_json() { return _decoder_model->get_latency_json(); }
 
+std::unique_ptr<json> MonolithicKVDecoder::get_init_json() { return _decoder_model->get_init_json(); }
+
 std::vector<std::pair<char*, int>> MonolithicKVDecoder::get_input_ptrs() { return _decoder_model->get_input_ptrs(); }
 
 std::vector<std::pair<char*, int>> MonolithicKVDecoder::get_output_ptrs() { return _decoder_model->get_output_ptrs(); }
@@ -479,10 +624,10 @@ PerLayerKVDecoder::PerLayerKVDecoder(const std::string& tflite_model_path) {
     _model_path = tflite_model_path;
     metadata = std::make_unique<FlatBuffersMetadata>(tflite_model_path);
     initialize_io_metadata();
-    metadata.reset();  // to close the .tflite file
+    metadata.reset();  // to release the metadata's reference to the .tflite file
 
     // Note that the decoder model is not initialized here, it is initialized in the initialize method
-    _decoder_model = std::make_unique<MODEL_SUPER_CLASS>("TextDecoder");
+    _decoder_model = std::make_unique<TFLiteModel>("TextDecoder");
     if (!_decoder_model) {
         throw std::runtime_error("Decoder model not initialized");
     }
@@ -503,6 +648,7 @@ void PerLayerKVDecoder::uninitialize() { _decoder_model->uninitialize(); }
 void PerLayerKVDecoder::read_input_data(char* input_data, int idx) { _decoder_model->read_input_data(input_data, idx); }
 
 void PerLayerKVDecoder::bind_input_tensor(char* input_data, const std::string& tensor_name) {
+    track_input(input_data, tensor_name);
     if (tensor_name == "x") {
         // get value in int32 and upcast to int64 before passing to read_input_data, which
         // does a simple memcpy of all the bytes.
@@ -734,6 +880,19 @@ void PerLayerKVDecoder::initialize_kv_cache() {
     for (const auto& [name, index] : kv_cache_output_tensor_indices) {
         memset(decoder_outputs[index].first, 0, decoder_outputs[index].second);
     }
+    _dirty_positions = 0;
+}
+
+std::pair<int, int> PerLayerKVDecoder::cross_kv_inputs() {
+    return {input_tensor_indices.at("k_cache_cross"), input_tensor_indices.at("v_cache_cross")};
+}
+
+std::vector<int> PerLayerKVDecoder::self_kv_outputs() {
+    std::vector<int> outputs;
+    for (const auto& [input_name, output_name] : kv_cache_io_tensor_names) {
+        outputs.push_back(kv_cache_output_tensor_indices[output_name]);
+    }
+    return outputs;
 }
 
 float PerLayerKVDecoder::get_latency_median() { return _decoder_model->get_latency_median(); }
@@ -742,6 +901,8 @@ float PerLayerKVDecoder::get_latency_avg() { return _decoder_model->get_latency_
 
 std::unique_ptr<json> PerLayerKVDecoder::get_latency_json() { return _decoder_model->get_latency_json(); }
 
+std::unique_ptr<json> PerLayerKVDecoder::get_init_json() { return _decoder_model->get_init_json(); }
+
 std::vector<std::pair<char*, int>> PerLayerKVDecoder::get_input_ptrs() { return _decoder_model->get_input_ptrs(); }
 
 std::vector<std::pair<char*, int>> PerLayerKVDecoder::get_output_ptrs() { return _decoder_model->get_output_ptrs(); }
@@ -4,20 +4,42 @@
 
 #include <nlohmann/json.hpp>
 #include <string>
+#include <vector>
 
-#include "backend_class.hpp"
+#include "tflite_model.hpp"
 
 namespace WhisperKit {
 enum DecoderKVCacheType {
     DecoderKVCacheTypeMonolothic = 0,
     DecoderKVCacheTypeSeparate = 1,
 };
-}
+
+// decoding state of one sequence, to time-slice a decoder between streams
+struct DecoderState {
+    // valid positions of each self attention cache, packed
+    std::vector<std::vector<char>> self_kv;
+    int positions = 0;
+    // bound by reference: owned by the caller, and copied into the decoder again on restore
+    char* k_cache_cross = nullptr;
+    char* v_cache_cross = nullptr;
+    // filled by TextDecoder::detach_cross_kv(), for bound caches that are overwritten before the restore
+    std::vector<char> k_cache_cross_copy;
+    std::vector<char> v_cache_cross_copy;
+    std::vector<int> tokens;
+    int index = 0;  // next decoding step
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (auto& cache : self_kv) total += cache.size();
+        return total;
+    }
+};
+}  // namespace WhisperKit
 
 class FlatBuffersMetadata;
 
 // TODO:
-// remove extraneous functions used for passthrough to MODEL_SUPER_CLASS
+// remove extraneous functions used for passthrough to TFLiteModel
 // to expedite integration
 class TextDecoder {
    public:
@@ -39,16 +61,59 @@ class TextDecoder {
     virtual float get_latency_avg() = 0;
     virtual float get_latency_median() = 0;
     virtual std::unique_ptr<json> get_latency_json() = 0;
+    virtual std::unique_ptr<json> get_init_json() = 0;
+    void set_thread_placement(const WhisperKit::ThreadPlacement& placement);
+    void apply_tuning(const WhisperKit::ModelTuning& tuning);
+    void set_delegate_manager(std::shared_ptr<DelegateManager> delegate_manager);
+    int get_backend() const;
+    void release_memory();
+    bool acquire_memory();
+    void cancel();
+
+    // state after the decoding step at index: self attention caches of positions 0..index,
+    // the bound cross attention caches (copied after a restore), and the tokens decoded so far
+    void save_state(WhisperKit::DecoderState& state, int index, const std::vector<int>& tokens);
+    // the next step continues the saved sequence, whatever was decoded in between; the decoder keeps no
+    // reference to state, which may be destroyed right after
+    void restore_state(const WhisperKit::DecoderState& state);
+    // copies the cross attention caches into the state, which references its copies from then on
+    void detach_cross_kv(WhisperKit::DecoderState& state);
+    // false if the cache layout was not recognized, and states hold whole caches
+    bool compact_state();
+
+    static constexpr int kMaxDecodingSteps = 224;
 
     virtual void dump_input_tensors() = 0;
     virtual void dump_output_tensors() = 0;
 
    protected:
+    // output indices of the self attention caches
+    virtual std::vector<int> self_kv_outputs() = 0;
+    // input indices of k_cache_cross & v_cache_cross
+    virtual std::pair<int, int> cross_kv_inputs() = 0;
+    // keeps track of the bound cross attention caches & decoding index, for save_state()
+    void track_input(char* input_data, const std::string& tensor_name);
+
     std::unique_ptr<FlatBuffersMetadata> metadata;
     // TODO: modify to hold tflite model from tensorflow & use delegate manager
-    std::unique_ptr<MODEL_SUPER_CLASS> _decoder_model;
+    std::unique_ptr<TFLiteModel> _decoder_model;
     std::string _model_path;
     std::vector<std::pair<char*, int>> decoder_outputs;
+    // cache positions written since the caches were zeroed
+    int _dirty_positions = 0;
+
+   private:
+    // cache tensor as outer x length (positions) x inner bytes
+    struct KVLayout {
+        size_t outer;
+        size_t length;
+        size_t inner;
+    };
+    const std::vector<KVLayout>& kv_layouts();
+
+    std::vector<KVLayout> _kv_layouts;
+    char* _k_cache_cross = nullptr;
+    char* _v_cache_cross = nullptr;
 };
 
 class MonolithicKVDecoder : public TextDecoder {
@@ -72,9 +137,14 @@ class MonolithicKVDecoder : public TextDecoder {
     float get_latency_avg() override;
     float get_latency_median() override;
     std::unique_ptr<json> get_latency_json() override;
+    std::unique_ptr<json> get_init_json() override;
 
     void dump_input_tensors() override;
     void dump_output_tensors() override;
+
+   protected:
+    std::vector<int> self_kv_outputs() override;
+    std::pair<int, int> cross_kv_inputs() override;
 };
 
 class PerLayerKVDecoder : public TextDecoder {
@@ -98,10 +168,15 @@ class PerLayerKVDecoder : public TextDecoder {
     float get_latency_avg() override;
     float get_latency_median() override;
     std::unique_ptr<json> get_latency_json() override;
+    std::unique_ptr<json> get_init_json() override;
 
     void dump_input_tensors() override;
     void dump_output_tensors() override;
 
+   protected:
+    std::vector<int> self_kv_outputs() override;
+    std::pair<int, int> cross_kv_inputs() override;
+
    private:
     void initialize_io_metadata();
     // self attention kv cache tensors
@@ -2,21 +2,53 @@
 //  Copyright © 2024 Argmax, Inc. All rights reserved.
 #include "tflite_model.hpp"
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+#include <unistd.h>
+
+#include <atomic>
 #include <filesystem>  // C++ 17 or later
 
+#include "ModelRegistry.hpp"
 #include "flatbuffers/flatbuffers.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
+#include "tensorflow/lite/optional_debug_tools.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
 #define TFLITE_SCHEMA_VERSION 3
 
 using namespace std;
 
+// XNNPack fails delegation with FORCE_FP16 on cores without native
+// half-precision arithmetic, so only request it when the CPU reports it.
+bool TFLiteModel::cpu_supports_fp16() {
+#if defined(__aarch64__) && defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_ASIMDHP) != 0;
+#else
+    return false;
+#endif
+}
+
 TFLiteModel::TFLiteModel(const string& name) {
-    _delegate = nullptr;
     _model_name = name;
+    _placement.num_threads = max(1, (int)thread::hardware_concurrency() - 1);
+    _force_fp16 = cpu_supports_fp16();
+}
+
+void TFLiteModel::apply_tuning(const WhisperKit::ModelTuning& tuning) {
+    if (tuning.num_threads > 0) {
+        _placement.num_threads = tuning.num_threads;
+    }
+    _force_fp16 = tuning.force_fp16 && cpu_supports_fp16();
+}
+
+void TFLiteModel::set_delegate_manager(shared_ptr<DelegateManager> delegate_manager) {
+    _delegate_manager = delegate_manager;
 }
 
 TFLiteModel::~TFLiteModel() { uninitialize(); }
@@ -140,15 +172,57 @@ bool TFLiteModel::initializeModelInMemory(WhisperKit::InMemoryModel::ModelType m
 
 bool TFLiteModel::initialize(string model_path, string lib_dir, string cache_dir, int backend, bool debug) {
     set_dirs(model_path, lib_dir, cache_dir);
+    // worker threads created by the interpreter and XNNPack inherit the affinity
+    WhisperKit::ScopedAffinity affinity(_placement.cpus);
+
+    if (_delegate_manager == nullptr) {
+        DelegateManagerConfiguration delegate_config;
+        _delegate_manager = make_shared<DelegateManager>();
+        _delegate_manager->initialize(delegate_config);
+        _delegate_manager->set_lib_dir(_lib_dir);
+        _delegate_manager->set_cache_dir(_cache_dir);
+    }
 
-    if (!create_interpreter_delegate(model_path)) {
-        LOGE("Failed with create_interpreter_delegate..\n");
+    // requested backend first, then the CPU fallbacks
+    _requested_backend = backend;
+    vector<int> backends = {backend};
+    if (backend == ComputeBackend::GPU || backend == ComputeBackend::NPU) {
+        backends.push_back(ComputeBackend::CPU);
+    }
+    if (backend != ComputeBackend::CPUBuiltin) {
+        backends.push_back(ComputeBackend::CPUBuiltin);
+    }
+
+    _backend = ComputeBackend::None;
+    for (auto candidate : backends) {
+        // a failed delegation may leave the interpreter in an unusable state, so start from a fresh one
+        uninitialize();
+        if (!create_interpreter(model_path)) {
+            LOGE("Failed with create_interpreter..\n");
+            return false;
+        }
+        if (apply_delegate(candidate)) {
+            _backend = candidate;
+            break;
+        }
+        LOGE("%s: %s backend failed, falling back..\n", _model_name.c_str(), compute_backend_name(candidate));
+    }
+    if (_backend == ComputeBackend::None) {
         return false;
     }
+
     if (!allocate_tensors()) {
         LOGE("Failed with allocate_tensors..\n");
+        finish_weight_cache(false);
         return false;
     }
+    finish_weight_cache(true);
+
+    if (debug) {
+        LOGI("\n========== %s delegation info (%s) ==========\n", _model_name.c_str(),
+             compute_backend_name(_backend));
+        tflite::PrintInterpreterState(_interpreter.get());
+    }
 
     return true;
 }
@@ -438,6 +512,36 @@ void TFLiteModel::uninitialize() {
         _interpreter->Cancel();
         _interpreter.reset(nullptr);
     }
+    // the delegate has to outlive the interpreter it was applied to
+    _delegate.reset();
+    _input_ptrs.clear();
+    _output_ptrs.clear();
+    _memory_released = false;
+}
+
+void TFLiteModel::cancel() {
+    if (_interpreter.get() != nullptr) {
+        _interpreter->Cancel();
+    }
+}
+
+void TFLiteModel::release_memory() {
+    if (_interpreter.get() == nullptr || _memory_released) return;
+
+    if (_interpreter->ReleaseNonPersistentMemory() != kTfLiteOk) {
+        LOGE("%s: failed to release non-persistent memory\n", _model_name.c_str());
+        return;
+    }
+    _input_ptrs.clear();
+    _output_ptrs.clear();
+    _memory_released = true;
+}
+
+bool TFLiteModel::acquire_memory() {
+    if (!_memory_released) return true;
+
+    _memory_released = false;
+    return allocate_tensors();
 }
 
 bool TFLiteModel::allocate_tensors() {
@@ -446,25 +550,85 @@ bool TFLiteModel::allocate_tensors() {
     return true;
 }
 
-void TFLiteModel::modify_graph_delegate() {
-    // Replace the original delegate with the new one.
-    _interpreter->ModifyGraphWithDelegate(_delegate);
-}
-
-bool TFLiteModel::create_interpreter_delegate(string model_path) {
-    _model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+bool TFLiteModel::create_interpreter(string model_path) {
+    _model = WhisperKit::ModelRegistry::instance().acquire_model(model_path);
     if (_model.get() == nullptr) return false;
 
-    tflite::ops::builtin::BuiltinOpResolver resolver;
+    // delegates are applied explicitly in apply_delegate(), so keep the resolver
+    // from lazily applying its default XNNPack delegate on top of them
+    tflite::ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
     tflite::InterpreterBuilder builder(*_model, resolver);
     TFLITE_FUNCTION_CHECK(builder(&_interpreter))
 
-    const auto processor_count = thread::hardware_concurrency();
-    _interpreter->SetNumThreads(processor_count - 1);
+    _interpreter->SetNumThreads(_placement.num_threads);
+    _interpreter->EnableCancellation();
+
+    return true;
+}
+
+bool TFLiteModel::apply_delegate(int backend) {
+    unordered_map<string, string> overrides;
+    BackendType delegate_backend;
+    _weight_cache_path.clear();
+    _weight_cache_build_path.clear();
+
+    switch (backend) {
+        case ComputeBackend::CPUBuiltin:
+            return true;
+        case ComputeBackend::GPU:
+            delegate_backend = BackendType::WHISPERKIT_BACKEND_GPU;
+            break;
+        case ComputeBackend::NPU:
+            delegate_backend = BackendType::WHISPERKIT_BACKEND_NPU_QCOM;
+            break;
+        case ComputeBackend::CPU:
+            delegate_backend = BackendType::WHISPERKIT_BACKEND_CPU;
+            overrides["num_threads"] = to_string(max(1, _placement.num_threads));
+            overrides["force_fp16"] = _force_fp16 ? "1" : "0";
+            // Packed weights depend on the model's content and the precision, so each model file and
+            // fp16 get their own cache file. XNNPack builds the file on the first run and mmaps it on later runs.
+            if (!_cache_dir.empty()) {
+                _weight_cache_path = _cache_dir + "/" + _model_token + "_" + _model_id + (_force_fp16 ? "_fp16" : "") +
+                                     ".xnnpack_cache";
+                _weight_cache_hit = filesystem::exists(_weight_cache_path);
+                if (!_weight_cache_hit) {
+                    // built under a name of its own and renamed into place once complete, so a build racing
+                    // with another process never leaves a partial file under the final name
+                    static atomic<int> builds = 0;
+                    _weight_cache_build_path =
+                        _weight_cache_path + "." + to_string(getpid()) + "_" + to_string(builds++) + ".tmp";
+                }
+                overrides["weight_cache_file_path"] = _weight_cache_hit ? _weight_cache_path : _weight_cache_build_path;
+            }
+            break;
+        default:
+            return false;
+    }
+
+    _delegate = _delegate_manager->createDelegateForBackend(delegate_backend, _model_token, overrides);
+    if (_delegate == nullptr) return false;
 
+    if (_interpreter->ModifyGraphWithDelegate(_delegate.get()) != kTfLiteOk) {
+        // for XNNPack, a stale or truncated cache file is the usual culprit; rebuild it on the next start
+        if (_weight_cache_hit && !_weight_cache_path.empty()) {
+            filesystem::remove(_weight_cache_path);
+        }
+        finish_weight_cache(false);
+        return false;
+    }
     return true;
 }
 
+void TFLiteModel::finish_weight_cache(bool keep) {
+    if (_weight_cache_build_path.empty()) return;
+
+    error_code ec;
+    // rename() replaces a file another process completed in the meantime, which holds the same weights
+    if (keep) filesystem::rename(_weight_cache_build_path, _weight_cache_path, ec);
+    if (!keep || ec) filesystem::remove(_weight_cache_build_path, ec);
+    _weight_cache_build_path.clear();
+}
+
 void TFLiteModel::read_input_file(string input_file, int idx) {
     get_input_ptrs();
     ifstream fin(input_file, ios::binary);
@@ -554,6 +718,7 @@ void TFLiteModel::invoke(bool measure_time) {
         before_exec = chrono::high_resolution_clock::now();
     }
 
+    // the calling thread takes part in the computation; the library pins its own threads once, when they start
     _interpreter->Invoke();
 
     if (measure_time) {
@@ -618,6 +783,9 @@ void TFLiteModel::set_dirs(string filename, string lib_dir, string cache_dir) {
         filesystem::create_directory(_cache_dir);
     }
 
+    // identifies the model file's content, for the files derived from it
+    _model_id = WhisperKit::ModelRegistry::content_id(filename);
+
     for (auto& size : model_sizes) {
         size_t found = filename.find(size);
         if (found != std::string::npos) {
@@ -635,6 +803,20 @@ void TFLiteModel::save_tensor(string filename, char* tensor, int size) {
     fout.close();
 }
 
+unique_ptr<json> TFLiteModel::get_init_json() {
+    auto initjson = make_unique<json>();
+
+    (*initjson)["requestedBackend"] = compute_backend_name(_requested_backend);
+    (*initjson)["backend"] = compute_backend_name(_backend);
+    if (_backend == ComputeBackend::CPU) {
+        (*initjson)["fp16"] = _force_fp16;
+    }
+    if (_backend == ComputeBackend::CPU && !_weight_cache_path.empty()) {
+        (*initjson)["weightCache"] = _weight_cache_hit ? "hit" : "miss";
+    }
+    return initjson;
+}
+
 unique_ptr<json> TFLiteModel::get_latency_json() {
     auto perfjson = make_unique<json>();
 
@@ -15,6 +15,10 @@
 #include <unordered_set>
 #include <vector>
 
+#include "CpuTopology.hpp"
+#include "DelegateInterface.hpp"
+#include "TuningProfile.hpp"
+#include "backend_class.hpp"
 #include "tensorflow/lite/builtin_ops.h"
 #include "tensorflow/lite/context_util.h"
 #include "tensorflow/lite/interpreter.h"
@@ -41,6 +45,8 @@ class TFLiteModel {
     TFLiteModel(const std::string& name);
     virtual ~TFLiteModel();
 
+    // backend: ComputeBackend to delegate to. If the delegate is unavailable or rejects the graph,
+    // the model falls back to CPU (XNNPack), then to the builtin kernels; see get_backend().
     bool initialize(std::string model_path, std::string lib_dir, std::string cache_path, int backend,
                     bool debug = false);
 
@@ -48,6 +54,26 @@ class TFLiteModel {
 
     void uninitialize();
     virtual void invoke(bool measure_time = false);
+    // interrupts invoke() on another thread; the interpreter stays usable
+    void cancel();
+
+    // Low memory mode: frees the interpreter's scratch arena, including input & output tensors.
+    // acquire_memory() has to be called before the next invoke(); it re-allocates the tensors and
+    // invalidates tensor pointers returned before the release.
+    void release_memory();
+    bool acquire_memory();
+
+    // thread count & cpu affinity of the interpreter's worker threads; must be set before initialize()
+    void set_thread_placement(const WhisperKit::ThreadPlacement& placement) { _placement = placement; }
+    // autotuned thread count & XNNPack settings; must be set before initialize()
+    void apply_tuning(const WhisperKit::ModelTuning& tuning);
+    // delegate options shared with the other models of a pipeline; must be set before initialize()
+    void set_delegate_manager(std::shared_ptr<DelegateManager> delegate_manager);
+    // ComputeBackend actually in use after initialize()
+    int get_backend() const { return _backend; }
+
+    // native half precision arithmetic, required by XNNPack's FORCE_FP16
+    static bool cpu_supports_fp16();
 
     std::mutex* get_mutex() { return &_mutex; }
     void read_input_file(std::string input_file, int idx);
@@ -62,6 +88,8 @@ class TFLiteModel {
     float get_latency_sum();
     float get_latency_avg();
     int get_inference_num() { return _latencies.size(); }
+    // delegate actually applied and XNNPack weight cache state, for the report
+    std::unique_ptr<json> get_init_json();
 
     static void save_tensor(std::string filename, char* tensor, int size);
 
@@ -71,21 +99,34 @@ class TFLiteModel {
 
    protected:
     std::mutex _mutex;
-    std::unique_ptr<tflite::FlatBufferModel> _model;
+    // shared read-only across pipelines through WhisperKit::ModelRegistry
+    std::shared_ptr<tflite::FlatBufferModel> _model;
 
     flatbuffers::FlatBufferBuilder _builder;
-    TfLiteDelegate* _delegate = nullptr;
+    std::shared_ptr<DelegateManager> _delegate_manager;
+    TfLiteDelegatePtr _delegate;
+    int _requested_backend = ComputeBackend::None;
+    int _backend = ComputeBackend::None;
+    std::string _weight_cache_path;
+    std::string _weight_cache_build_path;  // cache miss: written by XNNPack, renamed to _weight_cache_path
+    bool _weight_cache_hit = false;
+    WhisperKit::ThreadPlacement _placement;
+    bool _force_fp16 = false;
+    bool _memory_released = false;
     std::string _model_name;
     std::string _lib_dir;
     std::string _cache_dir;
     std::string _model_token;
+    std::string _model_id;  // ModelRegistry::content_id() of the model file
 
     std::vector<std::pair<char*, int>> _input_ptrs;
     std::vector<std::pair<char*, int>> _output_ptrs;
 
-    bool create_interpreter_delegate(std::string model_path);
+    bool create_interpreter(std::string model_path);
+    bool apply_delegate(int backend);
+    // moves a weight cache built by apply_delegate() into place, or drops it
+    void finish_weight_cache(bool keep);
     bool allocate_tensors();
-    void modify_graph_delegate();
     void set_dirs(std::string filename, std::string lib_dir, std::string cache_dir);
 
    private:
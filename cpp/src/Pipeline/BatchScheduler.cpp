@@ -0,0 +1,269 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "BatchScheduler.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "AudioCodec.hpp"
+#include "Chunks.hpp"
+#include "CpuTopology.hpp"
+#include "Runtime.hpp"
+#include "WorkStealingQueues.hpp"
+#include "audio_input.hpp"
+#include "tflite_msg.hpp"
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+BatchScheduler::BatchScheduler(const whisperkit_configuration_t& config, Runtime* cascade)
+    : config(config), cascade(cascade) {}
+
+BatchScheduler::~BatchScheduler() = default;
+
+std::vector<Runtime*> BatchScheduler::workers_for(int num_workers) {
+    // one replica per worker, even a single one: the main runtime's stage & token threads, which run once a callback
+    // is set, would race with the workers' chunks. Each replica gets a share of the cores; a model swap renews them,
+    // unless the session engine uses them: pinned replicas serve every later batch as they are.
+    if (!pinned && ((int)replicas.size() != num_workers || replicas_model_path != config.get_model_path())) {
+        replicas.clear();
+        replicas_model_path = config.get_model_path();
+        const int hw_threads = max(1, (int)thread::hardware_concurrency());
+        const int encoder_threads = max(1, hw_threads / num_workers);
+        auto replica_config = config;
+        replica_config.set_staged(false);
+        const std::array<std::pair<whisperkit_stage_t, int>, 3> stage_threads = {
+            {{WHISPERKIT_STAGE_MELSPECTROGRAM, 1},
+             {WHISPERKIT_STAGE_ENCODER, encoder_threads},
+             {WHISPERKIT_STAGE_DECODER, min(2, encoder_threads)}}};
+        for (auto& [stage, num_threads] : stage_threads) {
+            if (config.get_stage_threads()[stage] == 0) replica_config.set_stage_threads(stage, num_threads);
+        }
+        for (int i = 0; i < num_workers; i++) {
+            replicas.push_back(std::make_unique<Runtime>(replica_config));
+            replicas.back()->init();
+            replicas.back()->set_cascade(cascade);
+        }
+    }
+    std::vector<Runtime*> workers;
+    for (auto& replica : replicas) workers.push_back(replica.get());
+    return workers;
+}
+
+std::vector<Runtime*> BatchScheduler::pin_workers(int num_workers) {
+    lock_guard<mutex> lock(replicas_mutex);
+    auto pinned_workers = workers_for(num_workers);
+    pinned = true;
+    for (auto* worker : pinned_workers) worker->reset_stop();
+    return pinned_workers;
+}
+
+void BatchScheduler::cancel(whisperkit_status_t reason) {
+    lock_guard<mutex> lock(replicas_mutex);
+    for (auto& replica : replicas) replica->cancel(reason);
+}
+
+void BatchScheduler::set_model_path(const std::string& model_path) {
+    lock_guard<mutex> lock(replicas_mutex);
+    config.set_model_path(model_path.c_str());
+}
+
+int BatchScheduler::transcribe(const std::vector<std::string>& audio_files,
+                               const std::vector<whisperkit_transcription_result_t*>& results, int num_workers) {
+    const int num_files = (int)audio_files.size();
+    if (num_files == 0) return 0;
+
+    std::unique_lock<std::mutex> replicas_lock(replicas_mutex);
+    auto workers = workers_for(num_workers);
+    for (auto* worker : workers) worker->reset_stop();
+    replicas_lock.unlock();
+    // pinned replicas keep the count the session engine was opened with
+    num_workers = (int)workers.size();
+
+    const int chunk_bytes = workers[0]->get_chunk_bytes();
+
+    struct FileResult {
+        std::vector<std::pair<float, std::string>> texts;  // timestamp & text, indexed by chunk
+        float audio_seconds = 0;
+        bool failed = false;
+    };
+    struct WorkerStats {
+        int chunks = 0;
+        int stolen = 0;
+        float busy_ms = 0;
+    };
+    std::vector<FileResult> file_results(num_files);
+    std::vector<WorkerStats> worker_stats(num_workers);
+    std::mutex file_results_mutex;
+    // the I/O threads decode far faster than the workers transcribe: they wait once each worker has a few
+    // chunks of ~1.9 MB queued, instead of buffering whole files
+    constexpr int kQueuedChunksPerWorker = 2;
+    WhisperKit::WorkStealingQueues<BatchChunk> pool(num_workers, num_workers * kQueuedChunksPerWorker);
+
+    auto start = chrono::high_resolution_clock::now();
+
+    // audio decoding & resampling, files are taken in order by the first free I/O thread
+    std::atomic<int> next_file = 0;
+    auto io_proc = [&]() {
+        for (int file = next_file++; file < num_files && !workers[0]->stopped(); file = next_file++) {
+            AudioCodec codec;
+            if (!codec.open(audio_files[file], config.get_verbose()) || codec.get_frame() == nullptr) {
+                LOGE("Error opening audio file: %s\n", audio_files[file].c_str());
+                codec.close();
+                lock_guard<mutex> lock(file_results_mutex);
+                file_results[file].failed = true;
+                continue;
+            }
+            auto frame = codec.get_frame();
+            AudioInputModel input(frame->sample_rate, frame->ch_layout.nb_channels, frame->format);
+            if (!input.initialize(config.get_verbose())) {
+                codec.close();
+                lock_guard<mutex> lock(file_results_mutex);
+                file_results[file].failed = true;
+                continue;
+            }
+
+            int num_chunks = 0;
+            auto emit = [&](AudioChunk&& chunk) {
+                pool.push(BatchChunk{file, num_chunks++, std::move(chunk)});
+            };
+            while (!workers[0]->stopped()) {
+                int ret = codec.decode_pcm();
+                if (ret == AVERROR(EAGAIN)) continue;
+                if (ret < 0) break;
+                if (codec.get_datasize() == 0) continue;
+
+                input.fill_pcmdata(codec.get_datasize(), (char*)codec.get_frame()->data[0],
+                                   (char*)codec.get_frame()->data[1]);
+                if (!config.get_vad_packing() && input.get_curr_buf_time() >= CHUNK_SECONDS) {
+                    split_chunks(input, chunk_bytes, emit);
+                }
+            }
+            if (config.get_vad_packing()) {
+                for (auto& packed : input.plan_packed_chunks()) {
+                    AudioChunk chunk;
+                    chunk.samples.resize(chunk_bytes);
+                    memcpy(chunk.samples.data(), packed.samples.data(), chunk_bytes);
+                    chunk.timestamp = packed.timestamp_map.front().second;
+                    chunk.timestamp_map = std::move(packed.timestamp_map);
+                    emit(std::move(chunk));
+                }
+            } else {
+                split_chunks(input, chunk_bytes, emit);
+            }
+
+            {
+                lock_guard<mutex> lock(file_results_mutex);
+                // chunks of this file may be transcribed already, keep their texts
+                file_results[file].texts.resize(max((int)file_results[file].texts.size(), num_chunks));
+                file_results[file].audio_seconds = input.get_total_input_time();
+            }
+            input.uninitialize();
+            codec.close();
+        }
+    };
+
+    auto worker_proc = [&](int worker) {
+        WhisperKit::ScopedAffinity affinity(workers[worker]->compute_cpus());
+        BatchChunk item;
+        bool stolen = false;
+        auto& stats = worker_stats[worker];
+        while (pool.pop(worker, item, &stolen)) {
+            auto before = chrono::high_resolution_clock::now();
+            auto& chunk = item.chunk;
+            auto text =
+                workers[worker]->transcribe_chunk(WhisperKit::Priority::Batch, chunk.samples.data(), chunk.timestamp,
+                                                  chunk.timestamp_map.empty() ? nullptr : &chunk.timestamp_map);
+            auto after = chrono::high_resolution_clock::now();
+
+            stats.busy_ms += chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0;
+            stats.chunks++;
+            stats.stolen += stolen;
+
+            lock_guard<mutex> lock(file_results_mutex);
+            auto& texts = file_results[item.file].texts;
+            if ((int)texts.size() <= item.index) texts.resize(item.index + 1);
+            texts[item.index] = {item.chunk.timestamp, std::move(text)};
+        }
+    };
+
+    std::vector<std::thread> io_threads;
+    std::vector<std::thread> worker_threads;
+    for (int i = 0; i < min(2, num_files); i++) io_threads.emplace_back(io_proc);
+    for (int i = 0; i < num_workers; i++) worker_threads.emplace_back(worker_proc, i);
+    for (auto& t : io_threads) t.join();
+    pool.close();
+    for (auto& t : worker_threads) t.join();
+
+    auto end = chrono::high_resolution_clock::now();
+    float wall_ms = chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+    float audio_seconds = 0;
+    int num_failed = 0;
+    for (int file = 0; file < num_files; file++) {
+        audio_seconds += file_results[file].audio_seconds;
+        if (file_results[file].failed) {
+            LOGE("Transcription of %s failed\n", audio_files[file].c_str());
+            num_failed++;
+        }
+        if (results[file] == nullptr) continue;
+
+        // segments carry absolute times already, decode_segment offsets them by the chunk's timestamp
+        auto& texts = file_results[file].texts;
+        std::stable_sort(texts.begin(), texts.end(),
+                         [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        std::string text;
+        for (auto& chunk_text : texts) text += chunk_text.second;
+        results[file]->set_transcription(text);
+    }
+
+    const float rtf = audio_seconds > 0 ? (wall_ms / 1000.0) / audio_seconds : 0;
+    LOGI("Batch: %d files, %.2f s of audio in %.2f ms with %d workers, RTF %.3f\n", num_files, audio_seconds,
+         wall_ms, num_workers, rtf);
+
+    if (config.get_report_path().empty()) return num_failed;
+
+    json report;
+    report["numFiles"] = num_files;
+    report["failedFiles"] = num_failed;
+    report["workers"] = num_workers;
+    report["parallelChunks"] = num_files == 1 && config.get_parallel_chunks();
+    report["vadPacking"] = config.get_vad_packing();
+    report["inputAudioSeconds"] = audio_seconds;
+    report["wallMs"] = wall_ms;
+    report["realTimeFactor"] = rtf;
+    report["speedFactor"] = rtf > 0 ? 1.0 / rtf : 0;
+    report["perWorker"] = json::array();
+    int encoder_runs = 0;
+    for (auto& stats : worker_stats) {
+        encoder_runs += stats.chunks;
+        report["perWorker"].push_back({{"chunks", stats.chunks},
+                                       {"stolenChunks", stats.stolen},
+                                       {"busyMs", stats.busy_ms},
+                                       {"utilization", wall_ms > 0 ? stats.busy_ms / wall_ms : 0}});
+    }
+
+    report["totalEncodingRuns"] = encoder_runs;
+    // live sessions share the workers, and take precedence over the batch's chunks
+    report["priorityClasses"] = priority_json(workers);
+    if (cascade) report["cascade"] = cascade_json(workers);
+
+    auto report_dir = config.get_report_path();
+    struct stat sb;
+    if (stat(report_dir.c_str(), &sb) != 0) {
+        mkdir(report_dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    }
+    ofstream out_file(report_dir + "/output_batch.json");
+    out_file << report.dump() << endl;
+    return num_failed;
+}
+
+}  // namespace WhisperKit::TranscribeTask
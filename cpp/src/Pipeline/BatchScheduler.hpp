@@ -0,0 +1,55 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "WhisperKitConfiguration.hpp"
+#include "WhisperKitTranscriptionResult.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+class Runtime;
+
+/*
+    Batch transcription: files are decoded by up to two I/O threads and cut into chunks, which
+    the workers take from per worker queues, stealing from each other once theirs run dry. The
+    queues are bounded, so the decoding stays a few chunks ahead of the workers.
+
+    The scheduler owns the replicas of the main runtime's models, one per worker, created on the
+    first batch or session and renewed when the worker count or the model changes. Sessions run
+    on the same replicas: pin_workers() hands them to the session engine, after which they are
+    kept as they are for the scheduler's lifetime. The cascade runtime is borrowed, and outlives
+    the scheduler.
+*/
+class BatchScheduler {
+   public:
+    BatchScheduler(const whisperkit_configuration_t& config, Runtime* cascade);
+    ~BatchScheduler();
+
+    // transcribes audio_files on num_workers replicas into results; returns the number of files that failed
+    int transcribe(const std::vector<std::string>& audio_files,
+                   const std::vector<whisperkit_transcription_result_t*>& results, int num_workers);
+    // num_workers replicas for the session engine, which may use them until the scheduler is destroyed
+    std::vector<Runtime*> pin_workers(int num_workers);
+    // stops the replicas' requests in flight
+    void cancel(whisperkit_status_t reason);
+    // the next replicas load model_path, unless they are pinned
+    void set_model_path(const std::string& model_path);
+
+   private:
+    // one replica per worker; replicas_mutex must be held
+    std::vector<Runtime*> workers_for(int num_workers);
+
+    whisperkit_configuration_t config;
+    Runtime* cascade;
+    std::vector<std::unique_ptr<Runtime>> replicas;  // never staged
+    std::string replicas_model_path;
+    bool pinned = false;
+    std::mutex replicas_mutex;  // cancel() may come from another thread while replicas are created
+};
+
+}  // namespace WhisperKit::TranscribeTask
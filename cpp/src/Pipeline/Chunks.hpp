@@ -0,0 +1,50 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "TimestampMap.hpp"
+#include "audio_input.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+constexpr const int CHUNK_SECONDS = 30;  // one chunk of audio length
+
+// one encoder window of audio, as the stage pipeline, the session engine & batches pass it around
+struct AudioChunk {
+    std::vector<char> samples{};  // MelSpectrogram input
+    float timestamp = 0;
+    float duration = 0;  // of audio, in seconds
+    bool flush = false;
+    TimestampMap timestamp_map{};  // VAD packed chunks only
+    // endpointing: marks the end of an utterance, behind its chunks
+    bool endpoint = false;
+    std::chrono::steady_clock::time_point speech_end{};
+    bool swap = false;
+};
+
+// batch transcription: a chunk of one of the batch's files
+struct BatchChunk {
+    int file = 0;
+    int index = 0;  // position of the chunk in its file
+    AudioChunk chunk{};
+};
+
+// Splits the audio buffered in input into chunks of chunk_bytes. Called once CHUNK_SECONDS
+// are buffered and at the end of the audio, like the serial runtime's decoder_loop.
+template <typename Emit>
+void split_chunks(AudioInputModel& input, int chunk_bytes, Emit&& emit) {
+    while (true) {
+        AudioChunk chunk;
+        chunk.samples.resize(chunk_bytes);
+        chunk.timestamp = input.get_next_chunk(chunk.samples.data());
+        if (chunk.timestamp < 0) return;
+        chunk.duration = input.get_chunked_time() - chunk.timestamp;
+        emit(std::move(chunk));
+    }
+}
+
+}  // namespace WhisperKit::TranscribeTask
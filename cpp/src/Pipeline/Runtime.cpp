@@ -0,0 +1,1464 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "Runtime.hpp"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "DecoderStateBenchmark.hpp"
+#include "ModelRegistry.hpp"
+#include "ModelTuner.hpp"
+#include "ProcessStats.hpp"
+#include "StagePipeline.hpp"
+#include "WindowedStream.hpp"
+// to be deleted
+// JNI: set to app's cache dir
+#if (JNI_BUILD)
+#define TRANSCRIBE_TASK_TFLITE_ROOT_PATH "/sdcard/argmax/tflite"
+#define TRANSCRIBE_TASK_DEFAULT_LIB_DIR "/data/local/tmp/lib"
+#define TRANSCRIBE_TASK_DEFAULT_CACHE_DIR "/data/user/0/com.whispertflite/cache"
+#elif (QNN_DELEGATE || GPU_DELEGATE)
+// for Android QNN or GPU delegatea
+#define TRANSCRIBE_TASK_TFLITE_ROOT_PATH "/sdcard/argmax/tflite"
+#define TRANSCRIBE_TASK_DEFAULT_LIB_DIR "/data/local/tmp/lib"
+#define TRANSCRIBE_TASK_DEFAULT_CACHE_DIR "/data/local/tmp/cache"
+#else
+#define TRANSCRIBE_TASK_TFLITE_ROOT_PATH "."
+#define TRANSCRIBE_TASK_DEFAULT_LIB_DIR "./lib"
+#define TRANSCRIBE_TASK_DEFAULT_CACHE_DIR "./cache"
+#endif
+
+#if defined(__ANDROID__)
+#include <sys/system_properties.h>
+
+std::string getProperty(const char* name) {
+    char value[64] = {0};
+    int len = __system_property_get(name, value);
+
+    if (len > 0) {
+        return std::move(std::string(value, len));
+    }
+    return {};
+}
+#endif
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+#ifndef QCOM_SOC
+#define QCOM_SOC "qcom"
+#endif
+
+#ifndef TFLITE_INIT_CHECK
+#define TFLITE_INIT_CHECK(x)                              \
+    if (!(x)) {                                           \
+        LOGE("Error at %s:%d\n", __FUNCTION__, __LINE__); \
+        exit(0);                                          \
+    }
+#endif
+
+json latency_summary(std::vector<float> latencies) {
+    if (latencies.empty()) return json();
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](float p) { return latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+    float sum = 0;
+    for (auto latency : latencies) sum += latency;
+    return {{"mean", sum / latencies.size()},
+            {"p50", percentile(0.5f)},
+            {"p90", percentile(0.9f)},
+            {"max", latencies.back()}};
+}
+
+json cascade_json(const std::vector<Runtime*>& runtimes) {
+    CascadeStats total;
+    for (auto* runtime : runtimes) {
+        auto stats = runtime->get_cascade_stats();
+        total.chunks += stats.chunks;
+        total.escalated += stats.escalated;
+        total.fast_ms += stats.fast_ms;
+        total.large_ms += stats.large_ms;
+    }
+    json result = {{"chunks", total.chunks},
+                   {"escalated", total.escalated},
+                   {"escalatedFraction", total.chunks > 0 ? (float)total.escalated / total.chunks : 0},
+                   {"fastModelMs", total.fast_ms},
+                   {"largeModelMs", total.large_ms}};
+    // the larger model's cost per chunk is only known once it ran
+    if (total.escalated > 0) {
+        const float large_only_ms = total.chunks * total.large_ms / total.escalated;
+        const float saved_ms = large_only_ms - total.fast_ms - total.large_ms;
+        result["largeModelOnlyMs"] = large_only_ms;
+        result["computeSavedMs"] = saved_ms;
+        result["computeSavedFraction"] = large_only_ms > 0 ? saved_ms / large_only_ms : 0;
+    }
+    return result;
+}
+
+json priority_json(const std::vector<Runtime*>& runtimes) {
+    const std::array<const char*, PriorityGate::kNumClasses> class_names = {"realtime", "batch"};
+    std::array<PriorityStats, PriorityGate::kNumClasses> total;
+    for (auto* runtime : runtimes) {
+        auto stats = runtime->get_priority_stats();
+        for (int priority = 0; priority < PriorityGate::kNumClasses; priority++) {
+            total[priority].chunks += stats[priority].chunks;
+            total[priority].preemptions += stats[priority].preemptions;
+            total[priority].queue_delay_ms.insert(total[priority].queue_delay_ms.end(),
+                                                  stats[priority].queue_delay_ms.begin(),
+                                                  stats[priority].queue_delay_ms.end());
+        }
+    }
+    json result;
+    for (int priority = 0; priority < PriorityGate::kNumClasses; priority++) {
+        result[class_names[priority]] = {{"chunks", total[priority].chunks},
+                                         {"preemptions", total[priority].preemptions},
+                                         {"queueDelayMs", latency_summary(total[priority].queue_delay_ms)}};
+    }
+    return result;
+}
+
+Runtime::Runtime(const whisperkit_configuration_t& config) { this->config = config; }
+
+std::string Runtime::device_id() {
+    // tuning profiles are only valid for the exact SoC / CPU they were measured on
+#if defined(__ANDROID__)
+    return getProperty("ro.product.brand") + "_" + getProperty("ro.product.model") + "_" + getProperty("ro.soc.model");
+#else
+    std::string device = "unknown";
+    struct utsname info;
+    if (uname(&info) == 0) {
+        device = info.machine;
+    }
+    ifstream cpuinfo("/proc/cpuinfo");
+    string line;
+    while (getline(cpuinfo, line)) {
+        if (line.starts_with("model name") || line.starts_with("Hardware")) {
+            device += "_" + line.substr(line.find(':') + 2);
+            break;
+        }
+    }
+    return device;
+#endif
+}
+
+Runtime::~Runtime() { close(); }
+
+void Runtime::set_streaming_mode(bool streaming_mode) { this->streaming_mode = streaming_mode; }
+
+void Runtime::cancel(whisperkit_status_t reason) {
+    int expected = WHISPERKIT_STATUS_SUCCESS;
+    stop_status.compare_exchange_strong(expected, reason);
+    if (cascade) cascade->cancel(reason);
+
+    // a model swap may move the models while this comes from another thread
+    lock_guard<mutex> lock(swap_mutex);
+    if (!models_loaded) return;
+    // stage threads check stopped() between invocations; this interrupts the ones running
+    melspectro->cancel();
+    encoder->cancel();
+    decoder->cancel();
+}
+
+void Runtime::set_segment_callback(whisperkit_segment_callback_t callback, void* user_data) {
+    lock_guard<mutex> lock(gmutex);
+    segment_callback = callback;
+    segment_callback_data = user_data;
+}
+
+void Runtime::set_token_callback(whisperkit_token_callback_t callback, void* user_data) {
+    constexpr const size_t kTokenQueueSize = 1024;
+
+    lock_guard<mutex> lock(gmutex);
+    stop_token_thread();
+    token_callback = callback;
+    token_callback_data = user_data;
+    if (callback == nullptr) return;
+
+    token_queue = make_unique<SpscQueue<TokenItem>>(kTokenQueueSize);
+    token_thread = thread(&Runtime::token_proc, this);
+}
+
+void Runtime::stop_token_thread() {
+    if (!token_thread.joinable()) return;
+
+    // the tokens queued so far are passed on first
+    token_queue->close();
+    token_thread.join();
+    token_queue.reset();
+}
+
+void Runtime::token_proc() {
+    constexpr const std::string_view kReplacementChar = "\xEF\xBF\xBD";
+
+    std::shared_ptr<Tokenizer> chunk_tokenizer;
+    std::vector<int> text_tokens;
+    size_t sent = 0;  // bytes of the chunk's text passed on so far
+    TokenItem item;
+    while (token_queue->pop(item)) {
+        if (item.tokenizer) {
+            chunk_tokenizer = std::move(item.tokenizer);
+            text_tokens.clear();
+            sent = 0;
+        }
+        // the text of the tokens coalesced into this one comes with its own
+        for (int token : item.coalesced) {
+            if (token < chunk_tokenizer->specialTokens.endOfTranscriptToken) text_tokens.push_back(token);
+        }
+
+        // the chunk's text is decoded again as a whole, as a token may start or end in the middle of a
+        // character; until the next token completes it, the character is decoded as U+FFFD and held back
+        std::string delta;
+        if (item.token < chunk_tokenizer->specialTokens.endOfTranscriptToken) {
+            text_tokens.push_back(item.token);
+            char* c_text = tokenizer_decode(chunk_tokenizer.get(), text_tokens.data(), text_tokens.size(), true);
+            std::string_view text(c_text);
+            if (!text.ends_with(kReplacementChar) && text.size() > sent) {
+                delta = text.substr(sent);
+                sent = text.size();
+            }
+            tokenizer_free_rstring(c_text);
+        }
+
+        whisperkit_token_t token;
+        token.chunk_index = item.chunk_index;
+        token.token = item.token;
+        token.text = delta.c_str();
+        token.timestamp = item.timestamp;
+        token.logprob = item.logprob;
+        token_callback(&token, token_callback_data);
+
+        lock_guard<mutex> lock(token_mutex);
+        token_stats.callback_lag_ms.push_back(
+            chrono::duration<float, milli>(chrono::steady_clock::now() - item.decoded).count());
+    }
+}
+
+// RMS of the first channel below the energy threshold; formats other than S16 & float never count as silent
+static bool is_silent(const char* pcm_buffer, int size, int format) {
+    constexpr const float kSilenceRms = 0.01f;
+    double sum = 0;
+    int samples = 0;
+    if (format == AV_SAMPLE_FMT_S16 || format == AV_SAMPLE_FMT_S16P) {
+        auto* data = reinterpret_cast<const int16_t*>(pcm_buffer);
+        samples = size / sizeof(int16_t);
+        for (int i = 0; i < samples; i++) sum += (data[i] / 32768.0) * (data[i] / 32768.0);
+    } else if (format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_FLTP) {
+        auto* data = reinterpret_cast<const float*>(pcm_buffer);
+        samples = size / sizeof(float);
+        for (int i = 0; i < samples; i++) sum += data[i] * data[i];
+    } else {
+        return false;
+    }
+    return samples > 0 && sqrt(sum / samples) < kSilenceRms;
+}
+
+bool Runtime::admit_audio(int size, const char* pcm_buffer) {
+    const float limit = config.get_max_backlog_ms() / 1000.0f;
+    if (limit <= 0) return true;
+
+    const auto backlog = backlog_seconds();
+    bool admit = true;
+    switch (config.get_overload_policy()) {
+        case WHISPERKIT_OVERLOAD_POLICY_BLOCK:
+            break;
+        case WHISPERKIT_OVERLOAD_POLICY_DROP_AUDIO:
+            admit = backlog <= limit;
+            break;
+        case WHISPERKIT_OVERLOAD_POLICY_DROP_SILENCE:
+            admit = backlog <= limit || (backlog <= 2 * limit && !is_silent(pcm_buffer, size, input_format));
+            break;
+        case WHISPERKIT_OVERLOAD_POLICY_REDUCE_DECODING:
+            admit = backlog <= 2 * limit;
+            break;
+    }
+    update_overload(backlog, admit ? 0 : size / input_bytes_per_second);
+    return admit;
+}
+
+float Runtime::backlog_seconds() {
+    if (is_staged()) return stages ? stages->backlog_seconds() : 0;
+    return window ? window->backlog_seconds() : 0;
+}
+
+void Runtime::update_overload(float backlog, float dropped) {
+    const float limit = config.get_max_backlog_ms() / 1000.0f;
+    whisperkit_overload_callback_t callback = nullptr;
+    void* callback_data = nullptr;
+    whisperkit_overload_t overload;
+    {
+        lock_guard<mutex> lock(overload_mutex);
+        dropped_seconds += dropped;
+        peak_backlog = max(peak_backlog, backlog);
+        // hysteresis, so a backlog around the limit doesn't flap
+        const bool was_overloaded = overloaded;
+        if (!overloaded && backlog > limit) {
+            overloaded = true;
+            overload_events++;
+        } else if (overloaded && backlog <= limit / 2) {
+            overloaded = false;
+        }
+        if (overloaded == was_overloaded) return;
+
+        if (config.get_overload_policy() == WHISPERKIT_OVERLOAD_POLICY_REDUCE_DECODING) {
+            decoding_steps = overloaded ? TextDecoder::kMaxDecodingSteps / 4 : TextDecoder::kMaxDecodingSteps;
+        }
+        LOGI("Streaming %s: %.0f ms backlog, %.0f ms dropped\n", overloaded ? "overloaded" : "caught up",
+             backlog * 1000, dropped_seconds * 1000);
+        callback = overload_callback;
+        callback_data = overload_callback_data;
+        overload = {overloaded, backlog * 1000, dropped_seconds * 1000, 0};
+    }
+    if (callback == nullptr) return;
+    overload.real_time_factor = get_real_time_factor();
+    callback(&overload, callback_data);
+}
+
+void Runtime::record_progress(float audio_seconds, float busy_ms) {
+    if (audio_seconds <= 0) return;
+    lock_guard<mutex> lock(overload_mutex);
+    progress.push_back({audio_seconds, busy_ms});
+}
+
+float Runtime::get_real_time_factor() {
+    lock_guard<mutex> lock(overload_mutex);
+    float audio_seconds = 0, busy_ms = 0;
+    for (size_t i = 0; i < progress.size(); i++) {
+        audio_seconds += progress[i].first;
+        busy_ms += progress[i].second;
+    }
+    return audio_seconds > 0 ? busy_ms / 1000 / audio_seconds : 0;
+}
+
+void Runtime::set_overload_callback(whisperkit_overload_callback_t callback, void* user_data) {
+    lock_guard<mutex> lock(overload_mutex);
+    overload_callback = callback;
+    overload_callback_data = user_data;
+}
+
+bool Runtime::check_qcom_soc() {
+    vector<string> supported_socs{"SM8750", "SM8650", "SM8550", "SM8450", "SM8350"};
+#if defined(__ANDROID__)
+    auto soc = getProperty("ro.soc.model");
+#else
+    struct utsname info;
+    std::string soc = "unknown";
+    if (uname(&info) == 0) {
+        soc = info.machine;
+    }
+#endif
+    LOGI("SoC: \t%s", soc.c_str());
+    if (find(begin(supported_socs), end(supported_socs), soc) != end(supported_socs)) {
+        LOGI(" -> QNN HTP\n");
+        return true;
+    } else {  // all other SoCs
+        LOGI(" -> TFLite GPU\n");
+        return false;
+    }
+}
+
+void Runtime::init() {
+    lock_guard<mutex> lock(gmutex);
+
+    // LOGI("tflite_init input: %s\n", config.get_model_path().c_str());
+
+    is_qnn_backend = false;
+#if (QNN_DELEGATE || GPU_DELEGATE)
+    is_qnn_backend = check_qcom_soc();  // selecting runtime delegation for the model
+#else
+    LOGI("SoC: \tgeneric CPU (x86, arm64, etc) \n");
+#endif
+
+    tokenizer_json = config.get_model_path() + "/tokenizer.json";
+    tokenizer_config_json = config.get_model_path() + "/config.json";
+    melspectro_model = config.get_model_path() + "/MelSpectrogram.tflite";
+    encoder_model = config.get_model_path() + "/AudioEncoder.tflite";
+    decoder_model = config.get_model_path() + "/TextDecoder.tflite";
+
+    std::vector<std::string> required_files = {tokenizer_json, tokenizer_config_json, melspectro_model, encoder_model,
+                                               decoder_model};
+    for (const auto& file : required_files) {
+        if (!std::filesystem::exists(file)) {
+            LOGE("File does not exist: %s", file.c_str());
+            std::stringstream ss;
+            ss << file << " : required file not found";
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    lib_dir = std::string(TRANSCRIBE_TASK_DEFAULT_LIB_DIR);
+    cache_dir = std::string(TRANSCRIBE_TASK_DEFAULT_CACHE_DIR);
+    debug = config.get_verbose();
+    if (!config.get_lib_dir().empty()) {
+        lib_dir = config.get_lib_dir();
+    }
+
+    if (!config.get_cache_dir().empty()) {
+        cache_dir = config.get_cache_dir();
+    }
+
+    if (!config.get_report_path().empty()) {
+        report_dir = config.get_report_path();
+    }
+
+    // tokens are only kept for the report; messages are committed text, kept until the caller retrieves them
+    all_tokens.reset(config.get_low_memory() ? (1 << 12) : (1 << 18));  // max 4K / 256K tokens
+
+    messenger = std::make_unique<TFLiteMessenger>();
+    messenger->_running = true;
+
+    auto thread_policy = (config.get_thread_policy() == WHISPERKIT_THREAD_POLICY_TOPOLOGY) ? ThreadPolicy::Topology
+                                                                                           : ThreadPolicy::Default;
+    scheduler = std::make_unique<ThreadScheduler>(thread_policy, config.get_stage_threads());
+
+    // with load == false, interpreters are created on the first transcription request
+    if (config.get_load()) {
+        load_models();
+    }
+}
+
+void Runtime::load_models() {
+    if (models_loaded) return;
+
+    auto before_load = chrono::high_resolution_clock::now();
+
+    // stored tunings are applied on every load; autotune only creates missing ones
+    TuningProfile profile(cache_dir, device_id(), {melspectro_model, encoder_model, decoder_model});
+    profile.load();
+    if (config.get_autotune() && !profile.contains_all({"melSpectrogram", "encoder", "decoder"})) {
+        tune_models(profile);
+    }
+    tuning_stats["profile"] = profile.to_json();
+
+    melspectro = make_unique<TFLiteModel>("mel_spectrogram");
+    encoder = make_unique<TFLiteModel>("whisper_encoder");
+
+    decoder = TextDecoderFactory::CreateFromFile(decoder_model);
+
+    // shared with other pipelines using the same model files
+    tokenizer = ModelRegistry::instance().acquire_tokenizer(tokenizer_json, tokenizer_config_json);
+    if (!tokenizer) throw std::runtime_error("Failed to load tokenizer");
+
+    postproc = make_unique<PostProcModel>(tokenizer.get());
+
+    // delegate options are shared by the models, the delegates themselves are created per model
+    DelegateManagerConfiguration delegate_config;
+    delegate_manager = std::make_shared<DelegateManager>();
+    delegate_manager->initialize(delegate_config);
+    delegate_manager->set_lib_dir(lib_dir);
+    delegate_manager->set_cache_dir(cache_dir);
+    melspectro->set_delegate_manager(delegate_manager);
+    encoder->set_delegate_manager(delegate_manager);
+    decoder->set_delegate_manager(delegate_manager);
+
+    melspectro->set_thread_placement(scheduler->placement_for(PipelineStage::MelSpectrogram));
+    encoder->set_thread_placement(scheduler->placement_for(PipelineStage::Encoder));
+    decoder->set_thread_placement(scheduler->placement_for(PipelineStage::Decoder));
+
+    // explicitly configured thread counts take precedence over tuned ones
+    auto tuning_for = [&](const char* name, whisperkit_stage_t stage) {
+        auto tuning = profile.get(name);
+        if (tuning && config.get_stage_threads()[stage] > 0) tuning->num_threads = 0;
+        return tuning;
+    };
+    auto melspectro_tuning = tuning_for("melSpectrogram", WHISPERKIT_STAGE_MELSPECTROGRAM);
+    auto encoder_tuning = tuning_for("encoder", WHISPERKIT_STAGE_ENCODER);
+    auto decoder_tuning = tuning_for("decoder", WHISPERKIT_STAGE_DECODER);
+    if (melspectro_tuning) melspectro->apply_tuning(*melspectro_tuning);
+    if (encoder_tuning) encoder->apply_tuning(*encoder_tuning);
+    if (decoder_tuning) decoder->apply_tuning(*decoder_tuning);
+    // backends the caller set explicitly take precedence over tuned ones, like thread counts
+    auto backend_for = [&](const char* name, const std::optional<ModelTuning>& tuning, int configured) {
+        if (!tuning || tuning->backend == configured || config.get_backends_set()) return configured;
+        LOGI("%s: tuning profile selects the %s backend instead of %s\n", name, compute_backend_name(tuning->backend),
+             compute_backend_name(configured));
+        return tuning->backend;
+    };
+    const int melspectro_backend = melspectro_tuning ? melspectro_tuning->backend : ComputeBackend::CPU;
+    const int encoder_backend = backend_for("encoder", encoder_tuning, config.get_encoder_backend());
+    const int decoder_backend = backend_for("decoder", decoder_tuning, config.get_decoder_backend());
+
+    // cold vs. warm init time per model (e.g. XNNPack weight cache build vs. mmap)
+    auto before_init = chrono::high_resolution_clock::now();
+    auto record_init = [&](const char* name) {
+        auto after_init = chrono::high_resolution_clock::now();
+        model_init_stats[name]["initMs"] =
+            chrono::duration_cast<std::chrono::microseconds>(after_init - before_init).count() / 1000.0;
+        before_init = after_init;
+    };
+
+    TFLITE_INIT_CHECK(melspectro->initialize(melspectro_model, lib_dir, cache_dir, melspectro_backend, debug));
+    record_init("melSpectrogram");
+    TFLITE_INIT_CHECK(encoder->initialize(encoder_model, lib_dir, cache_dir, encoder_backend, debug));
+    record_init("encoder");
+    TFLITE_INIT_CHECK(decoder->initialize(decoder_model, lib_dir, cache_dir, decoder_backend, debug));
+    record_init("decoder");
+    TFLITE_INIT_CHECK(postproc->initialize(debug));
+
+    model_init_stats["melSpectrogram"].update(*melspectro->get_init_json());
+    model_init_stats["encoder"].update(*encoder->get_init_json());
+    model_init_stats["decoder"].update(*decoder->get_init_json());
+
+    melspectro_inputs = melspectro->get_input_ptrs();
+    melspectro_outputs = melspectro->get_output_ptrs();
+    // outputs: melspectrogram
+    if (melspectro_outputs.size() != 1) throw std::invalid_argument("melspectro output tensor # has to be 1");
+
+    encoder_inputs = encoder->get_input_ptrs();
+    // retrieve encoder output tensor pointers
+    encoder_outputs = encoder->get_output_ptrs();
+    // outputs: k_cache, v_cache
+    if (encoder_outputs.size() != 2) throw std::invalid_argument("audio encoder output tensor # has to be 2");
+
+    models_loaded = true;
+
+    auto after_load = chrono::high_resolution_clock::now();
+    load_latency = chrono::duration_cast<std::chrono::microseconds>(after_load - before_load).count() / 1000.0;
+
+    if (config.get_prewarm()) {
+        prewarm_models();
+    }
+
+    // low memory mode: arenas are only allocated while their stage runs
+    if (config.get_low_memory()) {
+        release_stage_memory(PipelineStage::MelSpectrogram);
+        release_stage_memory(PipelineStage::Encoder);
+        release_stage_memory(PipelineStage::Decoder);
+    }
+}
+
+void Runtime::tune_models(TuningProfile& profile) {
+    LOGI("Autotuning models, this takes a while..\n");
+    auto before_tuning = chrono::high_resolution_clock::now();
+
+    // every build can run the CPU backends, the delegates depend on build & SoC
+    const std::vector<int> cpu_backends = {ComputeBackend::CPU, ComputeBackend::CPUBuiltin};
+    std::vector<int> backends;
+#if QNN_DELEGATE
+    if (is_qnn_backend) backends.push_back(ComputeBackend::NPU);
+#endif
+#if GPU_DELEGATE
+    backends.push_back(ComputeBackend::GPU);
+#endif
+    backends.insert(backends.end(), cpu_backends.begin(), cpu_backends.end());
+
+    ModelTuner tuner(lib_dir, cache_dir);
+    auto tune = [&](const char* name, const char* model_name, const std::string& model_path, PipelineStage stage,
+                    const std::vector<int>& candidate_backends) {
+        auto tuning = tuner.tune(model_name, model_path, candidate_backends, scheduler->placement_for(stage));
+        if (tuning.latency_ms >= 0) profile.set(name, tuning);
+    };
+    tune("melSpectrogram", "mel_spectrogram", melspectro_model, PipelineStage::MelSpectrogram, cpu_backends);
+    tune("encoder", "whisper_encoder", encoder_model, PipelineStage::Encoder, backends);
+    tune("decoder", "TextDecoder", decoder_model, PipelineStage::Decoder, backends);
+    profile.save();
+
+    auto after_tuning = chrono::high_resolution_clock::now();
+    tuning_stats["tuningMs"] =
+        chrono::duration_cast<std::chrono::microseconds>(after_tuning - before_tuning).count() / 1000.0;
+    tuning_stats["candidates"] = tuner.get_results_json();
+    LOGI("Tuning profile saved to %s\n", profile.path().c_str());
+}
+
+void Runtime::prewarm_models() {
+    // One dummy pass through mel -> encoder -> decoder, so delegate compilation,
+    // weight packing and first-touch page faults happen at build time instead of
+    // on the first real chunk. Inferences are not measured to keep the stats clean.
+    auto before_prewarm = chrono::high_resolution_clock::now();
+
+    memset(melspectro_inputs[0].first, 0, melspectro_inputs[0].second);
+    melspectro->invoke();
+
+    encoder->read_input_data(melspectro_outputs[0].first, 0);
+    encoder->invoke();
+
+    auto k_cache_cross = encoder->get_output_with_name("k_cache_cross");
+    if (k_cache_cross.first == nullptr) {
+        k_cache_cross = encoder->get_output_with_name("k_cache");
+    }
+    auto v_cache_cross = encoder->get_output_with_name("v_cache_cross");
+    if (v_cache_cross.first == nullptr) {
+        v_cache_cross = encoder->get_output_with_name("v_cache");
+    }
+
+    if (k_cache_cross.first != nullptr && v_cache_cross.first != nullptr) {
+        int x = tokenizer->specialTokens.startOfTranscriptToken;
+        int index = 0;
+
+        decoder->bind_input_tensor(k_cache_cross.first, "k_cache_cross");
+        decoder->bind_input_tensor(v_cache_cross.first, "v_cache_cross");
+        decoder->initialize_kv_cache();
+        decoder->bind_input_tensor((char*)&x, "x");
+        decoder->bind_input_tensor((char*)&index, "index");
+        decoder->update_kv_cache();
+        decoder->invoke();
+    }
+
+    auto after_prewarm = chrono::high_resolution_clock::now();
+    prewarm_latency = chrono::duration_cast<std::chrono::microseconds>(after_prewarm - before_prewarm).count() / 1000.0;
+    LOGI("Prewarm done in %.2f ms\n", prewarm_latency);
+}
+
+void Runtime::init_audio_input(int sample_rate, int num_channels, int fmt) {
+    lock_guard<mutex> lock(gmutex);
+
+    // deferred loading (load == false) is paid by the first request
+    start_exec = chrono::high_resolution_clock::now();
+    has_first_result = false;
+    // a swap the previous stream didn't reach a chunk boundary for; its threads are idle now
+    if (swap_pending.exchange(false)) apply_swap();
+    load_models();
+
+    // the VAD model and buffers are kept for the next request, a new input format only rebuilds the resampler
+    auto before_setup = chrono::steady_clock::now();
+    if (audioinput) {
+        TFLITE_INIT_CHECK(audioinput->reset(sample_rate, num_channels, fmt, debug));
+    } else {
+        audioinput = make_unique<AudioInputModel>(sample_rate, num_channels, fmt);
+        TFLITE_INIT_CHECK(audioinput->initialize(debug));
+    }
+    audio_input_setup_ms = chrono::duration<float, milli>(chrono::steady_clock::now() - before_setup).count();
+
+    // same defaults as AudioInputModel; planar formats append one channel per buffer
+    input_format = fmt <= AV_SAMPLE_FMT_NONE ? AV_SAMPLE_FMT_S16 : fmt;
+    input_bytes_per_second = (float)sample_rate * av_get_bytes_per_sample((AVSampleFormat)input_format) *
+                             (av_sample_fmt_is_planar((AVSampleFormat)input_format) ? 1 : num_channels);
+    decoding_steps = TextDecoder::kMaxDecodingSteps;
+    {
+        lock_guard<mutex> overload_lock(overload_mutex);
+        overloaded = false;
+        overload_events = 0;
+        peak_backlog = 0;
+        dropped_seconds = 0;
+        progress.clear();
+    }
+
+    audioinput->set_endpoint_hangover(streaming_mode && !is_windowed() ? config.get_endpoint_hangover_ms() : 0);
+    pending_endpoints.clear();
+    {
+        lock_guard<mutex> results_lock(results_mutex);
+        endpoint_latency_ms.clear();
+    }
+    {
+        lock_guard<mutex> token_lock(token_mutex);
+        token_stats = {};
+    }
+
+    segment_index = 0;
+    next_segment_index = -1;
+    packed_chunks = 0;
+    packed_regions = 0;
+    // the stage & window threads are idle after the previous stream's flush, and kept for the next one
+    if (is_staged()) {
+        if (!stages) stages = make_unique<StagePipeline>(*this, melspectro_inputs[0].second);
+        stages->begin_stream();
+    }
+    if (is_windowed()) {
+        if (!window) window = make_unique<WindowedStream>(*this, melspectro_inputs[0].second);
+        window->begin_stream();
+    }
+}
+
+void Runtime::conclude_transcription() {
+    lock_guard<mutex> lock(gmutex);
+
+    messenger->_running = false;
+
+    end_exec = chrono::high_resolution_clock::now();
+}
+
+bool Runtime::has_result_text() {
+    lock_guard<mutex> lock(results_mutex);
+    return !all_msgs.empty();
+}
+
+std::unique_ptr<std::string> Runtime::get_result_text(std::vector<TranscriptionSegment>* segments) {
+    lock_guard<mutex> lock(results_mutex);
+    auto output = make_unique<std::string>();
+    if (segments) {
+        for (auto& segment : all_segments) segments->push_back(std::move(segment));
+    }
+    // swapped out, so that their storage is released along with them
+    std::vector<TranscriptionSegment>().swap(all_segments);
+    std::vector<std::string> msgs;
+    msgs.swap(all_msgs);
+
+    for (auto& msg : msgs) {
+        *output += (msg + '\n');
+    }
+    return output;
+}
+
+void Runtime::close() {
+    // their threads run the models
+    stages.reset();
+    window.reset();
+    stop_token_thread();
+    if (audioinput) audioinput->uninitialize();
+    lock_guard<mutex> lock(swap_mutex);
+    if (!models_loaded) return;
+
+    postproc->uninitialize();
+    decoder->uninitialize();
+    encoder->uninitialize();
+    melspectro->uninitialize();
+    // postproc holds a raw pointer to the tokenizer, so release it last
+    tokenizer.reset();
+    models_loaded = false;
+}
+
+int Runtime::decoder_loop() {
+    lock_guard<mutex> lock(gmutex);
+
+    if (is_staged()) {
+        if (!stages) return -1;
+        // chunks are transcribed by the stage threads as audio comes in;
+        // wait until everything appended so far went through all stages
+        push_pending_swap();
+        stages->flush();
+        return -1;
+    }
+
+    if (is_windowed()) {
+        // the last decode of the window commits whatever is left of it
+        if (window) window->flush();
+        return -1;
+    }
+
+    if (config.get_vad_packing() && !streaming_mode) {
+        transcribe_packed();
+        return -1;
+    }
+
+    while (!stopped()) {
+        auto before = chrono::steady_clock::now();
+        audio_melspectro_proc();
+        if (melspectro_timestamp < 0) break;
+
+        encode_decode_postproc(melspectro_timestamp, nullptr, cascade ? cascade_samples.data() : nullptr);
+        auto after = chrono::steady_clock::now();
+        record_progress(audioinput->get_chunked_time() - melspectro_timestamp,
+                        chrono::duration_cast<chrono::microseconds>(after - before).count() / 1000.0);
+    }
+
+    // the audio in front of the ends of utterance has been transcribed
+    for (auto speech_end : pending_endpoints) record_endpoint(speech_end);
+    pending_endpoints.clear();
+    return -1;
+}
+
+void Runtime::record_endpoint(std::chrono::steady_clock::time_point speech_end) {
+    auto now = chrono::steady_clock::now();
+    lock_guard<mutex> lock(results_mutex);
+    endpoint_latency_ms.push_back(chrono::duration_cast<chrono::microseconds>(now - speech_end).count() / 1000.0);
+}
+
+void Runtime::audio_melspectro_proc() {
+    // the chunk is written straight into the input tensor, so the arena has to be there
+    // even when it turns out that there is no chunk to process
+    acquire_stage_memory(PipelineStage::MelSpectrogram);
+    melspectro_timestamp = audioinput->get_next_chunk(melspectro_inputs[0].first);
+
+    if (melspectro_timestamp < 0) {
+        if (config.get_low_memory()) melspectro->release_memory();
+        return;
+    }
+    // low memory mode releases the input with the MelSpectrogram's arena
+    if (cascade) {
+        auto& [input, input_bytes] = melspectro_inputs[0];
+        cascade_samples.assign(input, input + input_bytes);
+    }
+
+    encoder->get_mutex()->lock();
+    melspectro->invoke(true);
+    encoder->get_mutex()->unlock();
+
+    auto& memory = stage_memory[(int)PipelineStage::MelSpectrogram];
+    memory.peak_kb = max(memory.peak_kb, ProcessStats::current_rss_kb());
+}
+
+void Runtime::transcribe_packed() {
+    auto chunks = audioinput->plan_packed_chunks();
+    packed_chunks += chunks.size();
+    for (auto& chunk : chunks) {
+        if (stopped()) break;
+        packed_regions += chunk.timestamp_map.size();
+        invoke_melspectro(reinterpret_cast<const char*>(chunk.samples.data()));
+        encode_decode_postproc(chunk.timestamp_map.front().second, &chunk.timestamp_map,
+                               reinterpret_cast<const char*>(chunk.samples.data()));
+    }
+    if (config.get_low_memory()) melspectro->release_memory();
+}
+
+void Runtime::acquire_stage_memory(PipelineStage stage) {
+    if (!config.get_low_memory()) return;
+
+    auto before = chrono::high_resolution_clock::now();
+    switch (stage) {
+        case PipelineStage::MelSpectrogram:
+            TFLITE_INIT_CHECK(melspectro->acquire_memory());
+            melspectro_inputs = melspectro->get_input_ptrs();
+            melspectro_outputs = melspectro->get_output_ptrs();
+            break;
+        case PipelineStage::Encoder:
+            TFLITE_INIT_CHECK(encoder->acquire_memory());
+            encoder_inputs = encoder->get_input_ptrs();
+            encoder_outputs = encoder->get_output_ptrs();
+            break;
+        case PipelineStage::Decoder:
+            TFLITE_INIT_CHECK(decoder->acquire_memory());
+            break;
+        default:
+            break;
+    }
+    auto after = chrono::high_resolution_clock::now();
+    memory_latency += chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0;
+}
+
+void Runtime::release_stage_memory(PipelineStage stage) {
+    if (config.get_low_memory()) {
+        auto before = chrono::high_resolution_clock::now();
+        switch (stage) {
+            case PipelineStage::MelSpectrogram:
+                melspectro->release_memory();
+                break;
+            case PipelineStage::Encoder:
+                encoder->release_memory();
+                break;
+            case PipelineStage::Decoder:
+                decoder->release_memory();
+                break;
+            default:
+                break;
+        }
+        auto after = chrono::high_resolution_clock::now();
+        memory_latency += chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0;
+    }
+    // sampled in both modes, so runs with and without low memory mode can be compared
+    stage_memory[(int)stage].steady_kb = ProcessStats::current_rss_kb();
+}
+
+void Runtime::encode_decode_postproc(float timestamp, const TimestampMap* timestamp_map, const char* samples) {
+    auto before = chrono::steady_clock::now();
+    auto [k_cache_cross, v_cache_cross] = encode();
+    auto after = chrono::steady_clock::now();
+    if (stopped()) {
+        // the encoder may have been interrupted, its outputs are not usable
+        release_stage_memory(PipelineStage::Encoder);
+        return;
+    }
+    if (k_cache_cross.first == nullptr || v_cache_cross.first == nullptr) {
+        LOGE("Failed to get k_cache_cross or v_cache_cross");
+        release_stage_memory(PipelineStage::Encoder);
+        return;
+    }
+
+    decode_postproc(k_cache_cross.first, v_cache_cross.first, timestamp, timestamp_map, samples,
+                    chrono::duration<float, milli>(after - before).count());
+}
+
+std::pair<std::pair<char*, int>, std::pair<char*, int>> Runtime::encode() {
+    acquire_stage_memory(PipelineStage::Encoder);
+    encoder->get_mutex()->lock();
+    encoder->read_input_data(melspectro_outputs[0].first, 0);
+    encoder->get_mutex()->unlock();
+    // the mel spectrogram has been copied into the encoder's input
+    release_stage_memory(PipelineStage::MelSpectrogram);
+    encoder->invoke(true);
+    stage_memory[(int)PipelineStage::Encoder].peak_kb =
+        max(stage_memory[(int)PipelineStage::Encoder].peak_kb, ProcessStats::current_rss_kb());
+
+    auto k_cache_cross = encoder->get_output_with_name("k_cache_cross");
+    if (k_cache_cross.first == nullptr) {
+        k_cache_cross = encoder->get_output_with_name("k_cache");
+    }
+    auto v_cache_cross = encoder->get_output_with_name("v_cache_cross");
+    if (v_cache_cross.first == nullptr) {
+        v_cache_cross = encoder->get_output_with_name("v_cache");
+    }
+    return {k_cache_cross, v_cache_cross};
+}
+
+void Runtime::decode_postproc(char* k_cache_cross, char* v_cache_cross, float timestamp,
+                              const TimestampMap* timestamp_map, const char* samples, float encode_ms) {
+    auto before = chrono::steady_clock::now();
+    auto tokens = decode(k_cache_cross, v_cache_cross, timestamp);
+    auto after = chrono::steady_clock::now();
+    const float fast_ms = encode_ms + chrono::duration<float, milli>(after - before).count();
+    TranscriptionSegment escalated;
+    if (cascade != nullptr && samples != nullptr && !stopped() &&
+        escalate(samples, timestamp, timestamp_map, tokens, fast_ms, escalated)) {
+        // the larger model's decode as a whole: its text, tokens, end time & confidence
+        publish(std::move(escalated), false);
+        return;
+    }
+    postproc->decode_segment(tokens, timestamp, timestamp_map);
+    // tokens[0] is the start of transcript token
+    publish_segment(std::vector<int>(tokens.begin() + 1, tokens.end()), timestamp, timestamp_map);
+}
+
+bool Runtime::escalate(const char* samples, float timestamp, const TimestampMap* timestamp_map,
+                       const std::vector<int>& tokens, float fast_ms, TranscriptionSegment& segment) {
+    // Whisper's temperature fallback rules: low confidence & repetition loops are redone, unless it is likely
+    // that there was no speech to begin with
+    auto confidence = postproc->get_confidence(tokens);
+    const bool unsure = confidence.avg_logprob < config.get_cascade_logprob_threshold() &&
+                        confidence.no_speech_prob <= config.get_cascade_no_speech_threshold();
+    const bool looping = confidence.compression_ratio > config.get_cascade_compression_ratio_threshold();
+
+    std::vector<TranscriptionSegment> segments;
+    float large_ms = 0;
+    if (unsure || looping) {
+        const auto priority = chunk_lock != nullptr ? chunk_priority : Priority::Realtime;
+        cascade->transcribe_chunk(priority, samples, timestamp, timestamp_map, nullptr, &large_ms, &segments);
+        LOGI("Cascade: chunk at %.2f s escalated (avg logprob %.2f, no speech %.2f, compression %.2f)\n", timestamp,
+             confidence.avg_logprob, confidence.no_speech_prob, confidence.compression_ratio);
+    }
+    {
+        lock_guard<mutex> lock(cascade_mutex);
+        cascade_stats.chunks++;
+        cascade_stats.fast_ms += fast_ms;
+        if (unsure || looping) {
+            cascade_stats.escalated++;
+            cascade_stats.large_ms += large_ms;
+        }
+    }
+    // a stopped request keeps the fast model's text
+    if (!(unsure || looping) || cascade->stopped() || segments.empty()) return false;
+
+    segment = std::move(segments.back());
+    return true;
+}
+
+CascadeStats Runtime::get_cascade_stats() {
+    lock_guard<mutex> lock(cascade_mutex);
+    return cascade_stats;
+}
+
+bool Runtime::request_swap(std::unique_ptr<Runtime>& standby) {
+    {
+        lock_guard<mutex> lock(swap_mutex);
+        if (swap_standby) return false;
+        swap_stats.preload_ms.push_back(standby->load_latency + standby->prewarm_latency);
+        swap_standby = std::move(standby);
+        swap_requested = chrono::steady_clock::now();
+    }
+
+    // serial runtime: chunks are transcribed under gmutex, so holding it is a chunk boundary
+    unique_lock<mutex> lock(gmutex);
+    if (is_staged() && stages) {
+        // the ingest queue has a single producer, the thread appending audio passes the swap on
+        swap_pending = true;
+        return true;
+    }
+    if (is_windowed() && window) {
+        lock.unlock();
+        window->request_swap();
+        return true;
+    }
+    apply_swap();
+    return true;
+}
+
+void Runtime::swap_encoder_models(Runtime& other) {
+    std::swap(melspectro_model, other.melspectro_model);
+    std::swap(encoder_model, other.encoder_model);
+    std::swap(melspectro, other.melspectro);
+    std::swap(encoder, other.encoder);
+    std::swap(delegate_manager, other.delegate_manager);
+    std::swap(melspectro_inputs, other.melspectro_inputs);
+    std::swap(melspectro_outputs, other.melspectro_outputs);
+    std::swap(encoder_inputs, other.encoder_inputs);
+    std::swap(encoder_outputs, other.encoder_outputs);
+}
+
+void Runtime::swap_decoder_models(Runtime& other) {
+    std::swap(tokenizer_json, other.tokenizer_json);
+    std::swap(tokenizer_config_json, other.tokenizer_config_json);
+    std::swap(decoder_model, other.decoder_model);
+    std::swap(decoder, other.decoder);
+    std::swap(postproc, other.postproc);
+    std::swap(tokenizer, other.tokenizer);
+    std::swap(model_init_stats, other.model_init_stats);
+    std::swap(tuning_stats, other.tuning_stats);
+    const auto model_path = config.get_model_path();
+    config.set_model_path(other.config.get_model_path().c_str());
+    other.config.set_model_path(model_path.c_str());
+}
+
+void Runtime::apply_swap() {
+    {
+        lock_guard<mutex> lock(swap_mutex);
+        swap_encoder_models(*swap_standby);
+        swap_decoder_models(*swap_standby);
+        // lazy loading: either side may not be loaded yet
+        const bool loaded = models_loaded;
+        models_loaded = swap_standby->models_loaded.load();
+        swap_standby->models_loaded = loaded;
+    }
+    finish_swap();
+}
+
+void Runtime::push_pending_swap() {
+    if (swap_pending.exchange(false)) stages->push_swap();
+}
+
+void Runtime::swap_standby_encoder() {
+    lock_guard<mutex> lock(swap_mutex);
+    swap_encoder_models(*swap_standby);
+}
+
+void Runtime::swap_standby_decoder() {
+    {
+        lock_guard<mutex> lock(swap_mutex);
+        swap_decoder_models(*swap_standby);
+    }
+    finish_swap();
+}
+
+void Runtime::finish_swap() {
+    std::unique_ptr<Runtime> previous;
+    {
+        lock_guard<mutex> lock(swap_mutex);
+        swap_stats.swaps++;
+        swap_stats.switch_ms.push_back(
+            chrono::duration<float, milli>(chrono::steady_clock::now() - swap_requested).count());
+        previous = std::move(swap_standby);
+    }
+    LOGI("Model swap: switched to %s\n", config.get_model_path().c_str());
+    // previous releases the previous models
+}
+
+std::vector<int> Runtime::decode(char* k_cache_cross, char* v_cache_cross, float timestamp) {
+    const auto decode_start = chrono::steady_clock::now();
+    auto x = tokenizer->specialTokens.startOfTranscriptToken;
+    int index = 0;
+    vector<int> tokens;
+    tokens.push_back(tokenizer->specialTokens.startOfTranscriptToken);
+
+    // window decodes are hypotheses, their committed text comes through the segments
+    const bool stream_tokens = token_queue != nullptr && !is_windowed();
+    float first_token_ms = -1;
+    float token_time = timestamp;
+    // the decoding never waits for the token callback: tokens the full queue does not take are coalesced into
+    // the next one it does
+    auto chunk_tokenizer = stream_tokens ? tokenizer : nullptr;
+    std::vector<int> coalesced;
+    uint64_t dropped_tokens = 0;
+    auto stream_token = [&](int token, chrono::steady_clock::time_point decoded) {
+        TokenItem item{segment_index, token, token_time, postproc->get_last_logprob(), decoded, chunk_tokenizer,
+                       std::move(coalesced)};
+        if (token_queue->try_push(item)) {
+            chunk_tokenizer.reset();
+            coalesced.clear();
+            return;
+        }
+        coalesced = std::move(item.coalesced);
+        coalesced.push_back(token);
+        dropped_tokens++;
+    };
+
+    acquire_stage_memory(PipelineStage::Decoder);
+    decoder->bind_input_tensor(k_cache_cross, "k_cache_cross");
+    decoder->bind_input_tensor(v_cache_cross, "v_cache_cross");
+    // the cross attention caches have been copied into the decoder's inputs;
+    // the staged runtime copies them out of the encoder and releases it on the encode stage
+    if (!is_staged()) release_stage_memory(PipelineStage::Encoder);
+
+    decoder->initialize_kv_cache();
+
+    // REDUCE_DECODING lowers the limit while streaming is overloaded
+    const int max_steps = decoding_steps;
+    for (; index < max_steps; index++) {
+        if (index > 0 && chunk_lock != nullptr && chunk_priority == Priority::Batch && gate.realtime_waiting()) {
+            yield_decoder(index, tokens);
+        }
+        decoder->bind_input_tensor((char*)&x, "x");
+        decoder->bind_input_tensor((char*)&index, "index");
+        decoder->update_kv_cache();
+
+        decoder->invoke(true);
+        // keep the text decoded so far, the interrupted step's logits are not usable
+        if (stopped()) break;
+
+        const auto& logits_tensor = decoder->get_logits_tensor();
+        const auto& logits = reinterpret_cast<float*>(logits_tensor.first);
+        const auto& logits_size = logits_tensor.second / sizeof(float);
+
+        x = postproc->process(index, logits, logits_size, tokens, timestamp);
+
+        tokens.push_back(x);
+        if (x == -1) break;
+        const auto decoded = chrono::steady_clock::now();
+        if (x >= tokenizer->specialTokens.timestampBeginToken) {
+            token_time = timestamp + (x - tokenizer->specialTokens.timestampBeginToken) * 0.02f;
+        } else if (first_token_ms < 0 && x < tokenizer->specialTokens.endOfTranscriptToken) {
+            first_token_ms = chrono::duration<float, milli>(decoded - decode_start).count();
+        }
+        if (stream_tokens) stream_token(x, decoded);
+        if (x == tokenizer->specialTokens.endOfTranscriptToken) break;
+    }
+    {
+        lock_guard<mutex> lock(token_mutex);
+        if (first_token_ms >= 0) token_stats.first_token_ms.push_back(first_token_ms);
+        token_stats.dropped += dropped_tokens;
+        token_stats.decode_ms.push_back(
+            chrono::duration<float, milli>(chrono::steady_clock::now() - decode_start).count());
+    }
+    stage_memory[(int)PipelineStage::Decoder].peak_kb =
+        max(stage_memory[(int)PipelineStage::Decoder].peak_kb, ProcessStats::current_rss_kb());
+    release_stage_memory(PipelineStage::Decoder);
+    return tokens;
+}
+
+void Runtime::benchmark_decoder_state() {
+    // on the CPU, which every device has: states are copied in host memory whatever the backend. The post
+    // processor is this runtime's, parked with the decoder state the way yield_decoder() does
+    lock_guard<mutex> lock(gmutex);
+    load_models();
+    DecoderStateBenchmark benchmark(lib_dir, cache_dir);
+    state_switch_stats = benchmark.run(decoder_model, ComputeBackend::CPU,
+                                       scheduler->placement_for(PipelineStage::Decoder), postproc.get());
+}
+
+void Runtime::publish_segment(const std::vector<int>& tokens, float timestamp, const TimestampMap* timestamp_map,
+                              bool partial) {
+    TranscriptionSegment segment;
+    segment.start_time = timestamp;
+    segment.tokens = tokens;
+    // partial segments are only passed to the callback, the result keeps committed text
+    segment.text = *postproc->get_sentence();
+
+    // the segment ends at its last timestamp token, if the model produced any
+    float end_time = 0;
+    for (auto token : tokens) {
+        if (token >= tokenizer->specialTokens.timestampBeginToken) {
+            end_time = max(end_time, (token - tokenizer->specialTokens.timestampBeginToken) * 0.02f);
+        }
+    }
+    segment.end_time = timestamp_map ? to_audio_time(*timestamp_map, end_time) : timestamp + end_time;
+    const auto confidence = postproc->get_logprobs();
+    segment.avg_logprob = confidence.avg_logprob;
+    segment.no_speech_prob = confidence.no_speech_prob;
+    publish(std::move(segment), partial);
+}
+
+void Runtime::publish(TranscriptionSegment segment, bool partial) {
+    if (!partial) {
+        last_segment_end = segment.end_time;
+        lock_guard<mutex> lock(results_mutex);
+        for (auto token : segment.tokens) all_tokens.push_back(token);
+
+        if (!has_first_result) {
+            first_result_exec = chrono::high_resolution_clock::now();
+            has_first_result = true;
+        }
+
+        messenger->_msg = make_unique<std::string>(segment.text);
+        messenger->_timestamp = segment.start_time;
+        messenger->_cond_var.notify_all();
+        all_msgs.push_back(segment.text);
+        all_segments.push_back(segment);
+    }
+
+    if (segment_callback) {
+        whisperkit_segment_t callback_segment;
+        callback_segment.chunk_index = segment_index;
+        callback_segment.start_time = segment.start_time;
+        callback_segment.end_time = segment.end_time;
+        callback_segment.text = segment.text.c_str();
+        callback_segment.partial = partial;
+        segment_callback(&callback_segment, segment_callback_data);
+    }
+    if (!partial) {
+        segment_index = next_segment_index >= 0 ? next_segment_index : segment_index + 1;
+        next_segment_index = -1;
+    }
+}
+
+void Runtime::publish_tokens(const std::vector<int>& tokens, float timestamp, bool partial) {
+    postproc->decode_segment(tokens, timestamp);
+    publish_segment(tokens, timestamp, nullptr, partial);
+}
+
+void Runtime::invoke_melspectro(const char* samples) {
+    acquire_stage_memory(PipelineStage::MelSpectrogram);
+    memcpy(melspectro_inputs[0].first, samples, melspectro_inputs[0].second);
+    melspectro->invoke(true);
+    stage_memory[(int)PipelineStage::MelSpectrogram].peak_kb =
+        max(stage_memory[(int)PipelineStage::MelSpectrogram].peak_kb, ProcessStats::current_rss_kb());
+}
+
+std::string Runtime::transcribe_chunk(Priority priority, const char* samples, float timestamp,
+                                      const TimestampMap* timestamp_map, float* end_time, float* busy_ms,
+                                      std::vector<TranscriptionSegment>* segments) {
+    const float delay_ms = gate.acquire(priority);
+    {
+        lock_guard<mutex> stats_lock(priority_mutex);
+        auto& stats = priority_stats[(int)priority];
+        stats.chunks++;
+        stats.queue_delay_ms.push_back(delay_ms);
+    }
+
+    std::string text;
+    {
+        unique_lock<mutex> lock(gmutex);
+        chunk_lock = &lock;
+        chunk_priority = priority;
+        load_models();
+        if (!stopped()) {
+            auto before = chrono::steady_clock::now();
+            last_segment_end = timestamp;
+            invoke_melspectro(samples);
+            encode_decode_postproc(timestamp, timestamp_map, samples);
+            if (end_time) *end_time = last_segment_end;
+            text = *get_result_text(segments);
+            auto after = chrono::steady_clock::now();
+            if (busy_ms) *busy_ms = chrono::duration<float, milli>(after - before).count();
+        }
+        chunk_lock = nullptr;
+    }
+    gate.release();
+    return text;
+}
+
+void Runtime::yield_decoder(int index, const std::vector<int>& tokens) {
+    // the encoder's outputs will be overwritten, the cross attention caches are copied out of the decoder
+    DecoderState state;
+    decoder->save_state(state, index - 1, tokens);
+    decoder->detach_cross_kv(state);
+    // the chunks run in between reset the post processor's confidence, and publish segments of their own:
+    // this chunk keeps its index, theirs come after it
+    PostProcState postproc_state;
+    postproc->save_state(postproc_state);
+    const int parked_segment_index = segment_index;
+    segment_index = next_segment_index >= 0 ? next_segment_index : segment_index + 1;
+    next_segment_index = -1;
+    release_stage_memory(PipelineStage::Decoder);
+
+    auto* lock = chunk_lock;
+    lock->unlock();
+    gate.release();
+    const float delay_ms = gate.acquire(Priority::Batch);
+    lock->lock();
+    chunk_lock = lock;
+    chunk_priority = Priority::Batch;
+    {
+        lock_guard<mutex> stats_lock(priority_mutex);
+        auto& stats = priority_stats[(int)Priority::Batch];
+        stats.preemptions++;
+        stats.queue_delay_ms.push_back(delay_ms);
+    }
+
+    acquire_stage_memory(PipelineStage::Decoder);
+    decoder->restore_state(state);
+    postproc->restore_state(postproc_state);
+    next_segment_index = segment_index;
+    segment_index = parked_segment_index;
+}
+
+std::array<PriorityStats, PriorityGate::kNumClasses> Runtime::get_priority_stats() {
+    lock_guard<mutex> lock(priority_mutex);
+    return priority_stats;
+}
+
+int Runtime::get_chunk_bytes() {
+    lock_guard<mutex> lock(gmutex);
+    load_models();
+    return melspectro_inputs[0].second;
+}
+
+int Runtime::append_audio_data(int size, char* pcm_buffer0, char* pcm_buffer1) {
+    if (!pcm_buffer0 || size <= 0) {
+        return -1;
+    }
+    if (is_staged()) push_pending_swap();
+    if ((is_staged() || is_windowed()) && !admit_audio(size, pcm_buffer0)) return 0;
+    if (is_staged()) {
+        // resampling & chunking happen on the ingest stage
+        stages->append(size, pcm_buffer0, pcm_buffer1, size / input_bytes_per_second);
+        return 0;
+    }
+    if (is_windowed()) {
+        audioinput->fill_pcmdata(size, pcm_buffer0, pcm_buffer1);
+        window->append(*audioinput);
+        return 0;
+    }
+    // resampling & VAD run on the caller's thread, whose affinity is the caller's business
+    audioinput->fill_pcmdata(size, pcm_buffer0, pcm_buffer1);
+    std::chrono::steady_clock::time_point speech_end;
+    if (audioinput->take_endpoint(speech_end)) pending_endpoints.push_back(speech_end);
+    return audioinput->get_curr_buf_time();
+}
+
+void Runtime::write_report(const char* audio_file, const std::string& transcription) {
+    if (report_dir.empty()) return;
+
+    auto testjson = make_unique<json>();
+    auto testinfo = json();
+    auto staticattr = json();
+    auto latstats = json();
+    auto measure = json();
+    auto timings = json();
+
+    testinfo["model"] = config.get_model_path();
+#if defined(__ANDROID__)
+    testinfo["device"] = getProperty("ro.product.brand") + " " + getProperty("ro.soc.model");
+#else
+    struct utsname info;
+    if (uname(&info) == 0) {
+        testinfo["device"] = std::string("Architecture: ") + info.machine;
+    } else {
+        testinfo["device"] = "Unknown architecture";
+    }
+#endif
+
+    time_t now;
+    char buf[32];
+    time(&now);
+    strftime(buf, sizeof buf, "%FT%TZ", gmtime(&now));
+    testinfo["date"] = buf;
+
+    float duration = chrono::duration_cast<std::chrono::microseconds>(end_exec - start_exec).count() / 1000.0;
+
+    // Extract filename from path using string operations
+    std::string filename = audio_file;
+    size_t pos = filename.find_last_of("/\\");
+    std::string basename = (pos != std::string::npos) ? filename.substr(pos + 1) : filename;
+    testinfo["audioFile"] = basename;
+    // testinfo["prediction"] = all_tokens;  -> for numeric tokens output
+    testinfo["prediction"] = transcription;
+
+    timings["inputAudioSeconds"] = audioinput->get_total_input_time();
+    timings["totalEncodingRuns"] = encoder->get_inference_num();
+    // TODO: get the right number once temp fallback is implemented
+    timings["totalDecodingFallbacks"] = 0;
+    timings["totalDecodingLoops"] = decoder->get_inference_num();
+    timings["fullPipeline"] = duration;
+    if (audioinput->get_total_input_time() > 0) {
+        timings["realTimeFactor"] = duration / 1000.0 / audioinput->get_total_input_time();
+    }
+    timings["modelLoading"] = load_latency;
+    timings["prewarm"] = prewarm_latency;
+    timings["audioInputSetup"] = audio_input_setup_ms;
+    if (has_first_result) {
+        timings["firstChunkLatency"] =
+            chrono::duration_cast<std::chrono::microseconds>(first_result_exec - start_exec).count() / 1000.0;
+    }
+    testinfo["timings"] = timings;
+    testinfo["modelInitialization"] = model_init_stats;
+    testinfo["threadPlacement"] = scheduler->to_json();
+    testinfo["tuning"] = tuning_stats;
+    if (config.get_vad_packing() && !is_staged()) {
+        testinfo["vadPacking"] = {{"encoderWindows", packed_chunks}, {"speechRegions", packed_regions}};
+    }
+    if (is_windowed() && window) {
+        testinfo["lowLatencyStreaming"] = window->to_json();
+    } else if (streaming_mode && config.get_endpoint_hangover_ms() > 0) {
+        lock_guard<mutex> lock(results_mutex);
+        testinfo["endpointing"] = {{"hangoverMs", config.get_endpoint_hangover_ms()},
+                                   {"utterances", endpoint_latency_ms.size()},
+                                   {"endOfSpeechToTextMs", latency_summary(endpoint_latency_ms)}};
+    }
+    if (streaming_mode) {
+        const std::array<const char*, 4> policy_names = {"block", "dropAudio", "dropSilence", "reduceDecoding"};
+        const auto real_time_factor = get_real_time_factor();
+        lock_guard<mutex> lock(overload_mutex);
+        testinfo["overload"] = {{"policy", policy_names[config.get_overload_policy()]},
+                                {"maxBacklogMs", config.get_max_backlog_ms()},
+                                {"peakBacklogMs", peak_backlog * 1000},
+                                {"droppedMs", dropped_seconds * 1000},
+                                {"overloadEvents", overload_events},
+                                {"realTimeFactor", real_time_factor}};
+    }
+    if (cascade) testinfo["cascade"] = cascade_json({this});
+    {
+        // time to first token is what a token callback waits for, segment decode what a segment callback does
+        lock_guard<mutex> lock(token_mutex);
+        testinfo["tokenStreaming"] = {{"tokenCallback", token_callback != nullptr},
+                                      {"timeToFirstTokenMs", latency_summary(token_stats.first_token_ms)},
+                                      {"segmentDecodeMs", latency_summary(token_stats.decode_ms)},
+                                      {"callbackLagMs", latency_summary(token_stats.callback_lag_ms)},
+                                      {"droppedTokens", token_stats.dropped}};
+    }
+    {
+        lock_guard<mutex> lock(swap_mutex);
+        if (swap_stats.swaps > 0) {
+            testinfo["modelSwaps"] = {{"swaps", swap_stats.swaps},
+                                      {"preloadMs", latency_summary(swap_stats.preload_ms)},
+                                      {"requestToSwitchMs", latency_summary(swap_stats.switch_ms)}};
+        }
+    }
+    if (!state_switch_stats.is_null()) testinfo["decoderStateSwitch"] = state_switch_stats;
+    if (is_staged() && stages) testinfo["stages"] = stages->to_json(duration);
+
+#if defined(__ANDROID__)
+    staticattr["os"] = "Android " + getProperty("ro.build.version.release");
+#else
+    if (uname(&info) == 0) {
+        staticattr["os"] = info.release;
+    } else {
+        staticattr["os"] = "Unknown OS";
+    }
+#endif
+
+    staticattr["cpuTopology"] = CpuTopology::instance().to_json();
+
+    measure["cumulativeTokens"] = all_tokens.total();
+    measure["numberOfMeasurements"] = all_tokens.total();
+    measure["timeElapsed"] = decoder->get_latency_sum();
+
+    latstats["measurements"] = measure;
+    latstats["totalNumberOfMeasurements"] = all_tokens.total();
+    latstats["units"] = "Tokens/Sec";
+    latstats["encoder"] = *encoder->get_latency_json();
+    latstats["decoder"] = *decoder->get_latency_json();
+
+    auto memstats = json();
+    memstats["currentRSSMB"] = ProcessStats::current_rss_kb() / 1024.0;
+    memstats["peakRSSMB"] = ProcessStats::peak_rss_kb() / 1024.0;
+    memstats["lowMemory"] = config.get_low_memory();
+    memstats["releaseLatencyMs"] = memory_latency.load();
+    const std::array<std::pair<PipelineStage, const char*>, 3> memory_stages = {
+        {{PipelineStage::MelSpectrogram, "melSpectrogram"},
+         {PipelineStage::Encoder, "encoder"},
+         {PipelineStage::Decoder, "decoder"}}};
+    for (auto& [stage, name] : memory_stages) {
+        memstats["stages"][name] = {{"peakRSSMB", stage_memory[(int)stage].peak_kb / 1024.0},
+                                    {"steadyRSSMB", stage_memory[(int)stage].steady_kb / 1024.0}};
+    }
+
+    (*testjson)["latencyStats"] = latstats;
+    (*testjson)["memoryStats"] = memstats;
+    (*testjson)["testInfo"] = testinfo;
+    (*testjson)["staticAttributes"] = staticattr;
+
+    ofstream out_file;
+    struct stat sb;
+
+    if (stat(report_dir.c_str(), &sb) != 0) {
+        mkdir(report_dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    }
+    out_file.open(report_dir + "/output.json");
+    out_file << testjson->dump() << endl;
+    out_file.close();
+}
+
+#ifdef QCOM_SOC
+#undef QCOM_SOC
+#endif
+
+}  // namespace WhisperKit::TranscribeTask
@@ -0,0 +1,334 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BoundedRing.hpp"
+#include "CpuTopology.hpp"
+#include "DelegateInterface.hpp"
+#include "PriorityGate.hpp"
+#include "SpscQueue.hpp"
+#include "TextDecoder.hpp"
+#include "TimestampMap.hpp"
+#include "TuningProfile.hpp"
+#include "WhisperKitConfiguration.hpp"
+#include "WhisperKitTranscriptionResult.hpp"
+#include "audio_input.hpp"
+#include "post_proc.hpp"
+#include "tflite_model.hpp"
+#include "tflite_msg.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+class StagePipeline;
+class WindowedStream;
+
+// RSS in KB right after a pipeline stage ran (peak), and once it is done with its
+// scratch memory (steady), which is where low memory mode releases the arena
+struct StageMemory {
+    long peak_kb = 0;
+    long steady_kb = 0;
+};
+
+// per priority class: time chunks waited for the runtime, and batch chunks that gave it up mid decoding
+struct PriorityStats {
+    uint64_t chunks = 0;
+    uint64_t preemptions = 0;
+    std::vector<float> queue_delay_ms;
+};
+
+// cascade: chunks the larger model redid, and what the two models spent on encoding & decoding
+struct CascadeStats {
+    uint64_t chunks = 0;
+    uint64_t escalated = 0;
+    float fast_ms = 0;
+    float large_ms = 0;
+};
+
+// token streaming: a decoded token, on its way from the decode loop to the token thread
+struct TokenItem {
+    int chunk_index = 0;
+    int token = -1;
+    float timestamp = 0;
+    float logprob = 0;
+    std::chrono::steady_clock::time_point decoded{};
+    std::shared_ptr<Tokenizer> tokenizer{};  // with a chunk's first token; a model swap may replace the runtime's
+    std::vector<int> coalesced{};            // tokens before this one the full queue did not take
+};
+
+struct TokenStats {
+    std::vector<float> first_token_ms;   // from the start of decoding to the first text token
+    std::vector<float> decode_ms;        // from the start of decoding to the end of the segment
+    std::vector<float> callback_lag_ms;  // from a token's decoding to its callback
+    uint64_t dropped = 0;                // tokens coalesced into a later one, or lost at the end of their segment
+};
+
+// model swaps: time to load the standby's models, and from the swap request to its first chunk boundary
+struct SwapStats {
+    uint64_t swaps = 0;
+    std::vector<float> preload_ms;
+    std::vector<float> switch_ms;
+};
+
+/*
+    Private class to encapsulate tflite related code, so we can delete it imminently from
+    whisperax_cli and whisperax.cpp.
+
+    A runtime owns one set of models (MelSpectrogram, encoder, decoder, tokenizer & post
+    processor) and the audio input of the stream running on them, and transcribes the stream
+    on the caller's thread. Streams with a segment callback run on its stage pipeline instead,
+    low latency streams on its windowed stream: both are owned by the runtime and borrow its
+    models for their threads. Batches & sessions run on replicas, runtimes of their own.
+*/
+class Runtime {
+   public:
+    Runtime(const whisperkit_configuration_t& config);
+    ~Runtime();
+
+    void init();
+    void load_models();
+    void prewarm_models();
+    void close();
+    int decoder_loop();
+    void init_audio_input(int sample_rate = 16000, int num_channels = 1, int fmt = AV_SAMPLE_FMT_NONE);
+    int append_audio_data(int size, char* pcm_buffer_left, char* pcm_buffer_right = nullptr);
+    void conclude_transcription();
+
+    void output_proc();
+    bool check_qcom_soc();
+    std::string device_id();
+    void tune_models(TuningProfile& profile);
+    void audio_melspectro_proc();
+    void acquire_stage_memory(PipelineStage stage);
+    void release_stage_memory(PipelineStage stage);
+    // samples: the chunk's audio, for the cascade's larger model
+    void encode_decode_postproc(float timestamp, const TimestampMap* timestamp_map = nullptr,
+                                const char* samples = nullptr);
+    std::pair<std::pair<char*, int>, std::pair<char*, int>> encode();
+    void invoke_melspectro(const char* samples);
+    // transcribes one chunk produced by AudioInputModel, returns its result text and where its segment ends,
+    // and appends its segment to segments; realtime chunks are admitted first, and preempt a batch chunk's decoding
+    std::string transcribe_chunk(Priority priority, const char* samples, float timestamp,
+                                 const TimestampMap* timestamp_map = nullptr, float* end_time = nullptr,
+                                 float* busy_ms = nullptr, std::vector<TranscriptionSegment>* segments = nullptr);
+    // at a decoding step boundary of a batch chunk: parks its decoder state while realtime chunks run
+    void yield_decoder(int index, const std::vector<int>& tokens);
+    std::array<PriorityStats, PriorityGate::kNumClasses> get_priority_stats();
+    int get_chunk_bytes();
+    // cores of the models' stages, for the threads the library runs them on; pinned once, when they start
+    std::vector<int> compute_cpus() const { return scheduler->placement_for(PipelineStage::Encoder).cpus; }
+    ThreadPlacement placement_for(PipelineStage stage) const { return scheduler->placement_for(stage); }
+    const whisperkit_configuration_t& get_config() const { return config; }
+    // the stream's audio input, fed by the thread the stream's mode appends on
+    AudioInputModel& get_audio_input() { return *audioinput; }
+    std::shared_ptr<Tokenizer> get_tokenizer() const { return tokenizer; }
+    void decode_postproc(char* k_cache_cross, char* v_cache_cross, float timestamp,
+                         const TimestampMap* timestamp_map = nullptr, const char* samples = nullptr,
+                         float encode_ms = 0);
+    // cascade: redoes the chunk with the larger model if the decoding was not confident; true if it did,
+    // with the larger model's segment in segment
+    bool escalate(const char* samples, float timestamp, const TimestampMap* timestamp_map,
+                  const std::vector<int>& tokens, float fast_ms, TranscriptionSegment& segment);
+    void set_cascade(Runtime* cascade) { this->cascade = cascade; }
+    bool has_cascade() const { return cascade != nullptr; }
+    // model swap: standby's models replace this runtime's at the stream's next chunk boundary, and the
+    // previous models are released with standby; false while the previous swap is pending
+    // takes standby, unless a swap is pending already
+    bool request_swap(std::unique_ptr<Runtime>& standby);
+    std::string get_model_path() const { return config.get_model_path(); }
+    // all of the models at once, on the thread running the stream; releases the standby
+    void apply_swap();
+    // staged runtime: the producer of the ingest queue passes on a requested swap; the encode stage then takes
+    // the standby's MelSpectrogram & encoder, and the decode stage its decoder, which completes the swap
+    void push_pending_swap();
+    void swap_standby_encoder();
+    void swap_standby_decoder();
+    CascadeStats get_cascade_stats();
+    // runs the decoder, returns the tokens starting with the start of transcript token
+    std::vector<int> decode(char* k_cache_cross, char* v_cache_cross, float timestamp);
+    // report: save & restore cost on a decoder of its own, at build time
+    void benchmark_decoder_state();
+    // the segment's text is the post processor's current sentence
+    void publish_segment(const std::vector<int>& tokens, float timestamp, const TimestampMap* timestamp_map,
+                         bool partial = false);
+    // passes segment to the callback and, unless partial, to the result
+    void publish(TranscriptionSegment segment, bool partial);
+    // decodes tokens of the window into the post processor's sentence, and publishes it
+    void publish_tokens(const std::vector<int>& tokens, float timestamp, bool partial);
+    void transcribe_packed();
+    // a segment callback needs the stage threads, so appends don't wait for transcription
+    bool is_staged() const { return (config.get_staged() || segment_callback != nullptr) && !is_windowed(); }
+    // low latency streaming: the window thread re-decodes the audio since the last committed segment
+    bool is_windowed() const { return streaming_mode && config.get_stream_interval_ms() > 0; }
+    // endpointing: the serial runtime transcribes the buffered audio once an utterance ended
+    bool endpoint_pending() const { return !pending_endpoints.empty(); }
+    void record_endpoint(std::chrono::steady_clock::time_point speech_end);
+    void set_segment_callback(whisperkit_segment_callback_t callback, void* user_data);
+    bool has_segment_callback() const { return segment_callback != nullptr; }
+    // token streaming: the decode loop queues its tokens, the token thread detokenizes them for the callback
+    void set_token_callback(whisperkit_token_callback_t callback, void* user_data);
+    void stop_token_thread();
+    void token_proc();
+    // overload policy: whether audio appended to a staged or windowed stream is queued, or dropped
+    bool admit_audio(int size, const char* pcm_buffer);
+    // audio queued behind the chunk being transcribed, in seconds
+    float backlog_seconds();
+    // moves in & out of overload, and tells the overload callback; dropped_seconds were not queued
+    void update_overload(float backlog, float dropped_seconds);
+    // real-time factor: busy_ms spent on audio_seconds of the stream
+    void record_progress(float audio_seconds, float busy_ms);
+    float get_real_time_factor();
+    void set_overload_callback(whisperkit_overload_callback_t callback, void* user_data);
+    // stops the request in flight; the first reason is kept until reset_stop()
+    void cancel(whisperkit_status_t reason);
+    void reset_stop() {
+        stop_status = WHISPERKIT_STATUS_SUCCESS;
+        if (cascade) cascade->reset_stop();
+    }
+    bool stopped() const { return stop_status != WHISPERKIT_STATUS_SUCCESS; }
+    whisperkit_status_t get_stop_status() const { return (whisperkit_status_t)stop_status.load(); }
+    void set_streaming_mode(bool streaming_mode);
+    bool get_streaming_mode() const { return streaming_mode; }
+    bool has_result_text();
+    // segments, if not null, receives the segments of the text
+    std::unique_ptr<std::string> get_result_text(std::vector<TranscriptionSegment>* segments = nullptr);
+    void write_report(const char* audio_file, const std::string& transcription);
+
+    std::unique_ptr<TFLiteMessenger> messenger;
+    std::mutex gmutex;
+
+   private:
+    // the thread running the MelSpectrogram & encoder swaps their half, the decoding thread the other one,
+    // so every chunk is encoded & decoded by the same model set; swap_mutex must be held, cancel() reads the models
+    void swap_encoder_models(Runtime& other);
+    void swap_decoder_models(Runtime& other);
+    void finish_swap();
+
+    whisperkit_configuration_t config;
+    std::string lib_dir;
+    std::string cache_dir;
+    std::string report_dir;
+    float melspectro_timestamp;
+    bool debug;
+    bool is_qnn_backend;
+    bool streaming_mode;
+    std::atomic<bool> models_loaded = false;
+    std::atomic<int> stop_status = WHISPERKIT_STATUS_SUCCESS;
+
+    std::string tokenizer_json;
+    std::string tokenizer_config_json;
+    std::string melspectro_model;
+    std::string encoder_model;
+    std::string decoder_model;
+
+    std::unique_ptr<TFLiteModel> melspectro;
+    std::unique_ptr<TFLiteModel> encoder;
+    std::unique_ptr<TextDecoder> decoder;
+    std::unique_ptr<AudioInputModel> audioinput;
+    std::unique_ptr<PostProcModel> postproc;
+    std::shared_ptr<Tokenizer> tokenizer;
+    std::unique_ptr<ThreadScheduler> scheduler;
+    std::shared_ptr<DelegateManager> delegate_manager;
+
+    BoundedRing<int> all_tokens;
+    // unread results: committed text is never dropped, whatever the memory mode
+    std::vector<std::string> all_msgs;
+    std::vector<TranscriptionSegment> all_segments;  // with all_msgs, for the result's segments
+    std::vector<std::pair<char*, int>> melspectro_inputs;
+    std::vector<std::pair<char*, int>> melspectro_outputs;
+    std::vector<std::pair<char*, int>> encoder_inputs;
+    std::vector<std::pair<char*, int>> encoder_outputs;
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_exec;
+    std::chrono::time_point<std::chrono::high_resolution_clock> end_exec;
+    std::chrono::time_point<std::chrono::high_resolution_clock> first_result_exec;
+    bool has_first_result = false;
+    float load_latency = 0;          // ms
+    float prewarm_latency = 0;       // ms
+    float audio_input_setup_ms = 0;  // of the last request
+    json model_init_stats;           // per model: init time, delegate, weight cache state
+    json tuning_stats;               // profile in use, and candidates measured if tuned during this build
+    std::array<StageMemory, kNumPipelineStages> stage_memory;
+    std::atomic<float> memory_latency = 0;  // ms spent releasing & re-allocating tensors in low memory mode
+
+    // created by the first stream that needs them, and kept for the next one
+    std::unique_ptr<StagePipeline> stages;
+    std::unique_ptr<WindowedStream> window;
+    std::mutex results_mutex;  // all_tokens & all_msgs, written by the decode stage
+
+    whisperkit_segment_callback_t segment_callback = nullptr;
+    void* segment_callback_data = nullptr;
+    int segment_index = 0;  // chunks decoded in this stream
+    // the index after those of the chunks a resumed chunk was preempted by, -1 if none was
+    int next_segment_index = -1;
+    float last_segment_end = 0;
+
+    whisperkit_token_callback_t token_callback = nullptr;
+    void* token_callback_data = nullptr;
+    std::unique_ptr<SpscQueue<TokenItem>> token_queue;
+    std::thread token_thread;
+    std::mutex token_mutex;  // token_stats, written by the decoding & token threads
+    TokenStats token_stats;
+
+    // VAD packing: encoder windows & speech regions packed into them
+    int packed_chunks = 0;
+    int packed_regions = 0;
+
+    json state_switch_stats;  // from benchmark_decoder_state()
+
+    // priority classes of transcribe_chunk(), which holds gmutex while admitted
+    PriorityGate gate;
+    std::unique_lock<std::mutex>* chunk_lock = nullptr;
+    Priority chunk_priority = Priority::Realtime;
+    std::mutex priority_mutex;
+    std::array<PriorityStats, PriorityGate::kNumClasses> priority_stats;  // under priority_mutex
+
+    // endpointing: ends of utterance not transcribed yet (serial runtime), and their end of speech to text latency
+    std::vector<std::chrono::steady_clock::time_point> pending_endpoints;
+    std::vector<float> endpoint_latency_ms;  // under results_mutex
+
+    // overload policy of streaming
+    int input_format = AV_SAMPLE_FMT_S16;
+    float input_bytes_per_second = 0;                                  // of pcm_buffer0, as appended
+    std::atomic<int> decoding_steps = TextDecoder::kMaxDecodingSteps;  // lowered by REDUCE_DECODING
+    std::mutex overload_mutex;
+    whisperkit_overload_callback_t overload_callback = nullptr;
+    void* overload_callback_data = nullptr;
+    bool overloaded = false;
+    int overload_events = 0;
+    float peak_backlog = 0;  // seconds
+    float dropped_seconds = 0;
+    BoundedRing<std::pair<float, float>> progress{16};  // last chunks' audio seconds & busy ms
+
+    // cascade: the larger model's runtime, owned by TranscribeTask and shared by its runtimes
+    Runtime* cascade = nullptr;
+    std::vector<char> cascade_samples;  // serial runtime: the chunk in the MelSpectrogram input
+    std::mutex cascade_mutex;
+    CascadeStats cascade_stats;  // under cascade_mutex
+
+    // model swap: the standby holds the new models until the swap, and the previous ones after it
+    std::mutex swap_mutex;
+    std::unique_ptr<Runtime> swap_standby;  // under swap_mutex
+    std::chrono::steady_clock::time_point swap_requested;
+    std::atomic<bool> swap_pending = false;  // staged: not passed to the ingest queue yet
+    SwapStats swap_stats;                    // under swap_mutex
+};
+
+// mean & percentiles of latencies in ms, for reports
+json latency_summary(std::vector<float> latencies);
+// cascade escalations over the runtimes, and the compute saved vs. running the larger model on every chunk
+json cascade_json(const std::vector<Runtime*>& runtimes);
+// queueing delay by priority class, over the runtimes that transcribed chunks
+json priority_json(const std::vector<Runtime*>& runtimes);
+
+}  // namespace WhisperKit::TranscribeTask
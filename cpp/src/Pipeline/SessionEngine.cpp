@@ -0,0 +1,124 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "SessionEngine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "CpuTopology.hpp"
+#include "Runtime.hpp"
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+SessionEngine::SessionEngine(const std::vector<Runtime*>& workers, int chunk_bytes, int endpoint_hangover_ms)
+    : chunk_bytes(chunk_bytes), endpoint_hangover_ms(endpoint_hangover_ms) {
+    for (auto* worker : workers) threads.emplace_back(&SessionEngine::worker_proc, this, worker);
+}
+
+SessionEngine::~SessionEngine() {
+    {
+        lock_guard<mutex> lock(sessions_mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+std::shared_ptr<Session> SessionEngine::open(int sample_rate, int num_channels, whisperkit_segment_callback_t callback,
+                                             void* user_data) {
+    auto session = make_shared<Session>();
+    session->callback = callback;
+    session->user_data = user_data;
+    // 16-bit PCM, like whisperkit_pipeline_appendaudio
+    session->audio = make_unique<AudioInputModel>(sample_rate, num_channels, AV_SAMPLE_FMT_NONE);
+    if (!session->audio->initialize()) {
+        throw std::runtime_error("Failed to initialize the session's audio input");
+    }
+    session->audio->set_endpoint_hangover(endpoint_hangover_ms);
+
+    lock_guard<mutex> lock(sessions_mutex);
+    sessions.push_back(session);
+    return session;
+}
+
+void SessionEngine::append(Session& session, int size, char* buffer0, char* buffer1) {
+    session.audio->fill_pcmdata(size, buffer0, buffer1);
+    std::chrono::steady_clock::time_point speech_end;
+    if (session.audio->take_endpoint(speech_end) || session.audio->get_curr_buf_time() >= CHUNK_SECONDS) {
+        enqueue(session);
+    }
+}
+
+void SessionEngine::enqueue(Session& session) {
+    std::vector<AudioChunk> chunks;
+    split_chunks(*session.audio, chunk_bytes, [&](AudioChunk&& chunk) { chunks.push_back(std::move(chunk)); });
+    if (chunks.empty()) return;
+    {
+        lock_guard<mutex> lock(sessions_mutex);
+        for (auto& chunk : chunks) session.ready.push_back(std::move(chunk));
+    }
+    cond.notify_all();
+}
+
+std::string SessionEngine::close(const std::shared_ptr<Session>& session) {
+    enqueue(*session);
+
+    unique_lock<mutex> lock(sessions_mutex);
+    cond.wait(lock, [&] { return session->ready.empty() && !session->busy; });
+    sessions.erase(find(sessions.begin(), sessions.end(), session));
+    auto text = std::move(session->text);
+    lock.unlock();
+
+    session->audio->uninitialize();
+    return text;
+}
+
+std::shared_ptr<Session> SessionEngine::pick() {
+    for (size_t i = 0; i < sessions.size(); i++) {
+        auto& session = sessions[(next_session + i) % sessions.size()];
+        if (session->busy || session->ready.empty()) continue;
+
+        next_session = (next_session + i + 1) % sessions.size();
+        session->busy = true;
+        return session;
+    }
+    return nullptr;
+}
+
+void SessionEngine::worker_proc(Runtime* worker) {
+    ScopedAffinity affinity(worker->compute_cpus());
+    unique_lock<mutex> lock(sessions_mutex);
+    while (true) {
+        std::shared_ptr<Session> session;
+        cond.wait(lock, [&] { return stopping || (session = pick()) != nullptr; });
+        if (stopping) return;
+
+        auto chunk = std::move(session->ready.front());
+        session->ready.pop_front();
+        const int index = session->chunk_index++;
+        lock.unlock();
+
+        float end_time = chunk.timestamp;
+        auto text =
+            worker->transcribe_chunk(Priority::Realtime, chunk.samples.data(), chunk.timestamp, nullptr, &end_time);
+        if (session->callback && !text.empty()) {
+            auto segment_text = text.substr(0, text.find_last_not_of('\n') + 1);
+            whisperkit_segment_t segment;
+            segment.chunk_index = index;
+            segment.start_time = chunk.timestamp;
+            segment.end_time = end_time;
+            segment.text = segment_text.c_str();
+            segment.partial = false;
+            session->callback(&segment, session->user_data);
+        }
+
+        lock.lock();
+        session->text += text;
+        session->busy = false;
+        cond.notify_all();
+    }
+}
+
+}  // namespace WhisperKit::TranscribeTask
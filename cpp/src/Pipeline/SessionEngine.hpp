@@ -0,0 +1,72 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chunks.hpp"
+#include "WhisperKit.h"
+#include "audio_input.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+class Runtime;
+
+// multi-session engine: one stream registered on a pipeline, chunked on the thread appending its audio
+struct Session {
+    whisperkit_segment_callback_t callback = nullptr;
+    void* user_data = nullptr;
+    std::unique_ptr<AudioInputModel> audio;
+    // under SessionEngine::sessions_mutex
+    std::deque<AudioChunk> ready;
+    bool busy = false;  // one of its chunks is being transcribed, which keeps its segments in order
+    int chunk_index = 0;
+    std::string text;
+};
+
+/*
+    Streams registered on one pipeline, transcribed by the pipeline's runtimes.
+
+    The models take one window at a time, so sessions share them at chunk boundaries: each
+    worker takes the next ready chunk round robin across the sessions, and sessions join or
+    leave the rotation as their chunks become ready, instead of holding interpreters of their own.
+
+    The engine owns the sessions, with their audio inputs, and one thread per worker. It holds
+    no models: the workers are the batch scheduler's replicas, which outlive the engine and are
+    not rebuilt while it runs on them.
+*/
+class SessionEngine {
+   public:
+    // workers: borrowed, see BatchScheduler::pin_workers()
+    SessionEngine(const std::vector<Runtime*>& workers, int chunk_bytes, int endpoint_hangover_ms);
+    ~SessionEngine();
+
+    std::shared_ptr<Session> open(int sample_rate, int num_channels, whisperkit_segment_callback_t callback,
+                                  void* user_data);
+    void append(Session& session, int size, char* buffer0, char* buffer1 = nullptr);
+    // transcribes what is left of the session's audio and unregisters it, returns its transcription
+    std::string close(const std::shared_ptr<Session>& session);
+
+   private:
+    void enqueue(Session& session);
+    void worker_proc(Runtime* worker);
+    // next session with a chunk ready, round robin; sessions_mutex held
+    std::shared_ptr<Session> pick();
+
+    int chunk_bytes;
+    int endpoint_hangover_ms;
+    std::mutex sessions_mutex;
+    std::condition_variable cond;
+    std::vector<std::shared_ptr<Session>> sessions;
+    size_t next_session = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+}  // namespace WhisperKit::TranscribeTask
@@ -0,0 +1,209 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "StagePipeline.hpp"
+
+#include <algorithm>
+
+#include "CpuTopology.hpp"
+#include "Runtime.hpp"
+#include "tflite_msg.hpp"
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+StagePipeline::StagePipeline(Runtime& runtime, int chunk_bytes) : runtime(runtime), chunk_bytes(chunk_bytes) {
+    ingest_queue = make_unique<SpscQueue<IngestItem>>(256);
+    chunk_queue = make_unique<SpscQueue<AudioChunk>>(2);
+    encoded_queue = make_unique<SpscQueue<EncodedChunk>>(2);
+
+    threads.emplace_back(&StagePipeline::ingest_proc, this);
+    threads.emplace_back(&StagePipeline::encode_proc, this);
+    threads.emplace_back(&StagePipeline::decode_proc, this);
+}
+
+StagePipeline::~StagePipeline() {
+    ingest_queue->close();
+    chunk_queue->close();
+    encoded_queue->close();
+    for (auto& thread : threads) thread.join();
+}
+
+void StagePipeline::begin_stream() {
+    stats = {};
+    backlog = 0;
+}
+
+void StagePipeline::append(int size, const char* pcm_buffer0, const char* pcm_buffer1, float seconds) {
+    IngestItem item;
+    item.pcm0.assign(pcm_buffer0, pcm_buffer0 + size);
+    if (pcm_buffer1) item.pcm1.assign(pcm_buffer1, pcm_buffer1 + size);
+    item.seconds = seconds;
+    backlog += item.seconds;
+
+    const auto& config = runtime.get_config();
+    if (config.get_overload_policy() == WHISPERKIT_OVERLOAD_POLICY_BLOCK || config.get_max_backlog_ms() <= 0) {
+        ingest_queue->push(std::move(item));
+    } else if (!ingest_queue->try_push(item)) {
+        backlog -= item.seconds;
+        runtime.update_overload(backlog, item.seconds);
+    }
+}
+
+void StagePipeline::flush() {
+    const auto target = ++flushes_requested;
+    ingest_queue->push(IngestItem{.flush = true});
+    for (auto done = flushes_done.load(); done < target; done = flushes_done.load()) {
+        flushes_done.wait(done);
+    }
+}
+
+void StagePipeline::push_swap() { ingest_queue->push(IngestItem{.swap = true}); }
+
+json StagePipeline::to_json(float duration_ms) const {
+    // utilization close to 1 marks the bottleneck stage
+    const std::array<const char*, 3> stage_names = {"ingest", "encode", "decode"};
+    json result;
+    for (int stage = 0; stage < (int)stage_names.size(); stage++) {
+        auto& stage_stats = stats[stage];
+        result[stage_names[stage]] = {{"busyMs", stage_stats.busy_ms},
+                                      {"blockedMs", stage_stats.blocked_ms},
+                                      {"items", stage_stats.items},
+                                      {"utilization", duration_ms > 0 ? stage_stats.busy_ms / duration_ms : 0}};
+    }
+    return result;
+}
+
+void StagePipeline::ingest_proc() {
+    ScopedAffinity affinity(runtime.placement_for(PipelineStage::Audio).cpus);
+    auto& audio_input = runtime.get_audio_input();
+    auto& stage_stats = stats[0];
+
+    IngestItem item;
+    while (ingest_queue->pop(item)) {
+        if (item.swap) {
+            // the audio buffered for the next chunk stays, and is encoded with the new models
+            chunk_queue->push(AudioChunk{.swap = true});
+            continue;
+        }
+        auto before = chrono::high_resolution_clock::now();
+        float blocked_ms = 0;
+        auto push = [&](AudioChunk&& chunk) {
+            auto before_push = chrono::high_resolution_clock::now();
+            chunk_queue->push(std::move(chunk));
+            auto after_push = chrono::high_resolution_clock::now();
+            blocked_ms += chrono::duration_cast<std::chrono::microseconds>(after_push - before_push).count() / 1000.0;
+        };
+
+        AudioChunk endpoint{.endpoint = true};
+        if (!item.flush) {
+            auto* pcm1 = item.pcm1.empty() ? nullptr : item.pcm1.data();
+            audio_input.fill_pcmdata(item.pcm0.size(), item.pcm0.data(), pcm1);
+            // until it is chunked, the audio is not waiting on the other stages
+            backlog -= item.seconds;
+            endpoint.endpoint = audio_input.take_endpoint(endpoint.speech_end);
+        }
+        if (item.flush || endpoint.endpoint || audio_input.get_curr_buf_time() >= CHUNK_SECONDS) {
+            split_chunks(audio_input, chunk_bytes, [&](AudioChunk&& chunk) {
+                backlog += chunk.duration;
+                push(std::move(chunk));
+                stage_stats.items++;
+            });
+        }
+        if (endpoint.endpoint) push(std::move(endpoint));
+        if (item.flush) push(AudioChunk{.flush = true});
+
+        auto after = chrono::high_resolution_clock::now();
+        stage_stats.busy_ms +=
+            chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0 - blocked_ms;
+        stage_stats.blocked_ms += blocked_ms;
+    }
+}
+
+void StagePipeline::encode_proc() {
+    ScopedAffinity affinity(runtime.placement_for(PipelineStage::Encoder).cpus);
+    auto& stage_stats = stats[1];
+
+    AudioChunk chunk;
+    while (chunk_queue->pop(chunk)) {
+        if (chunk.swap) {
+            runtime.swap_standby_encoder();
+            encoded_queue->push(EncodedChunk{.swap = true});
+            continue;
+        }
+        if (chunk.flush || chunk.endpoint) {
+            encoded_queue->push(
+                EncodedChunk{.flush = chunk.flush, .endpoint = chunk.endpoint, .speech_end = chunk.speech_end});
+            continue;
+        }
+        backlog -= chunk.duration;
+        // a stopped request's remaining chunks are dropped, flushes still go through
+        if (runtime.stopped()) continue;
+        auto before = chrono::high_resolution_clock::now();
+
+        runtime.invoke_melspectro(chunk.samples.data());
+
+        EncodedChunk encoded;
+        encoded.timestamp = chunk.timestamp;
+        encoded.duration = chunk.duration;
+        if (runtime.has_cascade()) encoded.samples = std::move(chunk.samples);
+        auto [k_cache_cross, v_cache_cross] = runtime.encode();
+        if (runtime.stopped()) {
+            runtime.release_stage_memory(PipelineStage::Encoder);
+            continue;
+        }
+        if (k_cache_cross.first == nullptr || v_cache_cross.first == nullptr) {
+            LOGE("Failed to get k_cache_cross or v_cache_cross");
+            runtime.release_stage_memory(PipelineStage::Encoder);
+            continue;
+        }
+        // the encoder's outputs are overwritten by the next chunk while this one is decoded
+        encoded.k_cache_cross.assign(k_cache_cross.first, k_cache_cross.first + k_cache_cross.second);
+        encoded.v_cache_cross.assign(v_cache_cross.first, v_cache_cross.first + v_cache_cross.second);
+        runtime.release_stage_memory(PipelineStage::Encoder);
+
+        auto after = chrono::high_resolution_clock::now();
+        const float encode_ms = chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0;
+        encoded.encode_ms = encode_ms;
+        encoded_queue->push(std::move(encoded));
+        auto after_push = chrono::high_resolution_clock::now();
+        stage_stats.busy_ms += encode_ms;
+        stage_stats.blocked_ms +=
+            chrono::duration_cast<std::chrono::microseconds>(after_push - after).count() / 1000.0;
+        stage_stats.items++;
+    }
+}
+
+void StagePipeline::decode_proc() {
+    ScopedAffinity affinity(runtime.placement_for(PipelineStage::Decoder).cpus);
+    auto& stage_stats = stats[2];
+
+    EncodedChunk chunk;
+    while (encoded_queue->pop(chunk)) {
+        if (chunk.swap) {
+            runtime.swap_standby_decoder();
+            continue;
+        }
+        if (chunk.flush) {
+            flushes_done++;
+            flushes_done.notify_all();
+            continue;
+        }
+        if (chunk.endpoint) {
+            runtime.record_endpoint(chunk.speech_end);
+            continue;
+        }
+        if (runtime.stopped()) continue;
+        auto before = chrono::high_resolution_clock::now();
+        runtime.decode_postproc(chunk.k_cache_cross.data(), chunk.v_cache_cross.data(), chunk.timestamp, nullptr,
+                                chunk.samples.empty() ? nullptr : chunk.samples.data(), chunk.encode_ms);
+        auto after = chrono::high_resolution_clock::now();
+        const float decode_ms = chrono::duration_cast<std::chrono::microseconds>(after - before).count() / 1000.0;
+        stage_stats.busy_ms += decode_ms;
+        stage_stats.items++;
+        // the stages overlap, so the slower one sets the pace
+        runtime.record_progress(chunk.duration, max(chunk.encode_ms, decode_ms));
+    }
+}
+
+}  // namespace WhisperKit::TranscribeTask
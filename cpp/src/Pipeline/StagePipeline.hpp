@@ -0,0 +1,98 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Chunks.hpp"
+#include "SpscQueue.hpp"
+#include "tflite_model.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+class Runtime;
+
+// staged runtime: items passed between the stage threads.
+// flush items travel behind the audio appended before them, to signal the end of a stream.
+struct IngestItem {
+    std::vector<char> pcm0{};
+    std::vector<char> pcm1{};  // planar formats only
+    float seconds = 0;         // of input audio, counted in the backlog until chunked
+    bool flush = false;
+    bool swap = false;  // model swap: the chunks behind it are transcribed with the standby's models
+};
+
+struct EncodedChunk {
+    std::vector<char> k_cache_cross{};
+    std::vector<char> v_cache_cross{};
+    float timestamp = 0;
+    float duration = 0;
+    float encode_ms = 0;
+    std::vector<char> samples{};  // cascade only, the chunk's audio for the larger model
+    bool flush = false;
+    bool endpoint = false;
+    std::chrono::steady_clock::time_point speech_end{};
+    bool swap = false;
+};
+
+// time a stage thread spent processing vs. blocked on a full downstream queue
+struct StageStats {
+    float busy_ms = 0;
+    float blocked_ms = 0;
+    uint64_t items = 0;
+};
+
+/*
+    Staged streaming: ingest -> encode -> decode threads, so that appends don't wait for
+    transcription and the encoder works on the next chunk while the decoder is on this one.
+
+    The pipeline owns its threads and the queues between them, each with a single producer &
+    consumer. The models are its runtime's, which owns the pipeline: the encode thread runs the
+    MelSpectrogram & encoder, the decode thread the decoder & post processor, and the ingest
+    thread the runtime's audio input. Chunks are copied between stages, so each of these is
+    only touched by one thread.
+*/
+class StagePipeline {
+   public:
+    // chunk_bytes: of the MelSpectrogram input
+    StagePipeline(Runtime& runtime, int chunk_bytes);
+    ~StagePipeline();
+
+    // the threads are idle between streams; resets the stats & the backlog of the previous one
+    void begin_stream();
+    // audio of seconds, queued for the ingest thread; blocks while the stages are behind, unless the
+    // overload policy drops audio
+    void append(int size, const char* pcm_buffer0, const char* pcm_buffer1, float seconds);
+    // waits until everything appended so far went through all stages
+    void flush();
+    // the chunks appended after this are transcribed with the standby's models
+    void push_swap();
+    // seconds, from the append until the encode stage takes the chunk, without audio still filling a chunk
+    float backlog_seconds() const { return backlog.load(); }
+    // per stage, over the stream's duration_ms
+    json to_json(float duration_ms) const;
+
+   private:
+    void ingest_proc();
+    void encode_proc();
+    void decode_proc();
+
+    Runtime& runtime;
+    int chunk_bytes;
+    std::unique_ptr<SpscQueue<IngestItem>> ingest_queue;
+    std::unique_ptr<SpscQueue<AudioChunk>> chunk_queue;
+    std::unique_ptr<SpscQueue<EncodedChunk>> encoded_queue;
+    std::vector<std::thread> threads;
+    std::array<StageStats, 3> stats;  // ingest, encode, decode
+    std::atomic<float> backlog = 0;
+    std::atomic<uint32_t> flushes_done = 0;
+    uint32_t flushes_requested = 0;
+};
+
+}  // namespace WhisperKit::TranscribeTask
@@ -0,0 +1,224 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#include "WindowedStream.hpp"
+
+#include <algorithm>
+
+#include "CpuTopology.hpp"
+#include "Runtime.hpp"
+
+using namespace std;
+
+namespace WhisperKit::TranscribeTask {
+
+WindowedStream::WindowedStream(Runtime& runtime, int chunk_bytes) : runtime(runtime), chunk_bytes(chunk_bytes) {
+    agreement = make_unique<LocalAgreement>(runtime.get_tokenizer()->specialTokens.timestampBeginToken);
+    window_thread = thread(&WindowedStream::window_proc, this);
+}
+
+WindowedStream::~WindowedStream() {
+    {
+        lock_guard<mutex> lock(window_mutex);
+        window_closing = true;
+    }
+    window_cond.notify_all();
+    window_thread.join();
+}
+
+void WindowedStream::begin_stream() {
+    lock_guard<mutex> lock(window_mutex);
+    window_pending.clear();
+    window_arrivals.clear();
+    window_stream_samples = 0;
+    window_samples.clear();
+    window_start = 0;
+    window_stats = {};
+    window_overflow = 0;
+}
+
+void WindowedStream::append(AudioInputModel& input) {
+    {
+        lock_guard<mutex> lock(window_mutex);
+        auto now = chrono::steady_clock::now();
+        if (window_stream_samples == 0) window_stream_begin = now;
+        window_stream_samples += input.take_samples(window_pending);
+        window_arrivals.push_back({(float)window_stream_samples / SAMPLE_FREQ, now});
+    }
+    window_cond.notify_all();
+}
+
+void WindowedStream::flush() {
+    unique_lock<mutex> lock(window_mutex);
+    const auto target = ++window_flushes_requested;
+    window_cond.notify_all();
+    window_cond.wait(lock, [&] { return window_flushes_done >= target || window_closing; });
+}
+
+void WindowedStream::request_swap() {
+    {
+        lock_guard<mutex> lock(window_mutex);
+        swap_pending = true;
+    }
+    window_cond.notify_all();
+}
+
+float WindowedStream::backlog_seconds() {
+    lock_guard<mutex> lock(window_mutex);
+    return (float)(window_pending.size() + window_overflow.load()) / SAMPLE_FREQ;
+}
+
+json WindowedStream::to_json() {
+    lock_guard<mutex> lock(window_mutex);
+    return {{"intervalMs", runtime.get_config().get_stream_interval_ms()},
+            {"windowDecodes", window_stats.decodes},
+            {"windowTrims", window_stats.trims},
+            {"timeToFirstPartialMs", window_stats.first_partial_ms},
+            {"committedLatencyMs", latency_summary(window_stats.commit_latency_ms)}};
+}
+
+void WindowedStream::window_proc() {
+    ScopedAffinity affinity(runtime.compute_cpus());
+    const size_t interval_samples =
+        max<size_t>(1, (size_t)runtime.get_config().get_stream_interval_ms() * SAMPLE_FREQ / 1000);
+
+    unique_lock<mutex> lock(window_mutex);
+    while (true) {
+        window_cond.wait(lock, [&] {
+            return window_closing || window_flushes_done < window_flushes_requested ||
+                   window_pending.size() >= interval_samples || swap_pending;
+        });
+        if (window_closing) return;
+
+        if (swap_pending) {
+            swap_pending = false;
+            window_samples.insert(window_samples.end(), window_pending.begin(), window_pending.end());
+            window_pending.clear();
+            lock.unlock();
+            // the window is committed with the previous models, and starts over with the new ones
+            if (!runtime.stopped()) window_step(true);
+            runtime.apply_swap();
+            // the window's hypotheses are in the previous tokenizer's tokens
+            agreement = make_unique<LocalAgreement>(runtime.get_tokenizer()->specialTokens.timestampBeginToken);
+            lock.lock();
+            continue;
+        }
+
+        const bool flush = window_flushes_done < window_flushes_requested;
+        const float taken_seconds = (float)window_pending.size() / SAMPLE_FREQ;
+        window_samples.insert(window_samples.end(), window_pending.begin(), window_pending.end());
+        window_pending.clear();
+        lock.unlock();
+
+        // a stopped stream's audio is dropped, flushes still go through
+        auto before = chrono::steady_clock::now();
+        if (!runtime.stopped()) window_step(flush);
+        auto after = chrono::steady_clock::now();
+        runtime.record_progress(taken_seconds,
+                                chrono::duration_cast<chrono::microseconds>(after - before).count() / 1000.0);
+
+        lock.lock();
+        if (flush) {
+            window_samples.clear();
+            agreement->reset();
+            window_flushes_done++;
+            window_cond.notify_all();
+        }
+        // audio the window can't take before it commits, part of the backlog
+        const size_t chunk_samples = chunk_bytes / sizeof(float);
+        window_overflow = window_samples.size() > chunk_samples ? window_samples.size() - chunk_samples : 0;
+    }
+}
+
+void WindowedStream::window_step(bool final) {
+    const size_t chunk_samples = chunk_bytes / sizeof(float);
+    const size_t interval_samples = (size_t)runtime.get_config().get_stream_interval_ms() * SAMPLE_FREQ / 1000;
+    const auto tokenizer = runtime.get_tokenizer();
+    vector<float> input(chunk_samples);
+
+    // a final step runs until the whole window is committed, which takes several decodes past 30 s
+    while (window_samples.size() >= SAMPLE_FREQ / 10 && !runtime.stopped()) {
+        const size_t window_length = min(window_samples.size(), chunk_samples);
+        // the encoder sees 30 s, so a window that would outgrow them is committed as it is
+        const bool full = window_samples.size() + interval_samples > chunk_samples;
+
+        fill(copy(window_samples.begin(), window_samples.begin() + window_length, input.begin()), input.end(), 0.0f);
+        runtime.invoke_melspectro(reinterpret_cast<const char*>(input.data()));
+        auto [k_cache_cross, v_cache_cross] = runtime.encode();
+        if (runtime.stopped() || k_cache_cross.first == nullptr || v_cache_cross.first == nullptr) {
+            runtime.release_stage_memory(PipelineStage::Encoder);
+            return;
+        }
+        auto tokens = runtime.decode(k_cache_cross.first, v_cache_cross.first, window_start);
+        window_stats.decodes++;
+
+        // text & timestamps after the start of transcript, without the language and task tokens
+        vector<int> hypothesis;
+        for (size_t i = 1; i < tokens.size(); i++) {
+            auto token = tokens[i];
+            if (token == tokenizer->specialTokens.endOfTranscriptToken || token == -1) break;
+            if (token > tokenizer->specialTokens.endOfTranscriptToken && !agreement->is_timestamp(token)) continue;
+            hypothesis.push_back(token);
+        }
+
+        auto committed = agreement->update(hypothesis);
+        if (final || full) {
+            auto rest = agreement->commit_all();
+            committed.insert(committed.end(), rest.begin(), rest.end());
+        }
+
+        auto now = chrono::steady_clock::now();
+        if (!committed.empty()) {
+            // latency of the committed text: from the moment its last timestamp's audio was appended
+            int last_timestamp = -1;
+            for (auto token : committed) {
+                if (agreement->is_timestamp(token)) last_timestamp = token;
+            }
+            if (last_timestamp >= 0) {
+                const int steps = last_timestamp - tokenizer->specialTokens.timestampBeginToken;
+                float audio_time = window_start + steps * LocalAgreement::kSecondsPerTimestamp;
+                lock_guard<mutex> lock(window_mutex);
+                auto arrival = find_if(window_arrivals.begin(), window_arrivals.end(),
+                                       [&](auto& entry) { return entry.first >= audio_time; });
+                if (arrival != window_arrivals.end()) {
+                    window_stats.commit_latency_ms.push_back(
+                        chrono::duration_cast<chrono::microseconds>(now - arrival->second).count() / 1000.0);
+                }
+            }
+
+            runtime.publish_tokens(committed, window_start, false);
+        }
+
+        auto pending = agreement->pending();
+        if (!final && !pending.empty()) {
+            runtime.publish_tokens(pending, window_start, true);
+        }
+        if (window_stats.first_partial_ms < 0 && (!committed.empty() || !pending.empty())) {
+            lock_guard<mutex> lock(window_mutex);
+            window_stats.first_partial_ms =
+                chrono::duration_cast<chrono::microseconds>(now - window_stream_begin).count() / 1000.0;
+        }
+
+        // drop the audio in front of the last committed segment end, or all of it once everything is committed
+        size_t drop = 0;
+        auto segment_end = (final || full) ? -1 : agreement->last_committed_segment_end();
+        if (segment_end >= 0) {
+            drop = min(window_samples.size(), (size_t)(agreement->trim(segment_end) * SAMPLE_FREQ));
+        } else if (final || full) {
+            drop = window_length;
+            agreement->reset();
+        }
+        if (drop > 0) {
+            window_samples.erase(window_samples.begin(), window_samples.begin() + drop);
+            window_start += (float)drop / SAMPLE_FREQ;
+            window_stats.trims++;
+
+            lock_guard<mutex> lock(window_mutex);
+            while (!window_arrivals.empty() && window_arrivals.front().first < window_start) {
+                window_arrivals.pop_front();
+            }
+        }
+        if (!final) return;
+    }
+}
+
+}  // namespace WhisperKit::TranscribeTask
@@ -0,0 +1,84 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "LocalAgreement.hpp"
+#include "audio_input.hpp"
+#include "tflite_model.hpp"
+
+namespace WhisperKit::TranscribeTask {
+
+class Runtime;
+
+// low latency streaming: decodes of the window, and how far committed text lagged behind its audio
+struct WindowStats {
+    uint64_t decodes = 0;
+    uint64_t trims = 0;
+    float first_partial_ms = -1;
+    std::vector<float> commit_latency_ms;
+};
+
+/*
+    Low latency streaming: the window thread re-decodes the audio since the last committed
+    segment every stream interval, and commits the text two decodes agree on (LocalAgreement).
+
+    The stream owns the window thread, the audio of the window and the agreement between its
+    decodes. The models are its runtime's, which owns the stream; the window thread is the only
+    one running them while a stream is open, and applies model swaps between two decodes.
+*/
+class WindowedStream {
+   public:
+    // chunk_bytes: of the MelSpectrogram input, the longest window
+    WindowedStream(Runtime& runtime, int chunk_bytes);
+    ~WindowedStream();
+
+    // the thread is idle after the previous stream's flush; clears its window & stats
+    void begin_stream();
+    // moves the audio resampled by input into the window
+    void append(AudioInputModel& input);
+    // the last decode of the window commits whatever is left of it; returns once it did
+    void flush();
+    // the window is committed with the current models, and starts over with the standby's
+    void request_swap();
+    // audio waiting for the window thread, and beyond one encoder window, in seconds
+    float backlog_seconds();
+    json to_json();
+
+   private:
+    void window_proc();
+    void window_step(bool final);
+
+    Runtime& runtime;
+    int chunk_bytes;
+    std::thread window_thread;
+    // audio is appended to window_pending, and moved to the window by the window thread
+    std::mutex window_mutex;
+    std::condition_variable window_cond;
+    std::vector<float> window_pending;
+    std::deque<std::pair<float, std::chrono::steady_clock::time_point>> window_arrivals;  // stream time appended
+    std::chrono::steady_clock::time_point window_stream_begin;
+    uint64_t window_stream_samples = 0;
+    uint32_t window_flushes_requested = 0;
+    uint32_t window_flushes_done = 0;
+    bool window_closing = false;
+    bool swap_pending = false;
+    std::atomic<size_t> window_overflow = 0;  // samples of the window beyond one encoder window
+    // owned by the window thread while a stream is open
+    std::vector<float> window_samples;
+    float window_start = 0;  // stream time of window_samples[0], in seconds
+    std::unique_ptr<LocalAgreement> agreement;
+    WindowStats window_stats;
+};
+
+}  // namespace WhisperKit::TranscribeTask
@@ -0,0 +1,85 @@
+//  For licensing see accompanying LICENSE file.
+//  Copyright © 2024 Argmax, Inc. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace WhisperKit {
+
+/*
+    Commits the prefix that two consecutive hypotheses of a growing audio window agree on
+    (LocalAgreement-2).
+
+    Every hypothesis covers the window from its start, so it repeats what was committed
+    already; update() only returns the tokens committed on top of that. When the audio in
+    front of a segment end is dropped from the window, trim() shifts the kept tokens to
+    the window's new start, so the next hypothesis can be compared with them.
+*/
+class LocalAgreement {
+   public:
+    explicit LocalAgreement(int timestamp_begin_token) : _timestamp_begin(timestamp_begin_token) {}
+
+    void reset() {
+        _previous.clear();
+        _committed = 0;
+    }
+
+    // returns the tokens this hypothesis commits
+    std::vector<int> update(const std::vector<int>& hypothesis) {
+        size_t agreed = 0;
+        while (agreed < hypothesis.size() && agreed < _previous.size() && hypothesis[agreed] == _previous[agreed]) {
+            agreed++;
+        }
+
+        std::vector<int> committed;
+        if (agreed > _committed) {
+            committed.assign(hypothesis.begin() + _committed, hypothesis.begin() + agreed);
+            _committed = agreed;
+        }
+        _previous = hypothesis;
+        return committed;
+    }
+
+    // end of stream: there is no next hypothesis to wait for
+    std::vector<int> commit_all() {
+        std::vector<int> committed;
+        if (_previous.size() > _committed) committed.assign(_previous.begin() + _committed, _previous.end());
+        _committed = _previous.size();
+        return committed;
+    }
+
+    // index of the last committed timestamp token that closes a segment, -1 if none
+    int last_committed_segment_end() const {
+        for (int idx = (int)_committed - 1; idx > 0; idx--) {
+            if (is_timestamp(_previous[idx]) && !is_timestamp(_previous[idx - 1])) return idx;
+        }
+        return -1;
+    }
+
+    // drops the tokens up to and including the segment end at index; returns the end in seconds
+    float trim(int index) {
+        const int shift = _previous[index] - _timestamp_begin;
+        _previous.erase(_previous.begin(), _previous.begin() + index + 1);
+        for (auto& token : _previous) {
+            if (is_timestamp(token)) token = std::max(_timestamp_begin, token - shift);
+        }
+        _committed -= std::min(_committed, (size_t)index + 1);
+        return shift * kSecondsPerTimestamp;
+    }
+
+    // the last hypothesis beyond the committed tokens, which may still change
+    std::vector<int> pending() const { return {_previous.begin() + _committed, _previous.end()}; }
+
+    bool is_timestamp(int token) const { return token >= _timestamp_begin; }
+
+    static constexpr float kSecondsPerTimestamp = 0.02f;
+
+   private:
+    int _timestamp_begin;
+    std::vector<int> _previous;
+    size_t _committed = 0;
+};
+
+}  // namespace WhisperKit
@@ -10,13 +10,13 @@
 using namespace std;
 using json = nlohmann::json;
 
-PostProcModel::PostProcModel(Tokenizer* tokenizer, bool timestamp_text) : MODEL_SUPER_CLASS("post_proc") {
+PostProcModel::PostProcModel(Tokenizer* tokenizer, bool timestamp_text) : TFLiteModel("post_proc") {
     _timestamp_text = timestamp_text;
     _tokenizer = tokenizer;
 }
 
 bool PostProcModel::initialize(bool debug) {
-    if (!MODEL_SUPER_CLASS::initializeModelInMemory(WhisperKit::InMemoryModel::ModelType::kSimplePostProcessingModel,
+    if (!TFLiteModel::initializeModelInMemory(WhisperKit::InMemoryModel::ModelType::kSimplePostProcessingModel,
                                                     debug)) {
         LOGE("Failed to initialize\n");
         return false;
@@ -24,7 +24,7 @@ bool PostProcModel::initialize(bool debug) {
     return true;
 }
 
-void PostProcModel::invoke(bool measure_time) { MODEL_SUPER_CLASS::invoke(measure_time); }
+void PostProcModel::invoke(bool measure_time) { TFLiteModel::invoke(measure_time); }
 
 void PostProcModel::apply_timestamp_rules(float* logits, int logits_size, vector<int>& tokens) {
     logits[_tokenizer->specialTokens.noTimestampsToken] = -1e9;
@@ -101,6 +101,17 @@ int PostProcModel::process(int idx, float* logits, int logits_size, vector<int>&
     vector<float> v_logits(logits, &logits[logits_size]);
     auto max_elem = max_element(v_logits.begin(), v_logits.end());
 
+    // confidence: the greedy token's log probability is the larger of the two, for a timestamp token
+    // the probability mass of all timestamps; no speech is predicted right after the start of transcript
+    if (idx == 0) {
+        _sum_logprob = 0;
+        _num_logprobs = 0;
+        _no_speech_prob = exp(reinterpret_cast<float*>(outputs[2].first)[0]);
+    }
+    _last_logprob = max(timestamp_logprob, max_text_token_logprob);
+    _sum_logprob += _last_logprob;
+    _num_logprobs++;
+
     auto after_exec = chrono::high_resolution_clock::now();
     float interval_infs = chrono::duration_cast<std::chrono::microseconds>(after_exec - before_exec).count() / 1000.0;
     _latencies.push_back(interval_infs);
@@ -109,10 +120,37 @@ int PostProcModel::process(int idx, float* logits, int logits_size, vector<int>&
     return token;
 }
 
-void PostProcModel::decode_segment(const std::vector<int>& tokens) {
+static string format_timestamp(float seconds) {
+    string ts_str = to_string(DEC_2_ROUND(seconds));
+    ts_str.erase(ts_str.find_last_not_of('0') + 1, std::string::npos);
+    ts_str.erase(ts_str.find_last_not_of('.') + 1, std::string::npos);
+    return "<|" + ts_str + "|>";
+}
+
+void PostProcModel::decode_segment(const std::vector<int>& tokens, float base_timestamp,
+                                   const WhisperKit::TimestampMap* timestamp_map) {
     char* c_word = tokenizer_decode(_tokenizer, tokens.data(), tokens.size(), false);
-    _sentence += std::string(c_word);
+    string segment(c_word);
     tokenizer_free_rstring(c_word);
+
+    // Whisper timestamps are relative to the chunk, e.g. <|12.40|>; special tokens like <|en|> are kept as is
+    size_t start = 0;
+    while ((start = segment.find("<|", start)) != string::npos) {
+        auto end = segment.find("|>", start);
+        if (end == string::npos) break;
+
+        auto timestr = segment.substr(start + 2, end - start - 2);
+        if (timestr.empty() || timestr.find_first_not_of("0123456789.") != string::npos) {
+            start = end + 2;
+            continue;
+        }
+        auto window_time = stof(timestr);
+        auto ts_str = format_timestamp(timestamp_map ? WhisperKit::to_audio_time(*timestamp_map, window_time)
+                                                     : window_time + base_timestamp);
+        segment.replace(start, end + 2 - start, ts_str);
+        start += ts_str.size();
+    }
+    _sentence += segment;
 }
 
 void PostProcModel::proc_token(int token, float base_timestamp) {
@@ -155,6 +193,56 @@ void PostProcModel::proc_token(int token, float base_timestamp) {
     tokenizer_free_rstring(c_word);
 }
 
+// bytes of text over its LZ77 compressed size: greedy matches of 3+ bytes cost 3 bytes, literals 1.
+// An estimate of Whisper's gzip compression ratio, without the entropy coding
+static float compression_ratio(const string& text) {
+    constexpr const size_t kMinMatch = 3;
+    size_t compressed = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t longest = 0;
+        for (size_t start = 0; start < pos; start++) {
+            size_t length = 0;
+            while (pos + length < text.size() && text[start + length] == text[pos + length]) length++;
+            longest = max(longest, length);
+        }
+        compressed += longest >= kMinMatch ? kMinMatch : 1;
+        pos += longest >= kMinMatch ? longest : 1;
+    }
+    return compressed > 0 ? (float)text.size() / compressed : 0;
+}
+
+DecodingConfidence PostProcModel::get_confidence(const vector<int>& tokens) {
+    auto confidence = get_logprobs();
+
+    vector<int> text_tokens;
+    for (auto token : tokens) {
+        if (token < _tokenizer->specialTokens.endOfTranscriptToken) text_tokens.push_back(token);
+    }
+    if (!text_tokens.empty()) {
+        char* c_text = tokenizer_decode(_tokenizer, text_tokens.data(), text_tokens.size(), true);
+        confidence.compression_ratio = compression_ratio(c_text);
+        tokenizer_free_rstring(c_text);
+    }
+    return confidence;
+}
+
+void PostProcModel::save_state(PostProcState& state) {
+    state.sentence = std::move(_sentence);
+    _sentence.clear();
+    state.sum_logprob = _sum_logprob;
+    state.num_logprobs = _num_logprobs;
+    state.no_speech_prob = _no_speech_prob;
+    state.last_logprob = _last_logprob;
+}
+
+void PostProcModel::restore_state(const PostProcState& state) {
+    _sentence = state.sentence;
+    _sum_logprob = state.sum_logprob;
+    _num_logprobs = state.num_logprobs;
+    _no_speech_prob = state.no_speech_prob;
+    _last_logprob = state.last_logprob;
+}
+
 unique_ptr<string> PostProcModel::get_sentence(bool bClear) {
     auto out = make_unique<string>(_sentence);
     if (bClear) _sentence.clear();
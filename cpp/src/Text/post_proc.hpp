@@ -4,14 +4,32 @@
 
 #include <cmath>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "TimestampMap.hpp"
 #include "Tokenizer.h"
-#include "backend_class.hpp"
+#include "tflite_model.hpp"
 
 constexpr const uint32_t SAMPLE_BEGIN = 1;
 
-class PostProcModel : public MODEL_SUPER_CLASS {
+// how sure the decoder was of a chunk's tokens, from the post processing model's log probabilities
+struct DecodingConfidence {
+    float avg_logprob = 0;
+    float no_speech_prob = 0;
+    float compression_ratio = 0;  // of the text, high for repetition loops
+};
+
+// post processing of one sequence, parked with its decoder state while another chunk is decoded
+struct PostProcState {
+    std::string sentence;
+    float sum_logprob = 0;
+    int num_logprobs = 0;
+    float no_speech_prob = 0;
+    float last_logprob = 0;
+};
+
+class PostProcModel : public TFLiteModel {
    public:
     PostProcModel(Tokenizer* tokenizer, bool timestamp_text = false);
     virtual ~PostProcModel(){};
@@ -22,12 +40,32 @@ class PostProcModel : public MODEL_SUPER_CLASS {
     int process(int idx, float* logits, int logits_size, std::vector<int>& decoded_tokens, float base_timestamp);
 
     std::unique_ptr<std::string> get_sentence(bool clear = true);
-    void decode_segment(const std::vector<int>& tokens);
+    // of the tokens passed to process() since its last idx == 0
+    DecodingConfidence get_confidence(const std::vector<int>& tokens);
+    // of the token returned by the last process()
+    float get_last_logprob() const { return _last_logprob; }
+    // get_confidence() without the compression ratio, which needs the text decoded
+    DecodingConfidence get_logprobs() const {
+        return {_num_logprobs > 0 ? _sum_logprob / _num_logprobs : 0, _no_speech_prob, 0};
+    }
+    // the confidence of the sequence being decoded; the sentence moves into state, so that the other
+    // chunk starts with an empty one
+    void save_state(PostProcState& state);
+    // the next process() continues the saved sequence, whatever was processed in between
+    void restore_state(const PostProcState& state);
+    // timestamp tokens are offset by base_timestamp, the chunk's start in the audio,
+    // or mapped back to the audio with timestamp_map for chunks packed from several regions
+    void decode_segment(const std::vector<int>& tokens, float base_timestamp = 0,
+                        const WhisperKit::TimestampMap* timestamp_map = nullptr);
 
    private:
     Tokenizer* _tokenizer;
     bool _timestamp_text;
     std::string _sentence;
+    float _sum_logprob = 0;
+    int _num_logprobs = 0;
+    float _no_speech_prob = 0;
+    float _last_logprob = 0;
 
     void apply_timestamp_rules(float* logits, int logits_size, std::vector<int>& tokens);
     void proc_token(int token, float base_timestamp);
@@ -2,9 +2,12 @@
 
 #include <unistd.h>
 
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "WhisperKitConfiguration.hpp"
 #include "WhisperKitTranscriptionResult.hpp"
@@ -12,7 +15,10 @@
 
 namespace WhisperKit::TranscribeTask {
 class AudioCodec;
+class BatchScheduler;
 class Runtime;
+class SessionEngine;
+struct Session;
 }  // namespace WhisperKit::TranscribeTask
 
 struct TranscribeTask {
@@ -23,21 +29,58 @@ struct TranscribeTask {
 
     // audio file transcription
     void transcribe(const char* audio_file, whisperkit_transcription_result_t* transcription_result);
+    // audio in memory: encoded, or raw PCM as described by format
+    void transcribeBuffer(const char* data, size_t size, const whisperkit_audio_format_t* format,
+                          whisperkit_transcription_result_t* transcription_result);
+    // many audio files, chunks scheduled across runtime replicas; returns the number of files that failed
+    int transcribeBatch(const std::vector<std::string>& audio_files,
+                        const std::vector<whisperkit_transcription_result_t*>& results);
+    // stops the request in flight with reason (CANCELLED or DEADLINE_EXCEEDED), keeping its partial results
+    void cancel(whisperkit_status_t reason);
+    whisperkit_status_t stopStatus() const;
+    void setSegmentCallback(whisperkit_segment_callback_t callback, void* user_data);
+    void setTokenCallback(whisperkit_token_callback_t callback, void* user_data);
+    void setOverloadCallback(whisperkit_overload_callback_t callback, void* user_data);
+    // transcription time over audio time of the current stream's last chunks
+    float realTimeFactor() const;
     // audio stream mode: init, append, close
     void initStreaming(whisperkit_transcription_result_t* transcription_result, int sample_rate = 0,
                        int num_channels = 0);
     bool appendAudio(int size, char* buffer0, char* buffer1 = nullptr);
     void closeStreaming();
+    // multi-session engine: concurrent streams sharing this task's runtimes
+    std::shared_ptr<WhisperKit::TranscribeTask::Session> openSession(int sample_rate, int num_channels,
+                                                                     whisperkit_segment_callback_t callback,
+                                                                     void* user_data);
+    void appendSession(WhisperKit::TranscribeTask::Session& session, int size, char* buffer0, char* buffer1 = nullptr);
+    void closeSession(const std::shared_ptr<WhisperKit::TranscribeTask::Session>& session,
+                      whisperkit_transcription_result_t* transcription_result);
+    // model swap: loads model_path next to the current models, on a background thread
+    void preloadModel(const char* model_path);
+    // waits for the preload, then switches at the next chunk boundary; false without a preload or while one is pending
+    bool swapModel();
 
     TranscribeTask(const whisperkit_configuration_t& config);
     ~TranscribeTask();
 
    private:
     void textOutputProc();
+    // decodes the audio opened by audio_codec, and transcribes it
+    void transcribeCodec(const char* audio_name);
     int chunk_idx;
     whisperkit_configuration_t config;
     std::unique_ptr<nlohmann::json> argsjson;
     std::unique_ptr<std::thread> text_out_thread;
     std::unique_ptr<WhisperKit::TranscribeTask::AudioCodec> audio_codec;
+    // cascade: the larger model, escalated to by the runtimes below, which it outlives
+    std::unique_ptr<WhisperKit::TranscribeTask::Runtime> cascade_runtime;
     std::unique_ptr<WhisperKit::TranscribeTask::Runtime> runtime;
+    // owns the batch & session replicas
+    std::unique_ptr<WhisperKit::TranscribeTask::BatchScheduler> batch_scheduler;
+    // created on the first session, on the scheduler's replicas, which it is destroyed before
+    std::unique_ptr<WhisperKit::TranscribeTask::SessionEngine> session_engine;
+    std::mutex session_engine_mutex;
+    std::unique_ptr<WhisperKit::TranscribeTask::Runtime> standby_runtime;
+    std::thread preload_thread;
+    std::exception_ptr preload_error;
 };
@@ -112,6 +112,56 @@ whisperkit_status_t whisperkit_configuration_set_load(whisperkit_configuration_t
     return WHISPERKIT_STATUS_SUCCESS;
 };
 
+whisperkit_status_t whisperkit_configuration_set_autotune(whisperkit_configuration_t *config, bool autotune) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_autotune(autotune);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_low_memory(whisperkit_configuration_t *config, bool low_memory) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_low_memory(low_memory);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_benchmark_decoder_state(whisperkit_configuration_t *config,
+                                                                         bool benchmark_decoder_state) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_benchmark_decoder_state(benchmark_decoder_state);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_staged(whisperkit_configuration_t *config, bool staged) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_staged(staged);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_vad_packing(whisperkit_configuration_t *config, bool vad_packing) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_vad_packing(vad_packing);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_parallel_chunks(whisperkit_configuration_t *config,
+                                                                 bool parallel_chunks) {
+    if (config == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_parallel_chunks(parallel_chunks);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
 whisperkit_status_t whisperkit_configuration_set_model_path(whisperkit_configuration_t *config,
                                                             const char *model_path) {
     if (config == nullptr || model_path == nullptr) {
@@ -140,6 +190,84 @@ whisperkit_status_t whisperkit_configuration_set_backends(whisperkit_configurati
     return WHISPERKIT_STATUS_SUCCESS;
 };
 
+whisperkit_status_t whisperkit_configuration_set_thread_policy(whisperkit_configuration_t *config,
+                                                               whisperkit_thread_policy_t policy) {
+    if (config == nullptr ||
+        (policy != WHISPERKIT_THREAD_POLICY_DEFAULT && policy != WHISPERKIT_THREAD_POLICY_TOPOLOGY)) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_thread_policy(policy);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_stage_threads(whisperkit_configuration_t *config,
+                                                               whisperkit_stage_t stage, int num_threads) {
+    // the audio stage is a single thread, only its cpu set comes from the thread policy
+    if (config == nullptr || stage <= WHISPERKIT_STAGE_AUDIO || stage > WHISPERKIT_STAGE_DECODER || num_threads < 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_stage_threads(stage, num_threads);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_concurrent_workers(whisperkit_configuration_t *config,
+                                                                    int concurrent_workers) {
+    if (config == nullptr || concurrent_workers <= 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_concurrent_workers(concurrent_workers);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_deadline_ms(whisperkit_configuration_t *config, int deadline_ms) {
+    if (config == nullptr || deadline_ms < 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_deadline_ms(deadline_ms);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_stream_interval_ms(whisperkit_configuration_t *config,
+                                                                    int stream_interval_ms) {
+    if (config == nullptr || stream_interval_ms < 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_stream_interval_ms(stream_interval_ms);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_endpoint_hangover_ms(whisperkit_configuration_t *config,
+                                                                      int endpoint_hangover_ms) {
+    if (config == nullptr || endpoint_hangover_ms < 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_endpoint_hangover_ms(endpoint_hangover_ms);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_overload_policy(whisperkit_configuration_t *config,
+                                                                 whisperkit_overload_policy_t policy,
+                                                                 int max_backlog_ms) {
+    if (config == nullptr || policy < WHISPERKIT_OVERLOAD_POLICY_BLOCK ||
+        policy > WHISPERKIT_OVERLOAD_POLICY_REDUCE_DECODING || max_backlog_ms < 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_overload_policy(policy, max_backlog_ms);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_configuration_set_cascade(whisperkit_configuration_t *config,
+                                                         const char *cascade_model_path, float logprob_threshold,
+                                                         float compression_ratio_threshold,
+                                                         float no_speech_threshold) {
+    if (config == nullptr || cascade_model_path == nullptr || compression_ratio_threshold <= 0 ||
+        no_speech_threshold < 0 || no_speech_threshold > 1) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    config->set_cascade(cascade_model_path, logprob_threshold, compression_ratio_threshold, no_speech_threshold);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
 #pragma mark - pipeline state
 whisperkit_status_t whisperkit_pipeline_get_status(whisperkit_pipeline_t *pipeline,
                                                    whisperkit_pipeline_status_t *status) {
@@ -197,6 +325,175 @@ whisperkit_status_t whisperkit_pipeline_transcribe(whisperkit_pipeline_t *pipeli
     } catch (const std::exception &e) {
         return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
     }
+    return pipeline->get_stop_status();
+};
+
+whisperkit_status_t whisperkit_pipeline_transcribe_buffer(whisperkit_pipeline_t *pipeline, const void *data,
+                                                          size_t size, const whisperkit_audio_format_t *format,
+                                                          whisperkit_transcription_result_t *transcription_result) {
+    if (pipeline == nullptr || data == nullptr || size == 0 || transcription_result == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    if (format != nullptr && format->sample_format != WHISPERKIT_SAMPLE_FORMAT_ENCODED) {
+        if (format->sample_format != WHISPERKIT_SAMPLE_FORMAT_S16 &&
+            format->sample_format != WHISPERKIT_SAMPLE_FORMAT_FLOAT) {
+            return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+        }
+        if (format->sample_rate <= 0 || format->num_channels < 1 || format->num_channels > 2) {
+            return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    try {
+        pipeline->transcribe_buffer(static_cast<const char *>(data), size, format, transcription_result);
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    return pipeline->get_stop_status();
+};
+
+whisperkit_status_t whisperkit_pipeline_transcribe_batch(whisperkit_pipeline_t *pipeline, const char **audio_files,
+                                                         int num_files,
+                                                         whisperkit_transcription_result_t **transcription_results) {
+    if (pipeline == nullptr || audio_files == nullptr || transcription_results == nullptr || num_files <= 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+    for (int i = 0; i < num_files; i++) {
+        if (audio_files[i] == nullptr || transcription_results[i] == nullptr) {
+            return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    int num_failed = 0;
+    try {
+        num_failed = pipeline->transcribe_batch(std::vector<std::string>(audio_files, audio_files + num_files),
+                                                std::vector<whisperkit_transcription_result_t *>(
+                                                    transcription_results, transcription_results + num_files));
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    auto stop_status = pipeline->get_stop_status();
+    if (stop_status == WHISPERKIT_STATUS_SUCCESS && num_failed > 0) {
+        return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    return stop_status;
+};
+
+whisperkit_status_t whisperkit_pipeline_cancel(whisperkit_pipeline_t *pipeline) {
+    if (pipeline == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    auto state = pipeline->get_state();
+    if (state != WHISPERKIT_PIPELINE_STATUS_BUILT && state != WHISPERKIT_PIPELINE_STATUS_AUDIOINIT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    pipeline->cancel();
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_set_segment_callback(whisperkit_pipeline_t *pipeline,
+                                                             whisperkit_segment_callback_t callback, void *user_data) {
+    if (pipeline == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    pipeline->set_segment_callback(callback, user_data);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_set_token_callback(whisperkit_pipeline_t *pipeline,
+                                                           whisperkit_token_callback_t callback, void *user_data) {
+    if (pipeline == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    pipeline->set_token_callback(callback, user_data);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_set_overload_callback(whisperkit_pipeline_t *pipeline,
+                                                              whisperkit_overload_callback_t callback,
+                                                              void *user_data) {
+    if (pipeline == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    pipeline->set_overload_callback(callback, user_data);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_get_real_time_factor(whisperkit_pipeline_t *pipeline,
+                                                             float *real_time_factor) {
+    if (pipeline == nullptr || real_time_factor == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT &&
+        pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_AUDIOINIT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    *real_time_factor = pipeline->get_real_time_factor();
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_preload_model(whisperkit_pipeline_t *pipeline, const char *model_path) {
+    if (pipeline == nullptr || model_path == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT &&
+        pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_AUDIOINIT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    try {
+        pipeline->preload_model(model_path);
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_GENERIC;
+    }
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_pipeline_swap_model(whisperkit_pipeline_t *pipeline) {
+    if (pipeline == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT &&
+        pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_AUDIOINIT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    try {
+        if (!pipeline->swap_model()) {
+            return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+        }
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_MODEL_UNAVAILABLE;
+    }
     return WHISPERKIT_STATUS_SUCCESS;
 };
 
@@ -240,6 +537,55 @@ whisperkit_status_t whisperkit_pipeline_appendaudio(whisperkit_pipeline_t *pipel
     return WHISPERKIT_STATUS_SUCCESS;
 }
 
+whisperkit_status_t whisperkit_pipeline_open_session(whisperkit_pipeline_t *pipeline, int sample_rate,
+                                                     int num_channels, whisperkit_segment_callback_t callback,
+                                                     void *user_data, whisperkit_session_t **session) {
+    if (pipeline == nullptr || session == nullptr || sample_rate <= 0 || num_channels <= 0) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pipeline->get_state() != WHISPERKIT_PIPELINE_STATUS_BUILT) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_STATE;
+    }
+
+    try {
+        *session = pipeline->open_session(sample_rate, num_channels, callback, user_data).release();
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_session_appendaudio(whisperkit_session_t *session, int size, char *buffer) {
+    if (session == nullptr || size <= 0 || buffer == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        session->pipeline->append_session(session, size, buffer);
+    } catch (const std::exception &e) {
+        return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_session_close(whisperkit_session_t **session,
+                                             whisperkit_transcription_result_t *transcription_result) {
+    if (session == nullptr || *session == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    auto status = WHISPERKIT_STATUS_SUCCESS;
+    try {
+        (*session)->pipeline->close_session(*session, transcription_result);
+    } catch (const std::exception &e) {
+        status = WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
+    }
+    delete *session;
+    *session = nullptr;
+    return status;
+};
+
 whisperkit_status_t whisperkit_pipeline_closestreaming(whisperkit_pipeline_t *pipeline) {
     if (pipeline == nullptr) {
         return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
@@ -254,7 +600,7 @@ whisperkit_status_t whisperkit_pipeline_closestreaming(whisperkit_pipeline_t *pi
     } catch (const std::exception &e) {
         return WHISPERKIT_STATUS_ERROR_TRANSCRIPTION_FAILED;
     }
-    return WHISPERKIT_STATUS_SUCCESS;
+    return pipeline->get_stop_status();
 }
 
 whisperkit_status_t whisperkit_transcription_result_get_all_transcription(
@@ -287,6 +633,37 @@ whisperkit_status_t whisperkit_transcription_result_get_transcription(
     return WHISPERKIT_STATUS_SUCCESS;
 };
 
+whisperkit_status_t whisperkit_transcription_result_view_all_transcription(
+    whisperkit_transcription_result_t *transcription_result, const char **transcription) {
+    if (transcription_result == nullptr || transcription == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    *transcription = transcription_result->view_transcription();
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_transcription_result_get_segment_count(
+    whisperkit_transcription_result_t *transcription_result, int *count) {
+    if (transcription_result == nullptr || count == nullptr) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    *count = transcription_result->get_segment_count();
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
+whisperkit_status_t whisperkit_transcription_result_get_segment(
+    whisperkit_transcription_result_t *transcription_result, int index, const whisperkit_result_segment_t **segment) {
+    if (transcription_result == nullptr || segment == nullptr || index < 0 ||
+        index >= transcription_result->get_segment_count()) {
+        return WHISPERKIT_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    *segment = transcription_result->get_segment(index);
+    return WHISPERKIT_STATUS_SUCCESS;
+};
+
 #pragma mark - teardown
 whisperkit_status_t whisperkit_configuration_destroy(whisperkit_configuration_t **config) {
     if (config == nullptr) {
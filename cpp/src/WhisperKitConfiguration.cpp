@@ -4,7 +4,38 @@
 #include "WhisperKitPipeline.hpp"
 #include "backend_class.hpp"
 
-whisperkit_configuration_t::whisperkit_configuration_t(){};
+whisperkit_configuration_t::whisperkit_configuration_t() {
+    verbose = false;
+    log_level = 0;
+    prewarm = false;
+    load = true;
+    parallel_chunks = false;
+    vad_packing = false;
+    staged = false;
+    low_memory = false;
+    benchmark_decoder_state = false;
+    autotune = false;
+    // the build's preferred delegate, falling back to the CPU at runtime
+#if QNN_DELEGATE
+    encoder_backend = decoder_backend = ComputeBackend::NPU;
+#elif GPU_DELEGATE
+    encoder_backend = decoder_backend = ComputeBackend::GPU;
+#else
+    encoder_backend = decoder_backend = ComputeBackend::CPU;
+#endif
+    backends_set = false;
+    thread_policy = WHISPERKIT_THREAD_POLICY_DEFAULT;
+    stage_threads.fill(0);
+    concurrent_workers = 1;
+    deadline_ms = 0;
+    stream_interval_ms = 0;
+    endpoint_hangover_ms = 0;
+    overload_policy = WHISPERKIT_OVERLOAD_POLICY_BLOCK;
+    max_backlog_ms = 0;
+    cascade_logprob_threshold = -1.0f;
+    cascade_compression_ratio_threshold = 2.4f;
+    cascade_no_speech_threshold = 0.6f;
+};
 
 void whisperkit_configuration_t::set_audio_encoder(const char* audio_encoder) noexcept {
     this->audio_encoder = audio_encoder;
@@ -32,6 +63,8 @@ void whisperkit_configuration_t::set_backends(whisperkit_backend_t encoder_backe
         this->encoder_backend = ComputeBackend::GPU;
     } else if (encoder_backend == WHISPERKIT_COMPUTE_BACKEND_NPU) {
         this->encoder_backend = ComputeBackend::NPU;
+    } else if (encoder_backend == WHISPERKIT_COMPUTE_BACKEND_CPU_BUILTIN) {
+        this->encoder_backend = ComputeBackend::CPUBuiltin;
     } else {
         this->encoder_backend = ComputeBackend::GPU;
     }
@@ -42,9 +75,45 @@ void whisperkit_configuration_t::set_backends(whisperkit_backend_t encoder_backe
         this->decoder_backend = ComputeBackend::GPU;
     } else if (decoder_backend == WHISPERKIT_COMPUTE_BACKEND_NPU) {
         this->decoder_backend = ComputeBackend::NPU;
+    } else if (decoder_backend == WHISPERKIT_COMPUTE_BACKEND_CPU_BUILTIN) {
+        this->decoder_backend = ComputeBackend::CPUBuiltin;
     } else {
         this->decoder_backend = ComputeBackend::GPU;
     }
+    backends_set = true;
+}
+
+void whisperkit_configuration_t::set_thread_policy(whisperkit_thread_policy_t thread_policy) noexcept {
+    this->thread_policy = thread_policy;
+}
+
+void whisperkit_configuration_t::set_stage_threads(whisperkit_stage_t stage, int num_threads) noexcept {
+    this->stage_threads[stage] = num_threads;
+}
+
+void whisperkit_configuration_t::set_concurrent_workers(int concurrent_workers) noexcept {
+    this->concurrent_workers = concurrent_workers;
+}
+
+void whisperkit_configuration_t::set_deadline_ms(int deadline_ms) noexcept { this->deadline_ms = deadline_ms; }
+void whisperkit_configuration_t::set_stream_interval_ms(int stream_interval_ms) noexcept {
+    this->stream_interval_ms = stream_interval_ms;
+}
+void whisperkit_configuration_t::set_endpoint_hangover_ms(int endpoint_hangover_ms) noexcept {
+    this->endpoint_hangover_ms = endpoint_hangover_ms;
+}
+void whisperkit_configuration_t::set_overload_policy(whisperkit_overload_policy_t overload_policy,
+                                                     int max_backlog_ms) noexcept {
+    this->overload_policy = overload_policy;
+    this->max_backlog_ms = max_backlog_ms;
+}
+
+void whisperkit_configuration_t::set_cascade(const char* cascade_model_path, float logprob_threshold,
+                                             float compression_ratio_threshold, float no_speech_threshold) noexcept {
+    this->cascade_model_path = cascade_model_path;
+    this->cascade_logprob_threshold = logprob_threshold;
+    this->cascade_compression_ratio_threshold = compression_ratio_threshold;
+    this->cascade_no_speech_threshold = no_speech_threshold;
 }
 
 void whisperkit_configuration_t::set_lib_dir(const char* lib_dir) noexcept { this->lib_dir = lib_dir; }
@@ -59,6 +128,22 @@ void whisperkit_configuration_t::set_prewarm(bool prewarm) noexcept { this->prew
 
 void whisperkit_configuration_t::set_load(bool load) noexcept { this->load = load; }
 
+void whisperkit_configuration_t::set_autotune(bool autotune) noexcept { this->autotune = autotune; }
+
+void whisperkit_configuration_t::set_low_memory(bool low_memory) noexcept { this->low_memory = low_memory; }
+
+void whisperkit_configuration_t::set_benchmark_decoder_state(bool benchmark_decoder_state) noexcept {
+    this->benchmark_decoder_state = benchmark_decoder_state;
+}
+
+void whisperkit_configuration_t::set_staged(bool staged) noexcept { this->staged = staged; }
+
+void whisperkit_configuration_t::set_vad_packing(bool vad_packing) noexcept { this->vad_packing = vad_packing; }
+
+void whisperkit_configuration_t::set_parallel_chunks(bool parallel_chunks) noexcept {
+    this->parallel_chunks = parallel_chunks;
+}
+
 const std::string whisperkit_configuration_t::get_audio_encoder() const noexcept { return this->audio_encoder; }
 const std::string whisperkit_configuration_t::get_text_decoder() const noexcept { return this->text_decoder; }
 const std::string whisperkit_configuration_t::get_tokenizer() const noexcept { return this->tokenizer; }
@@ -82,8 +167,52 @@ bool whisperkit_configuration_t::get_prewarm() const noexcept { return this->pre
 
 bool whisperkit_configuration_t::get_load() const noexcept { return this->load; }
 
+bool whisperkit_configuration_t::get_autotune() const noexcept { return this->autotune; }
+
+bool whisperkit_configuration_t::get_low_memory() const noexcept { return this->low_memory; }
+
+bool whisperkit_configuration_t::get_benchmark_decoder_state() const noexcept { return this->benchmark_decoder_state; }
+
+bool whisperkit_configuration_t::get_staged() const noexcept { return this->staged; }
+
+bool whisperkit_configuration_t::get_vad_packing() const noexcept { return this->vad_packing; }
+
+bool whisperkit_configuration_t::get_parallel_chunks() const noexcept { return this->parallel_chunks; }
+
 int whisperkit_configuration_t::get_encoder_backend() const noexcept { return this->encoder_backend; }
 
 int whisperkit_configuration_t::get_decoder_backend() const noexcept { return this->decoder_backend; }
 
+bool whisperkit_configuration_t::get_backends_set() const noexcept { return this->backends_set; }
+
 whisperkit_pipeline_t* whisperkit_configuration_t::get_pipeline() const noexcept { return this->pipeline; }
+
+whisperkit_thread_policy_t whisperkit_configuration_t::get_thread_policy() const noexcept {
+    return this->thread_policy;
+}
+
+const std::array<int, 4>& whisperkit_configuration_t::get_stage_threads() const noexcept {
+    return this->stage_threads;
+}
+
+int whisperkit_configuration_t::get_concurrent_workers() const noexcept { return this->concurrent_workers; }
+
+int whisperkit_configuration_t::get_deadline_ms() const noexcept { return this->deadline_ms; }
+int whisperkit_configuration_t::get_stream_interval_ms() const noexcept { return this->stream_interval_ms; }
+int whisperkit_configuration_t::get_endpoint_hangover_ms() const noexcept { return this->endpoint_hangover_ms; }
+whisperkit_overload_policy_t whisperkit_configuration_t::get_overload_policy() const noexcept {
+    return this->overload_policy;
+}
+int whisperkit_configuration_t::get_max_backlog_ms() const noexcept { return this->max_backlog_ms; }
+const std::string whisperkit_configuration_t::get_cascade_model_path() const noexcept {
+    return this->cascade_model_path;
+}
+float whisperkit_configuration_t::get_cascade_logprob_threshold() const noexcept {
+    return this->cascade_logprob_threshold;
+}
+float whisperkit_configuration_t::get_cascade_compression_ratio_threshold() const noexcept {
+    return this->cascade_compression_ratio_threshold;
+}
+float whisperkit_configuration_t::get_cascade_no_speech_threshold() const noexcept {
+    return this->cascade_no_speech_threshold;
+}
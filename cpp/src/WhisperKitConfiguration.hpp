@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string>
 
 #include "WhisperKit.h"
@@ -18,9 +19,24 @@ struct whisperkit_configuration_t {
     void set_log_level(int log_level) noexcept;
     void set_prewarm(bool prewarm) noexcept;
     void set_load(bool load) noexcept;
+    void set_autotune(bool autotune) noexcept;
+    void set_low_memory(bool low_memory) noexcept;
+    void set_benchmark_decoder_state(bool benchmark_decoder_state) noexcept;
+    void set_staged(bool staged) noexcept;
+    void set_vad_packing(bool vad_packing) noexcept;
+    void set_parallel_chunks(bool parallel_chunks) noexcept;
     void set_model_path(const char* model_path) noexcept;
     void set_report_path(const char* report_path) noexcept;
     void set_backends(whisperkit_backend_t encoder_backend, whisperkit_backend_t decoder_backend) noexcept;
+    void set_thread_policy(whisperkit_thread_policy_t thread_policy) noexcept;
+    void set_stage_threads(whisperkit_stage_t stage, int num_threads) noexcept;
+    void set_concurrent_workers(int concurrent_workers) noexcept;
+    void set_deadline_ms(int deadline_ms) noexcept;
+    void set_stream_interval_ms(int stream_interval_ms) noexcept;
+    void set_endpoint_hangover_ms(int endpoint_hangover_ms) noexcept;
+    void set_overload_policy(whisperkit_overload_policy_t overload_policy, int max_backlog_ms) noexcept;
+    void set_cascade(const char* cascade_model_path, float logprob_threshold, float compression_ratio_threshold,
+                     float no_speech_threshold) noexcept;
 
     const std::string get_audio_encoder() const noexcept;
     const std::string get_text_decoder() const noexcept;
@@ -32,10 +48,30 @@ struct whisperkit_configuration_t {
     const std::string get_report_path() const noexcept;
     int get_encoder_backend() const noexcept;
     int get_decoder_backend() const noexcept;
+    // set_backends() was called; otherwise a tuning profile may pick the backends
+    bool get_backends_set() const noexcept;
     bool get_verbose() const noexcept;
     int get_log_level() const noexcept;
     bool get_prewarm() const noexcept;
     bool get_load() const noexcept;
+    bool get_autotune() const noexcept;
+    bool get_low_memory() const noexcept;
+    bool get_benchmark_decoder_state() const noexcept;
+    bool get_staged() const noexcept;
+    bool get_vad_packing() const noexcept;
+    bool get_parallel_chunks() const noexcept;
+    whisperkit_thread_policy_t get_thread_policy() const noexcept;
+    const std::array<int, 4>& get_stage_threads() const noexcept;
+    int get_concurrent_workers() const noexcept;
+    int get_deadline_ms() const noexcept;
+    int get_stream_interval_ms() const noexcept;
+    int get_endpoint_hangover_ms() const noexcept;
+    whisperkit_overload_policy_t get_overload_policy() const noexcept;
+    int get_max_backlog_ms() const noexcept;
+    const std::string get_cascade_model_path() const noexcept;
+    float get_cascade_logprob_threshold() const noexcept;
+    float get_cascade_compression_ratio_threshold() const noexcept;
+    float get_cascade_no_speech_threshold() const noexcept;
 
     whisperkit_pipeline_t* get_pipeline() const noexcept;
 
@@ -45,15 +81,36 @@ struct whisperkit_configuration_t {
     std::string tokenizer;
     std::string melspectrogram_model;
     std::string model_path;
+    std::string cascade_model_path;  // larger model that redoes low confidence chunks, empty = no cascade
     std::string report_path;
     std::string lib_dir;
     std::string cache_dir;
     whisperkit_pipeline_t* pipeline;
     int encoder_backend;
     int decoder_backend;
+    bool backends_set;
 
     bool verbose;
     int log_level;
     bool prewarm;
     bool load;
+    bool autotune;
+    bool low_memory;
+    bool benchmark_decoder_state;
+    bool staged;
+    bool vad_packing;
+    bool parallel_chunks;
+    whisperkit_thread_policy_t thread_policy;
+    std::array<int, 4> stage_threads;  // indexed by whisperkit_stage_t, 0 = policy default
+    int concurrent_workers;            // runtime replicas for batch transcription
+    int deadline_ms;                   // per request, 0 = none
+    int stream_interval_ms;            // sliding window re-decode interval when streaming, 0 = 30 s chunks
+    int endpoint_hangover_ms;          // silence after speech that ends an utterance when streaming, 0 = off
+    whisperkit_overload_policy_t overload_policy;
+    int max_backlog_ms;  // streaming audio queued behind transcription before the overload policy applies, 0 = off
+    // a chunk is escalated to the cascade model below the average logprob (unless likely silence),
+    // or above the compression ratio
+    float cascade_logprob_threshold;
+    float cascade_compression_ratio_threshold;
+    float cascade_no_speech_threshold;
 };
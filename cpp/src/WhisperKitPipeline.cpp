@@ -23,6 +23,38 @@ void whisperkit_pipeline_t::transcribe(const char* audio_file,
     transcribe_task->transcribe(audio_file, transcription_result);
 }
 
+void whisperkit_pipeline_t::transcribe_buffer(const char* data, size_t size, const whisperkit_audio_format_t* format,
+                                              whisperkit_transcription_result_t* transcription_result) {
+    transcribe_task->transcribeBuffer(data, size, format, transcription_result);
+}
+
+int whisperkit_pipeline_t::transcribe_batch(const std::vector<std::string>& audio_files,
+                                            const std::vector<whisperkit_transcription_result_t*>& results) {
+    return transcribe_task->transcribeBatch(audio_files, results);
+}
+
+void whisperkit_pipeline_t::cancel() { transcribe_task->cancel(WHISPERKIT_STATUS_CANCELLED); }
+
+whisperkit_status_t whisperkit_pipeline_t::get_stop_status() const { return transcribe_task->stopStatus(); }
+
+void whisperkit_pipeline_t::set_segment_callback(whisperkit_segment_callback_t callback, void* user_data) {
+    transcribe_task->setSegmentCallback(callback, user_data);
+}
+
+void whisperkit_pipeline_t::set_token_callback(whisperkit_token_callback_t callback, void* user_data) {
+    transcribe_task->setTokenCallback(callback, user_data);
+}
+
+void whisperkit_pipeline_t::set_overload_callback(whisperkit_overload_callback_t callback, void* user_data) {
+    transcribe_task->setOverloadCallback(callback, user_data);
+}
+
+float whisperkit_pipeline_t::get_real_time_factor() const { return transcribe_task->realTimeFactor(); }
+
+void whisperkit_pipeline_t::preload_model(const char* model_path) { transcribe_task->preloadModel(model_path); }
+
+bool whisperkit_pipeline_t::swap_model() { return transcribe_task->swapModel(); }
+
 void whisperkit_pipeline_t::init_streaming(whisperkit_transcription_result_t* transcription_result, int sample_rate,
                                            int num_channels) {
     transcribe_task->initStreaming(transcription_result, sample_rate, num_channels);
@@ -35,3 +67,21 @@ bool whisperkit_pipeline_t::append_audio(int size, char* buffer) {
 }
 
 void whisperkit_pipeline_t::close_streaming() { transcribe_task->closeStreaming(); }
+
+std::unique_ptr<whisperkit_session_t> whisperkit_pipeline_t::open_session(int sample_rate, int num_channels,
+                                                                          whisperkit_segment_callback_t callback,
+                                                                          void* user_data) {
+    auto session = std::make_unique<whisperkit_session_t>();
+    session->pipeline = this;
+    session->session = transcribe_task->openSession(sample_rate, num_channels, callback, user_data);
+    return session;
+}
+
+void whisperkit_pipeline_t::append_session(whisperkit_session_t* session, int size, char* buffer) {
+    transcribe_task->appendSession(*session->session, size, buffer);
+}
+
+void whisperkit_pipeline_t::close_session(whisperkit_session_t* session,
+                                          whisperkit_transcription_result_t* transcription_result) {
+    transcribe_task->closeSession(session->session, transcription_result);
+}
@@ -1,12 +1,24 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "WhisperKit.h"
 #include "WhisperKitConfiguration.hpp"
 
 struct TranscribeTask;
 struct whisperkit_transcription_result_t;
+namespace WhisperKit::TranscribeTask {
+struct Session;
+}
+
+struct whisperkit_pipeline_t;
+struct whisperkit_session_t {
+    whisperkit_pipeline_t* pipeline;
+    std::shared_ptr<WhisperKit::TranscribeTask::Session> session;
+};
+
 struct whisperkit_pipeline_t {
    public:
     whisperkit_pipeline_t();
@@ -19,10 +31,35 @@ struct whisperkit_pipeline_t {
     void build();
     // transcribe an audio file
     void transcribe(const char* audio_file, whisperkit_transcription_result_t* transcription_result);
+    // transcribe audio in memory, encoded or raw PCM
+    void transcribe_buffer(const char* data, size_t size, const whisperkit_audio_format_t* format,
+                           whisperkit_transcription_result_t* transcription_result);
+    // transcribe many audio files, results[i] receives the transcription of audio_files[i];
+    // returns the number of files that failed
+    int transcribe_batch(const std::vector<std::string>& audio_files,
+                          const std::vector<whisperkit_transcription_result_t*>& results);
+    // stops the request in flight, from any thread
+    void cancel();
+    // SUCCESS, or why the last request was stopped before the end of its audio
+    whisperkit_status_t get_stop_status() const;
+    // segments are passed to callback as they are transcribed, and appends no longer block
+    void set_segment_callback(whisperkit_segment_callback_t callback, void* user_data);
+    // tokens are passed to callback as they are decoded
+    void set_token_callback(whisperkit_token_callback_t callback, void* user_data);
+    void set_overload_callback(whisperkit_overload_callback_t callback, void* user_data);
+    float get_real_time_factor() const;
+    // loads another model set in the background, switched to by swap_model()
+    void preload_model(const char* model_path);
+    bool swap_model();
     // in streaming mode: append any length of audio data
     void init_streaming(whisperkit_transcription_result_t* transcription_result, int sample_rate, int num_channels);
     bool append_audio(int size, char* buffer);
     void close_streaming();
+    // multi-session engine: concurrent streams sharing this pipeline's models
+    std::unique_ptr<whisperkit_session_t> open_session(int sample_rate, int num_channels,
+                                                       whisperkit_segment_callback_t callback, void* user_data);
+    void append_session(whisperkit_session_t* session, int size, char* buffer);
+    void close_session(whisperkit_session_t* session, whisperkit_transcription_result_t* transcription_result);
 
    private:
     whisperkit_configuration_t configuration;
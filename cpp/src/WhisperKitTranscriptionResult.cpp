@@ -16,6 +16,18 @@ void whisperkit_transcription_result_t::set_transcription(const std::string& inp
     all_transcription.append(curr_transcription);
 }
 
+void whisperkit_transcription_result_t::append_segment(const TranscriptionSegment& segment) {
+    whisperkit_result_segment_t result_segment;
+    result_segment.start_time = segment.start_time;
+    result_segment.end_time = segment.end_time;
+    result_segment.tokens = segment_arena.append(segment.tokens.data(), segment.tokens.size());
+    result_segment.num_tokens = (int)segment.tokens.size();
+    result_segment.avg_logprob = segment.avg_logprob;
+    result_segment.no_speech_prob = segment.no_speech_prob;
+    result_segment.text = segment_arena.append_string(segment.text.data(), segment.text.size());
+    segments.push_back(result_segment);
+}
+
 std::string whisperkit_transcription_result_t::get_chunk_transcription() const { return curr_transcription; }
 
 std::string whisperkit_transcription_result_t::get_transcription() const { return all_transcription; }
\ No newline at end of file
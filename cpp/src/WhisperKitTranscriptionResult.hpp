@@ -1,6 +1,21 @@
 #pragma once
 
+#include <deque>
 #include <string>
+#include <vector>
+
+#include "Arena.hpp"
+#include "WhisperKit.h"
+
+// a transcribed segment, as the runtime hands it over to the result
+struct TranscriptionSegment {
+    float start_time;
+    float end_time;
+    std::vector<int> tokens;
+    float avg_logprob;
+    float no_speech_prob;
+    std::string text;
+};
 
 struct whisperkit_transcription_result_t {
    public:
@@ -10,8 +25,17 @@ struct whisperkit_transcription_result_t {
     void set_transcription(const std::string& transcription);
     std::string get_transcription() const;
     std::string get_chunk_transcription() const;
+    // valid until the next set_transcription()
+    const char* view_transcription() const { return all_transcription.c_str(); }
+
+    // segments are copied into an arena once, and never move afterwards
+    void append_segment(const TranscriptionSegment& segment);
+    int get_segment_count() const { return (int)segments.size(); }
+    const whisperkit_result_segment_t* get_segment(int index) const { return &segments[index]; }
 
    private:
     std::string curr_transcription;
     std::string all_transcription;
-};
\ No newline at end of file
+    WhisperKit::Arena segment_arena;
+    std::deque<whisperkit_result_segment_t> segments;  // keeps its items in place as it grows
+};
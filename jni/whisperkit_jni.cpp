@@ -1,6 +1,7 @@
 #include "whisperkit_jni.h"
 
 #include <android/log.h>
+#include <pthread.h>
 
 #include <chrono>
 #include <cmath>
@@ -221,6 +222,38 @@ void sendTextToJava(JNIEnv* env, jobject thiz, CallbackMsgType what, jfloat time
     env->DeleteLocalRef(jText);
 }
 
+// Pipeline threads are attached to the VM on their first callback, and detached when they exit
+static pthread_key_t g_detachKey;
+static pthread_once_t g_detachKeyOnce = PTHREAD_ONCE_INIT;
+
+static void detachThread(void*) { g_state.javaVM->DetachCurrentThread(); }
+
+static void createDetachKey() { pthread_key_create(&g_detachKey, detachThread); }
+
+static JNIEnv* getCallbackEnv() {
+    JNIEnv* env = nullptr;
+    if (g_state.javaVM->GetEnv((void**)&env, JNI_VERSION_1_6) == JNI_OK) {
+        return env;
+    }
+    pthread_once(&g_detachKeyOnce, createDetachKey);
+    if (g_state.javaVM->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        LOGE("Failed to attach pipeline thread");
+        return nullptr;
+    }
+    pthread_setspecific(g_detachKey, env);
+    return env;
+}
+
+// Segment callback, on the pipeline's decode thread
+static void onSegment(const whisperkit_segment_t* segment, void* userData) {
+    JNIEnv* env = getCallbackEnv();
+    // partial segments are revised by the following ones, only committed text goes to the app
+    if (!env || !g_state.mainActivity || !segment->text || strlen(segment->text) == 0 || segment->partial) {
+        return;
+    }
+    sendTextToJava(env, g_state.mainActivity, CallbackMsgType::TEXT_OUT, segment->start_time, segment->text);
+}
+
 // Initialize WhisperKit with configuration from JSON
 JNIEXPORT jint JNICALL Java_com_argmaxinc_whisperkit_WhisperKitImpl_loadModels(JNIEnv* env, jobject thiz,
                                                                                jstring jsonstr) {
@@ -374,6 +407,12 @@ JNIEXPORT jint JNICALL Java_com_argmaxinc_whisperkit_WhisperKitImpl_init(JNIEnv*
         return -1;
     }
 
+    // transcription runs on the pipeline's threads, so writeData never waits for the models
+    status = whisperkit_pipeline_set_segment_callback(g_state.pipeline, onSegment, nullptr);
+    if (status != WHISPERKIT_STATUS_SUCCESS) {
+        LOGE("Failed to set segment callback: %d", status);
+    }
+
     g_state.appended_bytes = 0;
     // all transcribing via JNI is in streaming mode
     status = whisperkit_pipeline_initstreaming(g_state.pipeline, g_state.result, g_state.sampleRate, g_state.channels);
@@ -445,26 +484,18 @@ JNIEXPORT jint JNICALL Java_com_argmaxinc_whisperkit_WhisperKitImpl_writeData(JN
 
     g_state.appended_bytes += num_bytes;
 
-    // in streaming mode: just pass the buffer pointer with its size
+    // in streaming mode: just pass the buffer pointer with its size; the audio is queued,
+    // and segments are sent to Java by onSegment as they are transcribed
     int transcribed = 0;
     whisperkit_status_t status =
         whisperkit_pipeline_appendaudio(g_state.pipeline, num_bytes, reinterpret_cast<char*>(buffer), &transcribed);
+    if (status != WHISPERKIT_STATUS_SUCCESS) {
+        LOGE("Failed to append audio: %d", status);
+    }
 
     env->ReleaseByteArrayElements(pcmbuffer, buffer, 0);
 
-    auto buffered_secs = (int)(g_state.appended_bytes / (g_state.sampleRate * g_state.channels * 2));
-    if (transcribed == 1) {
-        LOGI("** buffered_secs: %d, %d bytes\n", buffered_secs, g_state.appended_bytes);
-        // Get any available results
-        char* transcription = nullptr;
-        whisperkit_status_t status = whisperkit_transcription_result_get_transcription(g_state.result, &transcription);
-        if (status == WHISPERKIT_STATUS_SUCCESS && transcription != nullptr && strlen(transcription) > 0) {
-            // Send text to Java
-            sendTextToJava(env, thiz, CallbackMsgType::TEXT_OUT, 0.0f, transcription);
-        }
-    }
-
-    return buffered_secs;
+    return (int)(g_state.appended_bytes / (g_state.sampleRate * g_state.channels * 2));
 }
 
 JNIEXPORT jint JNICALL Java_com_argmaxinc_whisperkit_WhisperKitImpl_setBackend(JNIEnv* env, jobject thiz,
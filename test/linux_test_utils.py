@@ -4,6 +4,7 @@
 #
 
 import unittest
+import functools
 import shutil
 import os
 import time
@@ -12,6 +13,9 @@ import evaluate
 import statistics
 import docker
 import threading
+import wave
+import numpy
+import whisper.audio
 from whisper.normalizers import EnglishTextNormalizer
 
 
@@ -73,6 +77,34 @@ class TestRunLinux:
         self._run_docker_cmd(test_cmds)
         return True
 
+    def run_cli(self, test_bin, args, report_files):
+        """ runs test_bin with args and a report, returns the report files it wrote by name, None if one is missing
+        """
+        for name in report_files:
+            if os.path.exists(f"{self.root}/{name}"):
+                os.remove(f"{self.root}/{name}")
+
+        test_cmds = " ".join(
+            [
+                f"export LD_LIBRARY_PATH={self.lib_path} &&",
+                f"{self.bin_path}/{test_bin}",
+                *args,
+                "--report --report-path ."
+            ]
+        )
+        print(f"Running: {test_cmds}")
+        self._run_docker_cmd(test_cmds)
+
+        reports = {}
+        for name in report_files:
+            path = f"{self.root}/{name}"
+            if os.path.exists(path) is False:
+                return None
+            with open(path) as f:
+                reports[name] = json.load(f)
+            os.remove(path)
+        return reports
+
     def _get_wer(self, ref, pred):
         wer_metric = evaluate.load("argmaxinc/detailed-wer")
         detailed_wer = wer_metric.compute(
@@ -160,6 +192,39 @@ class LinuxTestsMixin(unittest.TestCase):
         self.audio_file_ext = self.config['audio']['extensions']
         self.test_path = f"{test_path}/dataset/{self.config['test']['datasets'][0]}"
 
+    @functools.cached_property
+    def host(self):
+        """ docker host of the tests driving the CLI modes, connected on first use """
+        return TestRunLinux(self.config)
+
+    def audio_path(self, file):
+        """ copies a test audio file to the container, returns its path there """
+        self.host.copy_file(os.path.join(self.test_path, file), self.config['audio']['local_dir'])
+        return f"{self.config['docker']['rootdir']}/{self.config['audio']['local_dir']}/{file}"
+
+    def wav_path(self, file):
+        """ 16 kHz mono 16-bit WAV of a test audio file, for the streaming modes; returns its path in the container """
+        name_only, _ = os.path.splitext(file)
+        local_dir = f"{self.host.root}/{self.config['audio']['local_dir']}"
+        os.makedirs(local_dir, exist_ok=True)
+        samples = (whisper.audio.load_audio(os.path.join(self.test_path, file)) * 32767).astype(numpy.int16)
+        with wave.open(f"{local_dir}/{name_only}.wav", "wb") as wav:
+            wav.setnchannels(1)
+            wav.setsampwidth(2)
+            wav.setframerate(whisper.audio.SAMPLE_RATE)
+            wav.writeframes(samples.tobytes())
+        return f"{self.config['docker']['rootdir']}/{self.config['audio']['local_dir']}/{name_only}.wav"
+
+    def audio_list_path(self, files):
+        """ list of test audio files for --audio-list, returns its path in the container """
+        paths = [self.audio_path(file) for file in files]
+        with open(f"{self.host.root}/{self.config['audio']['local_dir']}/audio_list.txt", "w") as audio_list:
+            audio_list.write("\n".join(paths) + "\n")
+        return f"{self.config['docker']['rootdir']}/{self.config['audio']['local_dir']}/audio_list.txt"
+
+    def run_cli(self, args, report_files):
+        return self.host.run_cli(self.test_bin, args + [f"--model-path {self.args.model_path}"], report_files)
+
     def run_test(self):
         host = TestRunLinux(self.config)
     
@@ -209,6 +209,112 @@ class TestWhisperKitLinux(LinuxTestsMixin):
             as json_file:
             json.dump(output_json, json_file)
 
+    def test_batch_speedup(self):
+        if os.cpu_count() < 4:
+            self.skipTest("batch workers need at least 4 cores to speed up")
+        audio_list = self.audio_list_path(self.files[:8])
+        speed_factors = {}
+        for workers in [1, 2]:
+            reports = self.run_cli(
+                [f"--audio-list {audio_list}", f"--concurrent-worker-count {workers}"], ["output_batch.json"])
+            self.assertIsNotNone(reports)
+            batch = reports["output_batch.json"]
+            self.assertEqual(batch["failedFiles"], 0)
+            self.assertEqual(batch["workers"], workers)
+            self.assertEqual(sum(worker["chunks"] for worker in batch["perWorker"]), batch["totalEncodingRuns"])
+            speed_factors[workers] = batch["speedFactor"]
+        print(f" ** batch speed factor: {speed_factors}")
+        self.assertGreater(speed_factors[2], 1.2 * speed_factors[1])
+
+    def test_batch_failed_file(self):
+        # the other files are transcribed, and the failure is reported
+        audio_list = self.audio_list_path(self.files[:1])
+        with open(f"{self.host.root}/{self.config['audio']['local_dir']}/audio_list.txt", "a") as list_file:
+            list_file.write("missing.mp3\n")
+        reports = self.run_cli([f"--audio-list {audio_list}"], ["output_batch.json"])
+        self.assertIsNotNone(reports)
+        batch = reports["output_batch.json"]
+        self.assertEqual(batch["numFiles"], 2)
+        self.assertEqual(batch["failedFiles"], 1)
+        self.assertGreater(batch["inputAudioSeconds"], 0)
+
+    def test_stream_append_latency(self):
+        # with the segment callback set, appends queue the audio for the pipeline's stage threads and return
+        reports = self.run_cli(
+            ["--stream", f"--audio-path {self.wav_path(self.files[0])}"], ["output_stream.json", "output.json"])
+        self.assertIsNotNone(reports)
+        stream = reports["output_stream.json"]
+        print(f" ** append latency: {stream['appendMsP50']} ms median, {stream['appendMsMax']} ms max")
+        self.assertGreater(stream["appends"], 0)
+        self.assertLess(stream["appendMsMax"], 50)
+        self.assertIn("stages", reports["output.json"]["testInfo"])
+
+    def test_stream_overload(self):
+        # one thread per model & audio 16 times faster than real time: the backlog goes over its limit,
+        # and the drop policy sheds audio instead of blocking appends or queueing it in memory
+        reports = self.run_cli(
+            ["--stream", f"--audio-path {self.wav_path(self.files[0])}", "--stream-speed 16",
+             "--overload-policy drop", "--max-backlog-ms 2000", "--encoder-threads 1", "--decoder-threads 1"],
+            ["output_stream.json", "output.json"])
+        self.assertIsNotNone(reports)
+        stream = reports["output_stream.json"]
+        overload = reports["output.json"]["testInfo"]["overload"]
+        print(f" ** overload: {overload}, peak RSS growth {stream['rssGrowthMB']} MB")
+        self.assertEqual(overload["policy"], "dropAudio")
+        self.assertGreater(overload["overloadEvents"], 0)
+        self.assertGreater(overload["droppedMs"], 0)
+        # audio is admitted while under the limit: over it by the appends in flight on the stage threads
+        self.assertLess(overload["peakBacklogMs"], overload["maxBacklogMs"] + 1000)
+        self.assertLess(stream["appendMsMax"], 50)
+        self.assertLess(stream["rssGrowthMB"], 256)
+
+    def test_session_lag_under_batch(self):
+        # two live sessions paced at real time, next to a batch on the same pipeline: their chunks go
+        # ahead of the batch's, so a segment is late by at most its 30s window plus its own transcription
+        audio_list = self.audio_list_path(self.files[:4])
+        reports = self.run_cli(
+            ["--sessions 2", f"--audio-path {self.wav_path(self.files[0])}", f"--audio-list {audio_list}"],
+            ["output_sessions.json", "output_batch.json"])
+        self.assertIsNotNone(reports)
+        sessions = reports["output_sessions.json"]
+        batch = reports["output_batch.json"]
+        realtime = batch["priorityClasses"]["realtime"]
+        print(f" ** session lag: {sessions['maxLateMs']} ms max, realtime queue delay {realtime['queueDelayMs']}")
+        self.assertEqual(batch["failedFiles"], 0)
+        self.assertGreater(sessions["minSegments"], 0)
+        self.assertGreater(realtime["chunks"], 0)
+        self.assertLess(realtime["queueDelayMs"]["p90"], 1000)
+        self.assertLess(sessions["maxLateMs"], 30000 + 10000)
+
+    def test_thread_placement(self):
+        # the same file with every model on (cores - 1) unpinned threads, then placed by the cpu topology:
+        # on a host without distinct core types, topology placement has to keep up with the default
+        latencies = {}
+        for policy in ["default", "topology"]:
+            reports = self.run_cli(
+                [f"--audio-path {self.audio_path(self.files[0])}", f"--thread-policy {policy}"], ["output.json"])
+            self.assertIsNotNone(reports)
+            report = reports["output.json"]
+            if report["testInfo"]["threadPlacement"]["policy"] != policy:
+                self.skipTest("the cpu topology of this host can't be read")
+            latencies[policy] = {stage: report["latencyStats"][stage]["med"] for stage in ["encoder", "decoder"]}
+        print(f" ** median latency by thread policy (ms): {latencies}")
+        for stage in ["encoder", "decoder"]:
+            self.assertLess(latencies["topology"][stage], 1.25 * latencies["default"][stage])
+
+    def test_decoder_state_resume(self):
+        # the build's decoder state benchmark parks a sequence the way a preempted batch chunk is, drops
+        # its state once resumed, then saves & restores it again: decoding has to go on unchanged
+        reports = self.run_cli(
+            [f"--audio-path {self.audio_path(self.files[0])}", "--benchmark-decoder-state"], ["output.json"])
+        self.assertIsNotNone(reports)
+        state_switch = reports["output.json"]["testInfo"]["decoderStateSwitch"]
+        self.assertTrue(state_switch["resumeMatches"], state_switch)
+        # the post processor's confidence is parked along with the decoder state
+        self.assertGreaterEqual(state_switch["resumeLogprobDiff"], 0)
+        self.assertLess(state_switch["resumeLogprobDiff"], 1e-3)
+        self.assertGreater(len(state_switch["byPositions"]), 0)
+
 
 def download_hg_dataset():
     test_path = f"{os.path.dirname(os.path.abspath(__file__))}"